@@ -7,7 +7,7 @@
 #include <string.h>
 
 #include "memory.h"
-#include "list.h"
+#include "tree.h"
 
 Memory* memory;
 
@@ -20,8 +20,7 @@ void initMemory(int size) {
     memory->start = 0;
     memory->end = size - 1;
 
-    memory->memBlocks = malloc(sizeof(List));
-    initList(memory->memBlocks);
+    initBlocks(memory);
 }
 
 /** main
@@ -43,7 +42,7 @@ int main(int argc, char** argv) {
 
     while (shouldExit == 0) {
         printf("allocator> ");
-        char** command = malloc(5 * sizeof(char));
+        char** command = malloc(5 * sizeof(char*));
         for (int i = 0; i < 5; i++) {
             command[i] = malloc(100 * sizeof(char));
         }
@@ -73,7 +72,7 @@ int main(int argc, char** argv) {
         free(command);
     }
 
-    deallocate(memory->memBlocks);
-    free(memory->memBlocks);
+    freeBlocks(memory);
+    free(memory);
     return 0;
 }
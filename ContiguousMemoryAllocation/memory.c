@@ -1,38 +1,65 @@
 // memory.c
 // Created by Brian Cassriel on 4/15/24.
 // This file contains the memory allocation functions for the memory data structure.
+// The allocated blocks are kept in an address-ordered tree that also knows the free bytes before each block, and
+// the free ranges (holes) in a second tree ordered by size, so every fit method finds its hole in O(log n).
 
 #include "memory.h"
-#include "list.h"
+#include "tree.h"
 
-/** memoryIsEmpty
- * Checks if the memory is empty
- * @param memory - the memory structure
- * @return true if the memory is empty, false otherwise
+/** holeKey
+ * Orders holes by size, then by start address.
+ * @param start - the first address of the hole
+ * @param size - the size of the hole
+ * @return the hole's key in the holes tree
+ */
+long long holeKey(int start, int size) { return ((long long)size << 32) | (unsigned int)start; }
+
+/** nameKey
+ * Orders blocks by a hash of their name, then by start address, so blocks with the same name sit together in
+ * address order.
+ * @param name - the name of the block
+ * @param start - the start address of the block
+ * @return the block's key in the names tree
  */
-bool memoryIsEmpty(const Memory *memory) { return getSize(memory->memBlocks) == 0; }
+long long nameKey(const char *name, int start) {
+    unsigned int hash = 2166136261u;
+    for (const char *c = name; *c != '\0'; c++)
+        hash = (hash ^ (unsigned char)*c) * 16777619u;
+    return ((long long)(hash & 0x7fffffff) << 32) | (unsigned int)start;
+}
 
-/** firstBlockIsFree
- * Checks if the first block in the memory is free
+/** addHole
+ * Records a free range, if it is not empty.
  * @param memory - the memory structure
- * @return true if the first block is free, false otherwise
+ * @param start - the first address of the range
+ * @param size - the size of the range
  */
-bool firstBlockIsFree(const Memory *memory) { return memory->memBlocks->headNode->next->block->start != memory->start; }
+void addHole(Memory *memory, int start, int size) {
+    if (size > 0)
+        insertNode(memory->holes, holeKey(start, size), 0, NULL);
+}
 
-/** atEndOfList
- * Checks if the request command has reached the end of the list
- * @param nextBlock - the next block
- * @return true if the next block is NULL, false otherwise
+/** removeHole
+ * Forgets a free range, if it is not empty.
+ * @param memory - the memory structure
+ * @param start - the first address of the range
+ * @param size - the size of the range
  */
-bool atEndOfList(const Block *nextBlock) { return nextBlock == NULL; }
+void removeHole(Memory *memory, int start, int size) {
+    if (size > 0)
+        removeNode(memory->holes, findNode(memory->holes, holeKey(start, size)));
+}
 
-/** isSpaceBetweenTwoBlocks
- * Checks if there is space between the current block and the next block
- * @param currBlock - the current block
- * @param nextBlock - the next block
- * @return true if there is space between the two blocks, false otherwise
+/** trailingHoleStart
+ * Gets where the free range after the last block starts
+ * @param memory - the memory structure
+ * @return the first address after the last block, or the start of memory if it is empty
  */
-bool isSpaceBetweenTwoBlocks(const Block *currBlock, const Block *nextBlock) { return currBlock->end + 1 != nextBlock->start; }
+int trailingHoleStart(Memory *memory) {
+    TreeNode *last = lastNode(memory->memBlocks);
+    return last == NULL ? memory->start : last->block->end + 1;
+}
 
 /** fitsInLocation
  * Checks if the process fits in the location
@@ -43,182 +70,117 @@ bool isSpaceBetweenTwoBlocks(const Block *currBlock, const Block *nextBlock) { r
  */
 bool fitsInLocation(const Block *process, const int start, const int end) { return process->size <= end - start + 1; }
 
-/** tryAppend
- * Tries to append a block to the memory with some error checking
+/** placeInHole
+ * Allocates a process at the start of a hole. What is left of the hole after it stays free.
  * @param memory - the memory structure
- * @param process - the Block to append
- * @param start - the start location
- * @param end - the end location
+ * @param process - the process to allocate
+ * @param start - the first address of the hole
+ * @param size - the size of the hole
+ * @param following - the block just after the hole, or NULL if the hole runs to the end of memory
  */
-void tryAppend(Memory *memory, Block *process, int start, int end) {
-    if (fitsInLocation(process, start, end)) {
-        process->start = start;
-        process->end = process->start + process->size - 1;
-        append(memory->memBlocks, process);
-    } else {
-        printf("Process has not been allocated. No space available.\n");
-    }
+void placeInHole(Memory *memory, Block *process, int start, int size, TreeNode *following) {
+    removeHole(memory, start, size);
+    process->start = start;
+    process->end = process->start + process->size - 1;
+    addHole(memory, process->end + 1, size - process->size);
+    if (following != NULL)
+        setWeight(following, size - process->size);
+
+    insertNode(memory->memBlocks, process->start, 0, process);
+    insertNode(memory->names, nameKey(process->name, process->start), 0, process);
 }
 
-/** tryPrepend
- * Tries to prepend a block to the memory with some error checking
+/** placeInHoleNode
+ * Allocates a process at the start of a hole found in the holes tree.
  * @param memory - the memory structure
- * @param process - the Block to prepend
- * @param end - the end location
+ * @param process - the process to allocate
+ * @param hole - the hole's node
  */
-void tryPrepend(Memory *memory, Block *process, int start, int end) {
-    if (fitsInLocation(process, start, end)) {
-        process->start = memory->start;
-        process->end = process->start + process->size - 1;
-        prepend(memory->memBlocks, process);
-    } else {
-        printf("Process has not been allocated. No space available.\n");
-    }
+void placeInHoleNode(Memory *memory, Block *process, const TreeNode *hole) {
+    int start = (int)(hole->key & 0xffffffff);
+    int size = (int)(hole->key >> 32);
+    placeInHole(memory, process, start, size, findNode(memory->memBlocks, start + size));
 }
 
 /** findFirstFit
  * Attempts to fit the process in the memory using the first fit algorithm
  * @param memory - the memory structure
  * @param process - the process to allocate
+ * @return true if the process was allocated, false otherwise
  */
-void findFirstFit(Memory *memory, Block *process) {
-    Block* currBlock;
-    Block* nextBlock;
-    int i;
-
-    i = 0;
-    do {
-        currBlock = getBlock(memory->memBlocks, i);
-        nextBlock = getBlock(memory->memBlocks, i + 1);
-
-        if (memoryIsEmpty(memory)) {
-            tryAppend(memory, process, memory->start, memory->end);
-            return;
-        } else if (firstBlockIsFree(memory)) {
-            tryPrepend(memory, process, memory->start, currBlock->start - 1);
-            return;
-        } else if (atEndOfList(nextBlock)) {
-            tryAppend(memory, process, currBlock->end + 1, memory->end);
-            return;
-        } else if (isSpaceBetweenTwoBlocks(currBlock, nextBlock) && fitsInLocation(process, currBlock->end, nextBlock->start)) {
-            process->start = currBlock->end + 1;
-            process->end = process->start + process->size - 1;
-            insertAfter(memory->memBlocks, process, i);
-            return;
-        }
-
-        i++;
-    } while (nextBlock != NULL);
+bool findFirstFit(Memory *memory, Block *process) {
+    TreeNode *following = findFirstWeight(memory->memBlocks, process->size);
+    if (following != NULL) {
+        placeInHole(memory, process, following->block->start - following->weight, following->weight, following);
+        return true;
+    }
 
-    printf("Process has not been allocated. No space available.\n");
+    int start = trailingHoleStart(memory);
+    if (fitsInLocation(process, start, memory->end)) {
+        placeInHole(memory, process, start, memory->end - start + 1, NULL);
+        return true;
+    }
+    return false;
 }
 
 /** findBestFit
  * Attempts to fit the process in the memory using the best fit algorithm
  * @param memory - the memory structure
  * @param process - the process to allocate
+ * @return true if the process was allocated, false otherwise
  */
-void findBestFit(Memory *memory, Block *process) {
-    int bestFreeIdx = -2;
-    int bestFreeSize = memory->size;
-    Block* currBlock;
-    Block* nextBlock;
-    int i;
-
-    i = 0;
-    do {
-        currBlock = getBlock(memory->memBlocks, i);
-        nextBlock = getBlock(memory->memBlocks, i + 1);
-
-        if (memoryIsEmpty(memory)) {
-            tryAppend(memory, process, memory->start, memory->end);
-            return;
-        }
-        if (firstBlockIsFree(memory) && fitsInLocation(process, memory->start, currBlock->start)) {
-            if (currBlock->start - memory->start + 1 < bestFreeSize) {
-                bestFreeSize = currBlock->start - memory->start - 1;
-                bestFreeIdx = -1;
-            }
-        }
-        if (atEndOfList(nextBlock) && fitsInLocation(process, currBlock->end, memory->end)) {
-            if (memory->end - currBlock->end + 1 < bestFreeSize) {
-                bestFreeSize = memory->end - currBlock->end - 1;
-                bestFreeIdx = i;
-            }
-        }
-        if (!atEndOfList(nextBlock) && isSpaceBetweenTwoBlocks(currBlock, nextBlock) && fitsInLocation(process, currBlock->end, nextBlock->start)) {
-            if (nextBlock->start - currBlock->end + 1 < bestFreeSize) {
-                bestFreeSize = nextBlock->start - currBlock->end - 1;
-                bestFreeIdx = i;
-            }
-        }
-
-        i++;
-    } while (nextBlock != NULL);
-
-    if (bestFreeIdx == -1)
-        tryPrepend(memory, process, memory->start, memory->memBlocks->headNode->next->block->start - 1);
-    else if (bestFreeIdx == -2)
-        printf("Process has not been allocated. No space available.\n");
-    else {
-        process->start = getBlock(memory->memBlocks, bestFreeIdx)->end + 1;
-        process->end = process->start + process->size - 1;
-        insertAfter(memory->memBlocks, process, bestFreeIdx);
-    }
+bool findBestFit(Memory *memory, Block *process) {
+    TreeNode *hole = lowerBound(memory->holes, holeKey(0, process->size));
+    if (hole == NULL)
+        return false;
+    placeInHoleNode(memory, process, hole);
+    return true;
 }
 
 /** findWorstFit
  * Attempts to fit the process in the memory using the worst fit algorithm
  * @param memory - the memory structure
  * @param process - the process to allocate
+ * @return true if the process was allocated, false otherwise
  */
-void findWorstFit(Memory *memory, Block *process) {
-    int worstFreeIdx = -2;
-    int worstFreeSize = process->size;
-    Block* currBlock;
-    Block* nextBlock;
-    int i;
-
-    i = 0;
-    do {
-        currBlock = getBlock(memory->memBlocks, i);
-        nextBlock = getBlock(memory->memBlocks, i + 1);
-
-        if (memoryIsEmpty(memory)) {
-            tryAppend(memory, process, memory->start, memory->end);
-            return;
-        }
-        if (firstBlockIsFree(memory) && fitsInLocation(process, memory->start, currBlock->start)) {
-            if (currBlock->start - memory->start + 1 > worstFreeSize) {
-                worstFreeSize = currBlock->start - memory->start - 1;
-                worstFreeIdx = -1;
-            }
-        }
-        if (atEndOfList(nextBlock) && fitsInLocation(process, currBlock->end, memory->end)) {
-            if (memory->end - currBlock->end + 1 > worstFreeSize) {
-                worstFreeSize = memory->end - currBlock->end - 1;
-                worstFreeIdx = i;
-            }
-        }
-        if (!atEndOfList(nextBlock) && isSpaceBetweenTwoBlocks(currBlock, nextBlock) && fitsInLocation(process, currBlock->end, nextBlock->start)) {
-            if (nextBlock->start - currBlock->end + 1 > worstFreeSize) {
-                worstFreeSize = nextBlock->start - currBlock->end - 1;
-                worstFreeIdx = i;
-            }
-        }
+bool findWorstFit(Memory *memory, Block *process) {
+    TreeNode *largest = lastNode(memory->holes);
+    if (largest == NULL || (int)(largest->key >> 32) < process->size)
+        return false;
+    // Of the largest holes, the one with the lowest address.
+    placeInHoleNode(memory, process, lowerBound(memory->holes, holeKey(0, (int)(largest->key >> 32))));
+    return true;
+}
 
-        i++;
-    } while (nextBlock != NULL);
+/** initBlocks
+ * Initializes the memory's trees with all of memory as one hole
+ * @param memory - the memory structure, with its start, end and size set
+ */
+void initBlocks(Memory *memory) {
+    memory->memBlocks = malloc(sizeof(Tree));
+    memory->holes = malloc(sizeof(Tree));
+    memory->names = malloc(sizeof(Tree));
+    initTree(memory->memBlocks);
+    initTree(memory->holes);
+    initTree(memory->names);
+    addHole(memory, memory->start, memory->size);
+}
 
-    if (worstFreeIdx == -1)
-        tryPrepend(memory, process, memory->start, memory->memBlocks->headNode->next->block->start - 1);
-    else if (worstFreeIdx == -2)
-        printf("Process has not been allocated. No space available.\n");
-    else {
-        process->start = getBlock(memory->memBlocks, worstFreeIdx)->end + 1;
-        process->end = process->start + process->size - 1;
-        insertAfter(memory->memBlocks, process, worstFreeIdx);
+/** freeBlocks
+ * Frees every block and the memory's trees
+ * @param memory - the memory structure
+ */
+void freeBlocks(Memory *memory) {
+    for (TreeNode *node = firstNode(memory->memBlocks); node != NULL; node = nextNode(node)) {
+        free(node->block->name);
+        free(node->block);
     }
+    clearTree(memory->memBlocks);
+    clearTree(memory->holes);
+    clearTree(memory->names);
+    free(memory->memBlocks);
+    free(memory->holes);
+    free(memory->names);
 }
 
 /** request
@@ -232,23 +194,35 @@ void request(Memory *memory, char** command) {
         return;
     }
 
+    char type = *command[3];
+    if (type != 'F' && type != 'B' && type != 'W') {
+        printf("Invalid type.\n");
+        return;
+    }
+    int size = atoi(command[2]);
+    if (size <= 0) {
+        printf("Invalid size.\n");
+        return;
+    }
+
     Block *process = malloc(sizeof(Block));
-    process->name = malloc(100 * sizeof(char));
+    process->name = malloc(strlen(command[1]) + 1);
     strcpy(process->name, command[1]);
-    process->size = atoi(command[2]);
-    char type = *command[3];
+    process->size = size;
 
-     if (type == 'F') {
-         findFirstFit(memory, process);
-     } else if (type == 'B') {
-         findBestFit(memory, process);
-     } else if (type == 'W') {
-         findWorstFit(memory, process);
-     } else {
-         printf("Invalid type.\n");
-         free(process);
-         return;
-     }
+    bool allocated;
+    if (type == 'F')
+        allocated = findFirstFit(memory, process);
+    else if (type == 'B')
+        allocated = findBestFit(memory, process);
+    else
+        allocated = findWorstFit(memory, process);
+
+    if (!allocated) {
+        printf("Process has not been allocated. No space available.\n");
+        free(process->name);
+        free(process);
+    }
 }
 
 /** release
@@ -263,16 +237,35 @@ void release(Memory *memory, char** command) {
     }
 
     char* processName = command[1];
-
-    for(int i = 0; i < getSize(memory->memBlocks); i++) {
-        Block *currBlock = getBlock(memory->memBlocks, i);
-        if (strcmp(currBlock->name, processName) == 0) {
-            delete(memory->memBlocks, i);
-            printf("Process %s has been removed. %d-%d now freed.\n", processName, currBlock->start, currBlock->end);
-            return;
-        }
+    long long hash = nameKey(processName, 0);
+
+    // Of the blocks with this name, the one with the lowest address is released.
+    TreeNode *named = lowerBound(memory->names, hash);
+    while (named != NULL && (named->key >> 32) == (hash >> 32) && strcmp(named->block->name, processName) != 0)
+        named = nextNode(named);
+    if (named == NULL || (named->key >> 32) != (hash >> 32)) {
+        printf("Process not found.\n");
+        return;
     }
-    printf("Process not found.\n");
+
+    Block *currBlock = named->block;
+    TreeNode *node = findNode(memory->memBlocks, currBlock->start);
+    TreeNode *following = nextNode(node);
+    int before = node->weight;
+    int after = following != NULL ? following->weight : memory->end - currBlock->end;
+
+    // The block and the holes on either side of it become one hole.
+    removeHole(memory, currBlock->start - before, before);
+    removeHole(memory, currBlock->end + 1, after);
+    addHole(memory, currBlock->start - before, before + currBlock->size + after);
+    if (following != NULL)
+        setWeight(following, before + currBlock->size + after);
+    removeNode(memory->memBlocks, node);
+    removeNode(memory->names, named);
+
+    printf("Process %s has been removed. %d-%d now freed.\n", processName, currBlock->start, currBlock->end);
+    free(currBlock->name);
+    free(currBlock);
 }
 
 /** compact
@@ -280,14 +273,27 @@ void release(Memory *memory, char** command) {
  * @param memory - the memory structure
  */
 void compact(Memory *memory) {
+    int count = getTreeSize(memory->memBlocks);
+    Block **blocks = malloc((count > 0 ? count : 1) * sizeof(Block *));
+    int i = 0;
+    for (TreeNode *node = firstNode(memory->memBlocks); node != NULL; node = nextNode(node))
+        blocks[i++] = node->block;
+
+    // Every block moves, so the trees are rebuilt in the new address order.
+    clearTree(memory->memBlocks);
+    clearTree(memory->holes);
+    clearTree(memory->names);
     int start = memory->start;
-
-    for (int i = 0; i < getSize(memory->memBlocks); i++) {
-        Block *currBlock = getBlock(memory->memBlocks, i);
+    for (i = 0; i < count; i++) {
+        Block *currBlock = blocks[i];
         currBlock->start = start;
         currBlock->end = currBlock->start + currBlock->size - 1;
         start = currBlock->end + 1;
+        insertNode(memory->memBlocks, currBlock->start, 0, currBlock);
+        insertNode(memory->names, nameKey(currBlock->name, currBlock->start), 0, currBlock);
     }
+    addHole(memory, start, memory->end - start + 1);
+    free(blocks);
     printf("Memory has been compacted.\n");
 }
 
@@ -298,16 +304,15 @@ void compact(Memory *memory) {
 void stats(Memory *memory) {
     printf("Allocated Memory: %d (%d-%d)\n", memory->size, memory->start, memory->end);
     printf("Processes:\n");
-    int memSize = getSize(memory->memBlocks);
 
-    if (memSize == 0) {
+    if (getTreeSize(memory->memBlocks) == 0) {
         printf("    Unused: %d (%d-%d)\n", memory->size, memory->start, memory->end);
     } else {
         int prevEnd = memory->start - 1;
-        for (int i = 0; i < memSize; i++) {
-            Block *currBlock = getBlock(memory->memBlocks, i);
-            if (currBlock->start - prevEnd > 1) {
-                printf("    Unused: %d (%d-%d)\n", currBlock->start - prevEnd - 1, prevEnd + 1, currBlock->start - 1);
+        for (TreeNode *node = firstNode(memory->memBlocks); node != NULL; node = nextNode(node)) {
+            Block *currBlock = node->block;
+            if (node->weight > 0) {
+                printf("    Unused: %d (%d-%d)\n", node->weight, currBlock->start - node->weight, currBlock->start - 1);
             }
             printf("    %s: %d (%d-%d)\n", currBlock->name, currBlock->size, currBlock->start, currBlock->end);
             prevEnd = currBlock->end;
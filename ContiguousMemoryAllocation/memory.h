@@ -10,7 +10,7 @@
 #include <stdbool.h>
 #include <string.h>
 
-typedef struct list List;
+typedef struct tree Tree;
 
 typedef struct block {
     char* name;
@@ -23,9 +23,16 @@ typedef struct memory {
     int start;
     int end;
     int size;
-    List* memBlocks;
+    // The allocated blocks by start address; each node's weight is the number of free bytes just before its block.
+    Tree* memBlocks;
+    // The free ranges by size, then start address, keyed by holeKey.
+    Tree* holes;
+    // The allocated blocks by a hash of their name, then start address, keyed by nameKey.
+    Tree* names;
 } Memory;
 
+void initBlocks(Memory *memory);
+void freeBlocks(Memory *memory);
 void request(Memory *memory, char** command);
 void release(Memory *memory, char** command);
 void compact(Memory *memory);
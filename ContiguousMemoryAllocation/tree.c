@@ -0,0 +1,356 @@
+// tree.c
+// This file contains the functions for the AVL tree data structure.
+// Nodes keep a pointer to their parent, so a node stays valid until it is removed and the next node in key order
+// is found without searching from the root.
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "tree.h"
+
+/** height
+ * @param node - the node, or NULL
+ * @return the height of the node's subtree, 0 for NULL
+ */
+static int height(const TreeNode *node) { return node == NULL ? 0 : node->height; }
+
+/** maxWeight
+ * @param node - the node, or NULL
+ * @return the largest weight in the node's subtree, -1 for NULL
+ */
+static int maxWeight(const TreeNode *node) { return node == NULL ? -1 : node->maxWeight; }
+
+/** update
+ * Recomputes a node's height and largest subtree weight from its children.
+ * @param node - the node
+ */
+static void update(TreeNode *node) {
+    int left = height(node->left);
+    int right = height(node->right);
+    node->height = 1 + (left > right ? left : right);
+
+    node->maxWeight = node->weight;
+    if (maxWeight(node->left) > node->maxWeight)
+        node->maxWeight = maxWeight(node->left);
+    if (maxWeight(node->right) > node->maxWeight)
+        node->maxWeight = maxWeight(node->right);
+}
+
+/** replaceChild
+ * Puts a new subtree where an old one hung from its parent.
+ * @param tree - the tree
+ * @param parent - the old subtree's parent, or NULL if it was the root
+ * @param oldChild - the old subtree
+ * @param newChild - the new subtree, or NULL
+ */
+static void replaceChild(Tree *tree, TreeNode *parent, TreeNode *oldChild, TreeNode *newChild) {
+    if (parent == NULL)
+        tree->root = newChild;
+    else if (parent->left == oldChild)
+        parent->left = newChild;
+    else
+        parent->right = newChild;
+    if (newChild != NULL)
+        newChild->parent = parent;
+}
+
+/** rotateLeft
+ * Lifts a node's right child into its place.
+ * @param tree - the tree
+ * @param node - the node
+ * @return the node now in its place
+ */
+static TreeNode* rotateLeft(Tree *tree, TreeNode *node) {
+    TreeNode *child = node->right;
+
+    node->right = child->left;
+    if (child->left != NULL)
+        child->left->parent = node;
+    replaceChild(tree, node->parent, node, child);
+    child->left = node;
+    node->parent = child;
+    update(node);
+    update(child);
+    return child;
+}
+
+/** rotateRight
+ * Lifts a node's left child into its place.
+ * @param tree - the tree
+ * @param node - the node
+ * @return the node now in its place
+ */
+static TreeNode* rotateRight(Tree *tree, TreeNode *node) {
+    TreeNode *child = node->left;
+
+    node->left = child->right;
+    if (child->right != NULL)
+        child->right->parent = node;
+    replaceChild(tree, node->parent, node, child);
+    child->right = node;
+    node->parent = child;
+    update(node);
+    update(child);
+    return child;
+}
+
+/** rebalance
+ * Walks from a node up towards the root, updating every node on the way and rotating any that is out of balance.
+ * The walk stops at the first node that is unchanged, since nothing above it can have changed either.
+ * @param tree - the tree
+ * @param node - the lowest node that changed, or NULL
+ */
+static void rebalance(Tree *tree, TreeNode *node) {
+    while (node != NULL) {
+        int oldHeight = node->height;
+        int oldMaxWeight = node->maxWeight;
+        update(node);
+        int balance = height(node->left) - height(node->right);
+        if (balance > 1) {
+            if (height(node->left->left) < height(node->left->right))
+                rotateLeft(tree, node->left);
+            node = rotateRight(tree, node);
+        } else if (balance < -1) {
+            if (height(node->right->right) < height(node->right->left))
+                rotateRight(tree, node->right);
+            node = rotateLeft(tree, node);
+        } else if (node->height == oldHeight && node->maxWeight == oldMaxWeight) {
+            return;
+        }
+        node = node->parent;
+    }
+}
+
+/** initTree
+ * Initializes an empty tree.
+ * @param tree - the tree to initialize
+ */
+void initTree(Tree *tree) {
+    tree->root = NULL;
+    tree->size = 0;
+}
+
+/** insertNode
+ * Inserts a new node. The key must not already be in the tree.
+ * @param tree - the tree to insert into
+ * @param key - the node's key
+ * @param weight - the node's weight
+ * @param block - the block the node stands for, or NULL
+ * @return the new node
+ */
+TreeNode* insertNode(Tree *tree, long long key, int weight, Block *block) {
+    TreeNode *newNode = malloc(sizeof(TreeNode));
+    newNode->key = key;
+    newNode->weight = weight;
+    newNode->maxWeight = weight;
+    newNode->height = 1;
+    newNode->block = block;
+    newNode->left = NULL;
+    newNode->right = NULL;
+
+    TreeNode *parent = NULL;
+    TreeNode *temp = tree->root;
+    while (temp != NULL) {
+        parent = temp;
+        temp = key < temp->key ? temp->left : temp->right;
+    }
+    newNode->parent = parent;
+    if (parent == NULL)
+        tree->root = newNode;
+    else if (key < parent->key)
+        parent->left = newNode;
+    else
+        parent->right = newNode;
+
+    tree->size++;
+    rebalance(tree, parent);
+    return newNode;
+}
+
+/** removeNode
+ * Removes a node from the tree and frees it. Its block is not freed, and no other node moves.
+ * @param tree - the tree to remove from
+ * @param node - the node to remove
+ */
+void removeNode(Tree *tree, TreeNode *node) {
+    TreeNode *lowest;
+
+    if (node->left != NULL && node->right != NULL) {
+        // The next node in key order takes the removed node's place.
+        TreeNode *next = node->right;
+        while (next->left != NULL)
+            next = next->left;
+        if (next->parent != node) {
+            lowest = next->parent;
+            replaceChild(tree, lowest, next, next->right);
+            next->right = node->right;
+            node->right->parent = next;
+        } else {
+            lowest = next;
+        }
+        next->left = node->left;
+        node->left->parent = next;
+        replaceChild(tree, node->parent, node, next);
+        // The nodes above were computed from the removed node, so that is what the walk up compares against.
+        next->height = node->height;
+        next->maxWeight = node->maxWeight;
+        free(node);
+        tree->size--;
+        rebalance(tree, lowest);
+        rebalance(tree, next);
+        return;
+    }
+
+    lowest = node->parent;
+    replaceChild(tree, node->parent, node, node->left != NULL ? node->left : node->right);
+    free(node);
+    tree->size--;
+    rebalance(tree, lowest);
+}
+
+/** setWeight
+ * Changes a node's weight.
+ * @param node - the node
+ * @param weight - the new weight
+ */
+void setWeight(TreeNode *node, int weight) {
+    node->weight = weight;
+    for (TreeNode *temp = node; temp != NULL; temp = temp->parent) {
+        int oldMaxWeight = temp->maxWeight;
+        update(temp);
+        if (temp->maxWeight == oldMaxWeight)
+            return;
+    }
+}
+
+/** clearTree
+ * Removes and frees every node, leaving the tree empty. The blocks are not freed.
+ * @param tree - the tree to clear
+ */
+void clearTree(Tree *tree) {
+    TreeNode *temp = tree->root;
+
+    // Each node is freed once both of its subtrees are gone, so no stack is needed.
+    while (temp != NULL) {
+        if (temp->left != NULL) {
+            temp = temp->left;
+        } else if (temp->right != NULL) {
+            temp = temp->right;
+        } else {
+            TreeNode *parent = temp->parent;
+            if (parent != NULL) {
+                if (parent->left == temp)
+                    parent->left = NULL;
+                else
+                    parent->right = NULL;
+            }
+            free(temp);
+            temp = parent;
+        }
+    }
+    initTree(tree);
+}
+
+/** getTreeSize
+ * Gets the number of nodes in the tree.
+ * @param tree - the tree to get the size of
+ * @return the number of nodes
+ */
+int getTreeSize(Tree *tree) { return tree->size; }
+
+/** findNode
+ * Finds the node with the given key.
+ * @param tree - the tree to search
+ * @param key - the key
+ * @return the node, or NULL if the key is not in the tree
+ */
+TreeNode* findNode(Tree *tree, long long key) {
+    TreeNode *temp = tree->root;
+
+    while (temp != NULL && temp->key != key)
+        temp = key < temp->key ? temp->left : temp->right;
+    return temp;
+}
+
+/** lowerBound
+ * Finds the first node whose key is at least the given key.
+ * @param tree - the tree to search
+ * @param key - the key
+ * @return the node, or NULL if every key is smaller
+ */
+TreeNode* lowerBound(Tree *tree, long long key) {
+    TreeNode *temp = tree->root;
+    TreeNode *found = NULL;
+
+    while (temp != NULL) {
+        if (temp->key >= key) {
+            found = temp;
+            temp = temp->left;
+        } else {
+            temp = temp->right;
+        }
+    }
+    return found;
+}
+
+/** findFirstWeight
+ * Finds the first node in key order whose weight is at least the given weight.
+ * @param tree - the tree to search
+ * @param weight - the weight
+ * @return the node, or NULL if every weight is smaller
+ */
+TreeNode* findFirstWeight(Tree *tree, int weight) {
+    TreeNode *temp = tree->root;
+
+    if (maxWeight(temp) < weight)
+        return NULL;
+    while (true) {
+        if (maxWeight(temp->left) >= weight)
+            temp = temp->left;
+        else if (temp->weight >= weight)
+            return temp;
+        else
+            temp = temp->right;
+    }
+}
+
+/** firstNode
+ * @param tree - the tree
+ * @return the node with the smallest key, or NULL if the tree is empty
+ */
+TreeNode* firstNode(Tree *tree) {
+    TreeNode *temp = tree->root;
+
+    while (temp != NULL && temp->left != NULL)
+        temp = temp->left;
+    return temp;
+}
+
+/** lastNode
+ * @param tree - the tree
+ * @return the node with the largest key, or NULL if the tree is empty
+ */
+TreeNode* lastNode(Tree *tree) {
+    TreeNode *temp = tree->root;
+
+    while (temp != NULL && temp->right != NULL)
+        temp = temp->right;
+    return temp;
+}
+
+/** nextNode
+ * Steps to the next node in key order. Walking a whole tree this way visits each edge twice, so it takes linear time.
+ * @param node - the node
+ * @return the node with the next larger key, or NULL if this is the last node
+ */
+TreeNode* nextNode(TreeNode *node) {
+    if (node->right != NULL) {
+        node = node->right;
+        while (node->left != NULL)
+            node = node->left;
+        return node;
+    }
+    while (node->parent != NULL && node->parent->right == node)
+        node = node->parent;
+    return node->parent;
+}
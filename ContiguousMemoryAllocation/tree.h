@@ -0,0 +1,41 @@
+// tree.h
+// This file contains the AVL tree data structure and the function prototypes for tree.c.
+// Nodes are ordered by a 64-bit key and each carries a weight, e.g. the free bytes just before its block.
+// Every node also keeps the largest weight in its subtree, so the first node with a large enough weight is
+// found in O(log n).
+
+#ifndef TREE_H
+#define TREE_H
+
+typedef struct block Block;
+
+typedef struct treeNode {
+    long long key;
+    int weight;
+    int maxWeight;
+    int height;
+    Block *block;
+    struct treeNode *left;
+    struct treeNode *right;
+    struct treeNode *parent;
+} TreeNode;
+
+typedef struct tree {
+    TreeNode *root;
+    int size;
+} Tree;
+
+void initTree(Tree *tree);
+TreeNode* insertNode(Tree *tree, long long key, int weight, Block *block);
+void removeNode(Tree *tree, TreeNode *node);
+void setWeight(TreeNode *node, int weight);
+void clearTree(Tree *tree);
+int getTreeSize(Tree *tree);
+TreeNode* findNode(Tree *tree, long long key);
+TreeNode* lowerBound(Tree *tree, long long key);
+TreeNode* findFirstWeight(Tree *tree, int weight);
+TreeNode* firstNode(Tree *tree);
+TreeNode* lastNode(Tree *tree);
+TreeNode* nextNode(TreeNode *node);
+
+#endif
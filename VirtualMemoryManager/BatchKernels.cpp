@@ -0,0 +1,117 @@
+// BatchKernels.cpp
+// The batch kernels decode raw trace values and probe a fully associative TLB for a group of pages at once,
+// with AVX2 and scalar versions.
+
+#include "BatchKernels.h"
+
+#include "TraceFormat.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BATCH_KERNELS_X86 1
+#endif
+
+/** decodeScalar
+ * The portable DecodeKernel.
+ */
+static int decodeScalar(const u_int64_t *values, int count, int addressBits, int offsetBits, u_int64_t *pages,
+                        u_int32_t *offsets) {
+    u_int64_t offsetMask = (1ull << offsetBits) - 1;
+    int bad = -1;
+    for (int i = 0; i < count; i++) {
+        u_int64_t value = values[i] & ~TRACE_WRITE_BIT;
+        if (value >> addressBits != 0 && bad == -1)
+            bad = i;
+        pages[i] = value >> offsetBits;
+        offsets[i] = (u_int32_t)(value & offsetMask);
+    }
+    return bad;
+}
+
+/** probeScalar
+ * The portable ProbeKernel.
+ */
+static u_int32_t probeScalar(const u_int64_t *entries, int entryCount, const u_int64_t *pages, int count,
+                             u_int8_t *slots) {
+    u_int32_t hits = 0;
+    for (int i = 0; i < count; i++) {
+        for (int e = 0; e < entryCount; e++) {
+            if (entries[e] == pages[i]) {
+                slots[i] = (u_int8_t)e;
+                hits |= 1u << i;
+                break;
+            }
+        }
+    }
+    return hits;
+}
+
+static const BatchKernels scalarKernels = {"scalar", decodeScalar, probeScalar};
+
+#ifdef BATCH_KERNELS_X86
+
+/** decodeAVX2
+ * The AVX2 DecodeKernel: four values per step, with the bounds of all of them checked by one OR.
+ */
+__attribute__((target("avx2")))
+static int decodeAVX2(const u_int64_t *values, int count, int addressBits, int offsetBits, u_int64_t *pages,
+                      u_int32_t *offsets) {
+    const __m256i writeBit = _mm256_set1_epi64x((long long)TRACE_WRITE_BIT);
+    const __m256i offsetMask = _mm256_set1_epi64x((long long)((1ull << offsetBits) - 1));
+    const __m128i addressShift = _mm_cvtsi32_si128(addressBits);
+    const __m128i offsetShift = _mm_cvtsi32_si128(offsetBits);
+    // Picks the low half of every 64-bit lane into the low 128 bits.
+    const __m256i lowHalves = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+    __m256i overflow = _mm256_setzero_si256();
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i value = _mm256_andnot_si256(writeBit, _mm256_loadu_si256((const __m256i *)(values + i)));
+        overflow = _mm256_or_si256(overflow, _mm256_srl_epi64(value, addressShift));
+        _mm256_storeu_si256((__m256i *)(pages + i), _mm256_srl_epi64(value, offsetShift));
+        __m256i offset = _mm256_permutevar8x32_epi32(_mm256_and_si256(value, offsetMask), lowHalves);
+        _mm_storeu_si128((__m128i *)(offsets + i), _mm256_castsi256_si128(offset));
+    }
+    int bad = decodeScalar(values + i, count - i, addressBits, offsetBits, pages + i, offsets + i);
+    if (!_mm256_testz_si256(overflow, overflow))
+        return decodeScalar(values, i, addressBits, offsetBits, pages, offsets);
+    return bad == -1 ? -1 : i + bad;
+}
+
+/** probeAVX2
+ * The AVX2 ProbeKernel: each page is compared with four entries per instruction.
+ */
+__attribute__((target("avx2")))
+static u_int32_t probeAVX2(const u_int64_t *entries, int entryCount, const u_int64_t *pages, int count,
+                           u_int8_t *slots) {
+    u_int32_t hits = 0;
+    for (int i = 0; i < count; i++) {
+        __m256i page = _mm256_set1_epi64x((long long)pages[i]);
+        for (int e = 0; e < entryCount; e += 4) {
+            __m256i match = _mm256_cmpeq_epi64(_mm256_load_si256((const __m256i *)(entries + e)), page);
+            int mask = _mm256_movemask_pd(_mm256_castsi256_pd(match));
+            if (mask != 0) {
+                slots[i] = (u_int8_t)(e + __builtin_ctz(mask));
+                hits |= 1u << i;
+                break;
+            }
+        }
+    }
+    return hits;
+}
+
+static const BatchKernels avx2Kernels = {"avx2", decodeAVX2, probeAVX2};
+
+#endif
+
+/** getBatchKernels
+ * @param vectorized False to always get the scalar kernels, e.g. to compare against them.
+ * @return The fastest kernels this CPU runs.
+ */
+const BatchKernels &getBatchKernels(bool vectorized) {
+#ifdef BATCH_KERNELS_X86
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    if (vectorized && avx2)
+        return avx2Kernels;
+#endif
+    return scalarKernels;
+}
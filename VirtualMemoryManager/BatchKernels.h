@@ -0,0 +1,52 @@
+// BatchKernels.h
+// The batch kernels decode raw trace values into pages and offsets, and probe a fully associative TLB for a
+// whole group of pages at once, returning a hit mask so only the misses need the scalar page table path.
+// Each kernel has an AVX2 version, picked at runtime when the CPU supports it, and a portable scalar version
+// that gives the same results everywhere else.
+
+#ifndef VIRTUALMEMORYMANAGER_BATCHKERNELS_H
+#define VIRTUALMEMORYMANAGER_BATCHKERNELS_H
+
+#include <cstdlib>
+
+// Pages probed in the TLB together; a probe returns one hit bit per page.
+#define BATCH_LANES 16
+
+/** DecodeKernel
+ * Strips the write flag from raw trace values and splits them into pages and offsets.
+ * @param values The raw values.
+ * @param count The number of values.
+ * @param addressBits The number of bits in a virtual address.
+ * @param offsetBits The number of bits in a page offset.
+ * @param pages Filled with the page numbers.
+ * @param offsets Filled with the offsets.
+ * @return The index of the first value that does not fit in addressBits, or -1 if they all do.
+ */
+typedef int (*DecodeKernel)(const u_int64_t *values, int count, int addressBits, int offsetBits, u_int64_t *pages,
+                            u_int32_t *offsets);
+
+/** ProbeKernel
+ * Looks up to BATCH_LANES pages up in the entries of a fully associative TLB without changing it.
+ * @param entries The TLB's pages, entryCount of them, a multiple of 4 and 32-byte aligned.
+ * @param entryCount The number of entries.
+ * @param pages The pages to look up.
+ * @param count The number of pages, at most BATCH_LANES.
+ * @param slots For every page found, set to the entry holding it.
+ * @return A mask with bit i set if pages[i] was found.
+ */
+typedef u_int32_t (*ProbeKernel)(const u_int64_t *entries, int entryCount, const u_int64_t *pages, int count,
+                                 u_int8_t *slots);
+
+/** BatchKernels
+ * One implementation of each kernel, and what it is built on.
+ */
+struct BatchKernels {
+    const char *name;
+    DecodeKernel decode;
+    ProbeKernel probe;
+};
+
+const BatchKernels &getBatchKernels(bool vectorized = true);
+
+
+#endif //VIRTUALMEMORYMANAGER_BATCHKERNELS_H
@@ -0,0 +1,421 @@
+// Benchmark.cpp
+// A small benchmark harness in the style of Google Benchmark. Each registered case times a loop whose iteration
+// count is grown until one run lasts the minimum time, repeats that run, and reports the median.
+
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <regex>
+
+/** BenchmarkState constructor
+ * @param iterations The number of iterations to run.
+ */
+BenchmarkState::BenchmarkState(u_int64_t iterations) {
+    this->iterations = iterations;
+    this->remaining = iterations;
+    this->started = false;
+    this->elapsed = std::chrono::steady_clock::duration::zero();
+    this->items = 0;
+}
+
+/** pauseTiming
+ * Stops the clock, e.g. while state is rebuilt between iterations.
+ */
+void BenchmarkState::pauseTiming() {
+    if (started) {
+        elapsed += std::chrono::steady_clock::now() - start;
+        started = false;
+    }
+}
+
+/** resumeTiming
+ * Starts the clock again after pauseTiming.
+ */
+void BenchmarkState::resumeTiming() {
+    if (!started) {
+        started = true;
+        start = std::chrono::steady_clock::now();
+    }
+}
+
+/** setItemsProcessed
+ * @param items The number of items (translations, lookups, ...) handled over all iterations.
+ */
+void BenchmarkState::setItemsProcessed(u_int64_t items) {
+    this->items = items;
+}
+
+/** setCounter
+ * Reports an extra value with the result, e.g. a hit rate. Setting a counter again replaces it.
+ * @param name The counter's name.
+ * @param value The value.
+ */
+void BenchmarkState::setCounter(const std::string &name, double value) {
+    for (std::pair<std::string, double> &counter : counters) {
+        if (counter.first == name) {
+            counter.second = value;
+            return;
+        }
+    }
+    counters.emplace_back(name, value);
+}
+
+/** skip
+ * Marks the case as not runnable, e.g. when an input file is missing.
+ * @param reason Why the case was skipped.
+ */
+void BenchmarkState::skip(const std::string &reason) {
+    remaining = 0;
+    skipReason = reason;
+}
+
+/** getIterations
+ * @return The number of iterations the state was created for.
+ */
+u_int64_t BenchmarkState::getIterations() {
+    return iterations;
+}
+
+/** getSeconds
+ * @return The measured time.
+ */
+double BenchmarkState::getSeconds() {
+    return std::chrono::duration<double>(elapsed).count();
+}
+
+/** getItemsProcessed
+ * @return The items reported with setItemsProcessed.
+ */
+u_int64_t BenchmarkState::getItemsProcessed() {
+    return items;
+}
+
+/** getCounters
+ * @return The counters reported with setCounter.
+ */
+const std::vector<std::pair<std::string, double>> &BenchmarkState::getCounters() {
+    return counters;
+}
+
+/** getSkipReason
+ * @return Why the case was skipped, or an empty string.
+ */
+const std::string &BenchmarkState::getSkipReason() {
+    return skipReason;
+}
+
+/** BenchmarkRunner constructor
+ * @param options The settings for every case.
+ */
+BenchmarkRunner::BenchmarkRunner(const BenchmarkOptions &options) {
+    this->options = options;
+    if (this->options.repetitions < 1)
+        this->options.repetitions = 1;
+}
+
+/** add
+ * Registers a case. Cases run in the order they are added.
+ * @param name The case's name, '/'-separated from general to specific.
+ * @param function The case.
+ */
+void BenchmarkRunner::add(const std::string &name, const std::function<void(BenchmarkState &)> &function) {
+    cases.emplace_back(name, function);
+}
+
+/** runCase
+ * Finds an iteration count that takes at least the minimum time, then repeats the case with it.
+ * @param name The case's name.
+ * @param function The case.
+ * @return The median of the repetitions.
+ */
+BenchmarkResult BenchmarkRunner::runCase(const std::string &name, const std::function<void(BenchmarkState &)> &function) {
+    BenchmarkResult result;
+    result.name = name;
+    result.iterations = 1;
+    result.repetitions = 0;
+    result.nsPerIteration = 0;
+    result.nsPerItem = 0;
+    result.itemsPerSecond = 0;
+    result.variation = 0;
+
+    std::vector<double> seconds;
+    u_int64_t items = 0;
+    while (true) {
+        BenchmarkState state(result.iterations);
+        function(state);
+        if (!state.getSkipReason().empty()) {
+            result.skipReason = state.getSkipReason();
+            return result;
+        }
+        double elapsed = state.getSeconds();
+        if (elapsed >= options.minTime || result.iterations >= BENCHMARK_MAX_ITERATIONS ||
+            !seconds.empty()) {
+            seconds.push_back(elapsed);
+            items = state.getItemsProcessed();
+            result.counters = state.getCounters();
+            if ((int)seconds.size() == options.repetitions)
+                break;
+            continue;
+        }
+        // Aim a little past the minimum time, growing at most tenfold while the runs are still too short to trust.
+        double multiplier = elapsed > 0 ? options.minTime * 1.4 / elapsed : 10;
+        if (multiplier > 10 && elapsed < options.minTime / 10)
+            multiplier = 10;
+        u_int64_t next = (u_int64_t)std::ceil((double)result.iterations * multiplier);
+        result.iterations = std::min(std::max(next, result.iterations + 1), (u_int64_t)BENCHMARK_MAX_ITERATIONS);
+    }
+
+    std::vector<double> sorted = seconds;
+    std::sort(sorted.begin(), sorted.end());
+    size_t middle = sorted.size() / 2;
+    double median = sorted.size() % 2 ? sorted[middle] : (sorted[middle - 1] + sorted[middle]) / 2;
+    double mean = 0;
+    for (double s : seconds)
+        mean += s;
+    mean /= seconds.size();
+    double squares = 0;
+    for (double s : seconds)
+        squares += (s - mean) * (s - mean);
+
+    result.repetitions = (int)seconds.size();
+    result.nsPerIteration = median * 1e9 / result.iterations;
+    result.variation = mean > 0 ? std::sqrt(squares / seconds.size()) / mean * 100 : 0;
+    if (items > 0) {
+        result.nsPerItem = median * 1e9 / items;
+        result.itemsPerSecond = median > 0 ? items / median : 0;
+    }
+    return result;
+}
+
+/** jsonString
+ * @param text The text.
+ * @return The text as a quoted JSON string.
+ */
+static std::string jsonString(const std::string &text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        } else if ((unsigned char)c < 0x20) {
+            char escape[8];
+            snprintf(escape, sizeof(escape), "\\u%04x", c);
+            quoted += escape;
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+/** writeHeader
+ * Writes what comes before the first result.
+ * @param out The stream to write to.
+ */
+void BenchmarkRunner::writeHeader(std::ostream &out) {
+    char date[32];
+    time_t now = time(nullptr);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+    if (options.format == BENCHMARK_JSON) {
+        out << "{\n  \"context\": {\n    \"date\": " << jsonString(date);
+        out << ",\n    \"min_time\": " << options.minTime;
+        out << ",\n    \"repetitions\": " << options.repetitions;
+        for (const std::pair<std::string, std::string> &entry : options.context)
+            out << ",\n    " << jsonString(entry.first) << ": " << jsonString(entry.second);
+        out << "\n  },\n  \"benchmarks\": [\n";
+    } else if (options.format == BENCHMARK_CSV) {
+        out << "name,iterations,repetitions,ns_per_iteration,ns_per_item,items_per_second,cv_percent,counters,skipped\n";
+    } else {
+        out << date;
+        for (const std::pair<std::string, std::string> &entry : options.context)
+            out << ", " << entry.first << " " << entry.second;
+        out << "\n" << std::left << std::setw(40) << "Benchmark" << std::right << std::setw(14) << "Time/iter"
+            << std::setw(12) << "Time/item" << std::setw(12) << "Iterations" << std::setw(12) << "Items/s"
+            << std::setw(8) << "CV" << "  Counters\n" << std::string(110, '-') << "\n";
+    }
+}
+
+/** writeResult
+ * Writes one result as soon as its case finishes.
+ * @param out The stream to write to.
+ * @param result The result.
+ * @param first True for the first result, which gets no separator.
+ */
+void BenchmarkRunner::writeResult(std::ostream &out, const BenchmarkResult &result, bool first) {
+    if (options.format == BENCHMARK_JSON) {
+        // One result per line, which is what compare() reads back.
+        out << (first ? "" : ",\n") << "    {\"name\": " << jsonString(result.name);
+        if (!result.skipReason.empty()) {
+            out << ", \"skipped\": " << jsonString(result.skipReason) << "}";
+            return;
+        }
+        out << ", \"iterations\": " << result.iterations << ", \"repetitions\": " << result.repetitions
+            << ", \"ns_per_iteration\": " << result.nsPerIteration << ", \"ns_per_item\": " << result.nsPerItem
+            << ", \"items_per_second\": " << result.itemsPerSecond << ", \"cv_percent\": " << result.variation
+            << ", \"counters\": {";
+        for (size_t c = 0; c < result.counters.size(); c++)
+            out << (c ? ", " : "") << jsonString(result.counters[c].first) << ": " << result.counters[c].second;
+        out << "}}";
+    } else if (options.format == BENCHMARK_CSV) {
+        out << result.name << ",";
+        if (result.skipReason.empty()) {
+            out << result.iterations << "," << result.repetitions << "," << result.nsPerIteration << ","
+                << result.nsPerItem << "," << result.itemsPerSecond << "," << result.variation << ",";
+            for (size_t c = 0; c < result.counters.size(); c++)
+                out << (c ? ";" : "") << result.counters[c].first << "=" << result.counters[c].second;
+            out << ",\n";
+        } else {
+            out << ",,,,,,,\"" << result.skipReason << "\"\n";
+        }
+    } else {
+        out << std::left << std::setw(40) << result.name << std::right;
+        if (!result.skipReason.empty()) {
+            out << "  skipped: " << result.skipReason << "\n";
+            return;
+        }
+        std::ios::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+        out << std::fixed << std::setprecision(1) << std::setw(11) << result.nsPerIteration << " ns"
+            << std::setprecision(2) << std::setw(9) << result.nsPerItem << " ns" << std::setw(12) << result.iterations
+            << std::setprecision(1) << std::setw(11) << result.itemsPerSecond / 1e6 << "M" << std::setw(7)
+            << result.variation << "%";
+        out.flags(flags);
+        out.precision(precision);
+        out << " ";
+        for (const std::pair<std::string, double> &counter : result.counters)
+            out << " " << counter.first << "=" << counter.second;
+        out << "\n";
+    }
+    out.flush();
+}
+
+/** writeFooter
+ * Writes what comes after the last result.
+ * @param out The stream to write to.
+ */
+void BenchmarkRunner::writeFooter(std::ostream &out) {
+    if (options.format == BENCHMARK_JSON)
+        out << "\n  ]\n}\n";
+    out.flush();
+}
+
+/** run
+ * Runs every case matching the filter, writing each result as it finishes.
+ * @param out The stream to write to.
+ * @return The number of cases run, or -1 if the filter is not a valid regular expression.
+ */
+int BenchmarkRunner::run(std::ostream &out) {
+    std::regex filter;
+    try {
+        filter = std::regex(options.filter.empty() ? std::string(".") : options.filter);
+    } catch (const std::regex_error &error) {
+        std::cerr << "Invalid benchmark filter: " << options.filter << std::endl;
+        return -1;
+    }
+
+    results.clear();
+    writeHeader(out);
+    for (const std::pair<std::string, std::function<void(BenchmarkState &)>> &entry : cases) {
+        if (!std::regex_search(entry.first, filter))
+            continue;
+        results.push_back(runCase(entry.first, entry.second));
+        writeResult(out, results.back(), results.size() == 1);
+    }
+    writeFooter(out);
+    return (int)results.size();
+}
+
+/** getResults
+ * @return The results of the last run.
+ */
+const std::vector<BenchmarkResult> &BenchmarkRunner::getResults() {
+    return results;
+}
+
+/** jsonNumber
+ * Reads a number field out of one line of a JSON report.
+ * @param line The line.
+ * @param key The field name.
+ * @return The value, or 0 if the line has no such field.
+ */
+static double jsonNumber(const std::string &line, const std::string &key) {
+    size_t at = line.find("\"" + key + "\": ");
+    if (at == std::string::npos)
+        return 0;
+    return atof(line.c_str() + at + key.size() + 4);
+}
+
+/** compare
+ * Compares the last run against a JSON report written by an earlier one, case by case. Cases are compared on
+ * time per item when they report items, and on time per iteration otherwise.
+ * @param baselinePath The earlier report.
+ * @param threshold How many percent slower a case may get before it counts as a regression.
+ * @param out The stream to write the comparison to.
+ * @return The number of regressions, or -1 if the report could not be read.
+ */
+int BenchmarkRunner::compare(const std::string &baselinePath, double threshold, std::ostream &out) {
+    std::ifstream file(baselinePath);
+    if (!file.is_open()) {
+        std::cerr << "Error opening file: " << baselinePath << std::endl;
+        return -1;
+    }
+    std::map<std::string, double> baseline;
+    std::string line;
+    while (getline(file, line)) {
+        size_t at = line.find("{\"name\": \"");
+        if (at == std::string::npos || line.find("\"skipped\"") != std::string::npos)
+            continue;
+        size_t start = at + 10;
+        std::string name = line.substr(start, line.find('"', start) - start);
+        double ns = jsonNumber(line, "ns_per_item");
+        baseline[name] = ns > 0 ? ns : jsonNumber(line, "ns_per_iteration");
+    }
+
+    int regressions = 0;
+    out << "Comparison with " << baselinePath << " (threshold " << threshold << "%)\n";
+    for (const BenchmarkResult &result : results) {
+        std::map<std::string, double>::iterator base = baseline.find(result.name);
+        if (base == baseline.end() || base->second <= 0 || !result.skipReason.empty())
+            continue;
+        double current = result.nsPerItem > 0 ? result.nsPerItem : result.nsPerIteration;
+        double change = (current - base->second) / base->second * 100;
+        bool regressed = change > threshold;
+        regressions += regressed;
+        std::ios::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+        out << std::left << std::setw(40) << result.name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(12) << base->second << " -> " << std::setw(12) << current << " ns" << std::showpos
+            << std::setprecision(1) << std::setw(9) << change << "%" << (regressed ? "  REGRESSION" : "") << "\n";
+        out.flags(flags);
+        out.precision(precision);
+    }
+    out << regressions << " regression" << (regressions == 1 ? "" : "s") << std::endl;
+    return regressions;
+}
+
+/** parseBenchmarkFormat
+ * Converts a report format name to a BenchmarkFormat.
+ * @param name The format name.
+ * @param format The parsed format.
+ * @return True if the name is a known format.
+ */
+bool parseBenchmarkFormat(const char *name, BenchmarkFormat &format) {
+    if (strcmp(name, "text") == 0)
+        format = BENCHMARK_TEXT;
+    else if (strcmp(name, "json") == 0)
+        format = BENCHMARK_JSON;
+    else if (strcmp(name, "csv") == 0)
+        format = BENCHMARK_CSV;
+    else
+        return false;
+    return true;
+}
@@ -0,0 +1,138 @@
+// Benchmark.h
+// A small benchmark harness in the style of Google Benchmark. Each registered case times a loop whose iteration
+// count is grown until one run lasts the minimum time, repeats that run, and reports the median. Results can be
+// printed as a table, JSON or CSV, and compared against an earlier JSON report to catch regressions.
+
+#ifndef VIRTUALMEMORYMANAGER_BENCHMARK_H
+#define VIRTUALMEMORYMANAGER_BENCHMARK_H
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define BENCHMARK_MIN_TIME 0.2
+#define BENCHMARK_REPETITIONS 3
+#define BENCHMARK_MAX_ITERATIONS 1000000000ull
+
+/** BenchmarkFormat
+ * How the results are reported.
+ */
+enum BenchmarkFormat {
+    BENCHMARK_TEXT,
+    BENCHMARK_JSON,
+    BENCHMARK_CSV
+};
+
+/** BenchmarkState
+ * Handed to a benchmark case, which does its setup, then runs one iteration per keepRunning() call.
+ * Only the time between the first keepRunning() and the last one, minus paused stretches, is measured.
+ */
+class BenchmarkState {
+public:
+    BenchmarkState(u_int64_t iterations);
+    /** keepRunning
+     * @return True while there are iterations left to run.
+     */
+    bool keepRunning() {
+        if (remaining > 0) {
+            if (!started) {
+                started = true;
+                start = std::chrono::steady_clock::now();
+            }
+            remaining--;
+            return true;
+        }
+        if (started) {
+            elapsed += std::chrono::steady_clock::now() - start;
+            started = false;
+        }
+        return false;
+    }
+    void pauseTiming();
+    void resumeTiming();
+    void setItemsProcessed(u_int64_t items);
+    void setCounter(const std::string &name, double value);
+    void skip(const std::string &reason);
+    u_int64_t getIterations();
+    double getSeconds();
+    u_int64_t getItemsProcessed();
+    const std::vector<std::pair<std::string, double>> &getCounters();
+    const std::string &getSkipReason();
+
+private:
+    u_int64_t iterations;
+    u_int64_t remaining;
+    bool started;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::duration elapsed;
+    u_int64_t items;
+    std::vector<std::pair<std::string, double>> counters;
+    std::string skipReason;
+};
+
+/** BenchmarkResult
+ * The median of a case's repetitions.
+ */
+struct BenchmarkResult {
+    std::string name;
+    u_int64_t iterations;
+    int repetitions;
+    double nsPerIteration;
+    // 0 when the case does not report items.
+    double nsPerItem;
+    double itemsPerSecond;
+    // Standard deviation of the repetitions over their mean, in percent.
+    double variation;
+    std::vector<std::pair<std::string, double>> counters;
+    std::string skipReason;
+};
+
+/** BenchmarkOptions
+ * Settings shared by every case of a run.
+ */
+struct BenchmarkOptions {
+    double minTime;
+    int repetitions;
+    // Only cases whose name matches this regular expression are run.
+    std::string filter;
+    BenchmarkFormat format;
+    // Recorded in the report so a run can be reproduced.
+    std::vector<std::pair<std::string, std::string>> context;
+
+    /** BenchmarkOptions constructor
+     * Every case, reported as a table.
+     */
+    BenchmarkOptions() {
+        minTime = BENCHMARK_MIN_TIME;
+        repetitions = BENCHMARK_REPETITIONS;
+        format = BENCHMARK_TEXT;
+    }
+};
+
+class BenchmarkRunner {
+public:
+    BenchmarkRunner(const BenchmarkOptions &options);
+    void add(const std::string &name, const std::function<void(BenchmarkState &)> &function);
+    int run(std::ostream &out);
+    const std::vector<BenchmarkResult> &getResults();
+    int compare(const std::string &baselinePath, double threshold, std::ostream &out);
+
+private:
+    BenchmarkOptions options;
+    std::vector<std::pair<std::string, std::function<void(BenchmarkState &)>>> cases;
+    std::vector<BenchmarkResult> results;
+
+    BenchmarkResult runCase(const std::string &name, const std::function<void(BenchmarkState &)> &function);
+    void writeHeader(std::ostream &out);
+    void writeResult(std::ostream &out, const BenchmarkResult &result, bool first);
+    void writeFooter(std::ostream &out);
+};
+
+bool parseBenchmarkFormat(const char *name, BenchmarkFormat &format);
+
+
+#endif //VIRTUALMEMORYMANAGER_BENCHMARK_H
@@ -0,0 +1,247 @@
+// Checkpoint.cpp
+// A checkpoint is the simulator's state after a prefix of a trace, in a compact binary file; the components
+// write and read their own sections, and this file frames them.
+
+#include "Checkpoint.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sys/stat.h>
+
+#include "Translator.h"
+
+/** beginSection
+ * Starts a section, so a reader can tell it is still in step with the writer.
+ * @param tag Four characters naming the section.
+ */
+void CheckpointWriter::beginSection(const char *tag) {
+    bytes.insert(bytes.end(), tag, tag + 4);
+}
+
+/** put
+ * Appends an integer, seven bits per byte with the top bit set on every byte but the last.
+ * @param value The value.
+ */
+void CheckpointWriter::put(u_int64_t value) {
+    while (value >= 0x80) {
+        bytes.push_back((unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    bytes.push_back((unsigned char)value);
+}
+
+/** putString
+ * Appends a string as its length and then its characters.
+ * @param value The string.
+ */
+void CheckpointWriter::putString(const std::string &value) {
+    put(value.size());
+    bytes.insert(bytes.end(), value.begin(), value.end());
+}
+
+/** putBlock
+ * Appends everything another writer holds as one length-prefixed block, which a reader can skip as a whole.
+ * @param block The writer holding the block.
+ */
+void CheckpointWriter::putBlock(const CheckpointWriter &block) {
+    put(block.bytes.size());
+    bytes.insert(bytes.end(), block.bytes.begin(), block.bytes.end());
+}
+
+/** writeFile
+ * Writes the checkpoint next to its destination and renames it into place, so an interrupted write never
+ * replaces an earlier checkpoint with a partial one.
+ * @param path The checkpoint file.
+ * @return True if the file was written.
+ */
+bool CheckpointWriter::writeFile(const std::string &path) {
+    std::string temporary = path + ".tmp";
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+        return false;
+    out.write((const char *)bytes.data(), (std::streamsize)bytes.size());
+    out.close();
+    if (out.fail() || rename(temporary.c_str(), path.c_str()) != 0) {
+        remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+/** CheckpointReader constructor
+ * Starts out empty, so every read fails until a file or block is loaded.
+ */
+CheckpointReader::CheckpointReader() {
+    position = 0;
+    valid = false;
+}
+
+/** readFile
+ * Loads a whole checkpoint file.
+ * @param path The checkpoint file.
+ * @return True if the file could be read.
+ */
+bool CheckpointReader::readFile(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open())
+        return false;
+    bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    position = 0;
+    valid = !in.bad();
+    return valid;
+}
+
+/** expectSection
+ * @param tag The four characters the next section should start with.
+ * @return True if it does.
+ */
+bool CheckpointReader::expectSection(const char *tag) {
+    if (!valid || position + 4 > bytes.size() || memcmp(bytes.data() + position, tag, 4) != 0) {
+        valid = false;
+        return false;
+    }
+    position += 4;
+    return true;
+}
+
+/** get
+ * @return The next integer, or 0 if the reader has failed.
+ */
+u_int64_t CheckpointReader::get() {
+    u_int64_t value = 0;
+    for (int shift = 0; valid && shift < 64; shift += 7) {
+        if (position == bytes.size())
+            break;
+        unsigned char byte = bytes[position++];
+        value |= (u_int64_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return value;
+    }
+    valid = false;
+    return 0;
+}
+
+/** getString
+ * @return The next string, or "" if the reader has failed.
+ */
+std::string CheckpointReader::getString() {
+    u_int64_t length = get();
+    if (!valid || length > bytes.size() - position) {
+        valid = false;
+        return "";
+    }
+    std::string value((const char *)bytes.data() + position, length);
+    position += length;
+    return value;
+}
+
+/** getBlock
+ * Takes the next block out as a reader of its own, or just skips it.
+ * @param block Set up to read the block.
+ * @return True if there was a whole block.
+ */
+bool CheckpointReader::getBlock(CheckpointReader &block) {
+    u_int64_t length = get();
+    if (!valid || length > bytes.size() - position) {
+        valid = false;
+        return false;
+    }
+    block.bytes.assign(bytes.begin() + position, bytes.begin() + position + length);
+    block.position = 0;
+    block.valid = true;
+    position += length;
+    return true;
+}
+
+/** isValid
+ * @return True if every read so far found what it expected.
+ */
+bool CheckpointReader::isValid() {
+    return valid;
+}
+
+/** writeCheckpoint
+ * Saves a translator's state, and what it was running under, to a checkpoint file.
+ * @param path The checkpoint file, replaced if it exists.
+ * @param info The run's options and how far into the trace it is.
+ * @param translator The translator.
+ * @return True if the checkpoint was written; false if the file could not be written or the translator is set
+ * up in a way checkpoints do not cover.
+ */
+bool writeCheckpoint(const std::string &path, const CheckpointInfo &info, Translator &translator) {
+    CheckpointWriter out;
+    out.putString(CHECKPOINT_MAGIC);
+    out.put(CHECKPOINT_VERSION);
+    out.beginSection("INFO");
+    out.put(info.geometry.addressBits);
+    out.put(info.geometry.offsetBits);
+    out.put(info.geometry.largeBits);
+    out.put(info.frameCount);
+    out.put(info.tlbLevels.size());
+    for (const TLBLevelConfig &level : info.tlbLevels) {
+        out.put(level.size);
+        out.put(level.ways);
+        out.put(level.latency);
+    }
+    out.putString(info.policyName);
+    out.putString(info.pageTableName);
+    out.put(info.traceSize);
+    out.put(info.position);
+    if (!translator.saveState(out))
+        return false;
+    out.beginSection("END.");
+    return out.writeFile(path);
+}
+
+/** readCheckpointInfo
+ * Reads the start of a checkpoint: what it was taken under. The translator's state follows it.
+ * @param in The loaded checkpoint.
+ * @param info Filled with the run's options and how far into the trace it was.
+ * @return True if the file is a checkpoint of this version.
+ */
+bool readCheckpointInfo(CheckpointReader &in, CheckpointInfo &info) {
+    if (in.getString() != CHECKPOINT_MAGIC || in.get() != CHECKPOINT_VERSION || !in.expectSection("INFO"))
+        return false;
+    info.geometry.addressBits = (int)in.get();
+    info.geometry.offsetBits = (int)in.get();
+    info.geometry.largeBits = (int)in.get();
+    info.frameCount = (int)in.get();
+    u_int64_t levels = in.get();
+    info.tlbLevels.clear();
+    for (u_int64_t l = 0; l < levels && l < MAX_TLB_LEVELS; l++) {
+        TLBLevelConfig level;
+        level.size = (int)in.get();
+        level.ways = (int)in.get();
+        level.latency = (int)in.get();
+        info.tlbLevels.push_back(level);
+    }
+    info.policyName = in.getString();
+    info.pageTableName = in.getString();
+    info.traceSize = in.get();
+    info.position = in.get();
+    return in.isValid() && levels <= MAX_TLB_LEVELS;
+}
+
+/** restoreCheckpoint
+ * Loads the translator's state that follows the info readCheckpointInfo read.
+ * @param in The checkpoint, positioned after its info.
+ * @param translator A translator built with the same geometry, frame count and TLB levels, that has not
+ * translated anything yet.
+ * @return True if the whole checkpoint was restored.
+ */
+bool restoreCheckpoint(CheckpointReader &in, Translator &translator) {
+    return translator.loadState(in) && in.expectSection("END.");
+}
+
+/** getFileSize
+ * @param path A file.
+ * @return Its size in bytes, or 0 if it cannot be found.
+ */
+u_int64_t getFileSize(const std::string &path) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+        return 0;
+    return (u_int64_t)info.st_size;
+}
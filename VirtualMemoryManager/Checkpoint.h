@@ -0,0 +1,81 @@
+// Checkpoint.h
+// A checkpoint is the simulator's state after a prefix of a trace, in a compact binary file: the TLB entries in
+// LRU order, the resident pages, the replacement policy's own state and every counter, plus how many addresses
+// of the trace were consumed. Frame contents are not stored, since the simulator never changes a page's bytes;
+// they are read back from the backing store on restore. Restoring one continues the run where it stopped, or,
+// under another replacement policy or page table, forks a new experiment from the same warmed-up state.
+// Every integer is stored as a variable-length quantity, so small counters and page numbers take a byte or two.
+
+#ifndef VIRTUALMEMORYMANAGER_CHECKPOINT_H
+#define VIRTUALMEMORYMANAGER_CHECKPOINT_H
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "address.h"
+#include "TLBHierarchy.h"
+
+// The first bytes of every checkpoint file, then its format version.
+#define CHECKPOINT_MAGIC "VMMCKPT"
+#define CHECKPOINT_VERSION 1
+
+class Translator;
+
+/** CheckpointWriter
+ * Builds a checkpoint in memory, section by section, and writes it out in one go.
+ */
+class CheckpointWriter {
+public:
+    void beginSection(const char *tag);
+    void put(u_int64_t value);
+    void putString(const std::string &value);
+    void putBlock(const CheckpointWriter &block);
+    bool writeFile(const std::string &path);
+
+private:
+    std::vector<unsigned char> bytes;
+};
+
+/** CheckpointReader
+ * Reads back what a CheckpointWriter wrote. A read past the end or a section tag that does not match marks the
+ * reader failed; every later read then returns 0, so callers can check isValid once at the end.
+ */
+class CheckpointReader {
+public:
+    CheckpointReader();
+    bool readFile(const std::string &path);
+    bool expectSection(const char *tag);
+    u_int64_t get();
+    std::string getString();
+    bool getBlock(CheckpointReader &block);
+    bool isValid();
+
+private:
+    std::vector<unsigned char> bytes;
+    size_t position;
+    bool valid;
+};
+
+/** CheckpointInfo
+ * What a checkpoint was taken under, and how far into its trace.
+ */
+struct CheckpointInfo {
+    Geometry geometry;
+    int frameCount;
+    std::vector<TLBLevelConfig> tlbLevels;
+    std::string policyName;
+    std::string pageTableName;
+    // The trace's size in bytes, so a restore can tell it was given the same trace.
+    u_int64_t traceSize;
+    // The number of addresses translated, all of them from the start of the trace.
+    u_int64_t position;
+};
+
+bool writeCheckpoint(const std::string &path, const CheckpointInfo &info, Translator &translator);
+bool readCheckpointInfo(CheckpointReader &in, CheckpointInfo &info);
+bool restoreCheckpoint(CheckpointReader &in, Translator &translator);
+u_int64_t getFileSize(const std::string &path);
+
+
+#endif //VIRTUALMEMORYMANAGER_CHECKPOINT_H
@@ -4,58 +4,221 @@
 
 #include "FileProcessor.h"
 
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 /** FileProcessor constructor
- * @param addrFilePath The path to the file containing the addresses.
+ * @param addrFilePath The path to the file containing the addresses, or empty for a backing store with no trace,
+ * as the translation service uses.
+ * @param storeMode How page faults read the backing store.
+ * @param geometry How addresses split into pages.
  */
-FileProcessor::FileProcessor(const std::string addrFilePath) {
-    this->addrFile.open(addrFilePath);
-    this->backingStoreFile.open("BACKING_STORE.bin");
-    if (!this->addrFile.is_open()) {
-        std::cerr << "Error opening file: " << addrFilePath << std::endl;
-        exit(1);
+FileProcessor::FileProcessor(const std::string addrFilePath, StoreMode storeMode, const Geometry &geometry) {
+    this->storeMode = storeMode;
+    this->geometry = geometry;
+    this->storeMap = nullptr;
+    this->storeSize = 0;
+    this->rawBatch.resize(TRACE_BATCH_SIZE);
+    pthread_mutex_init(&this->storeLock, nullptr);
+    this->reads = 0;
+    this->traceReader = nullptr;
+    if (!addrFilePath.empty()) {
+        this->traceReader = new TraceReader(addrFilePath);
+        if (!this->traceReader->isOpen()) {
+            std::cerr << "Error opening file: " << addrFilePath << std::endl;
+            exit(1);
+        }
+        if (this->traceReader->isBinary() && this->traceReader->getPageBits() != geometry.offsetBits) {
+            std::cerr << "Error: " << addrFilePath << " was recorded with "
+                    << (1ull << this->traceReader->getPageBits()) << "-byte pages, but the simulator uses "
+                    << geometry.getPageSize() << "-byte pages." << std::endl;
+            exit(1);
+        }
     }
-    if (!this->backingStoreFile.is_open()) {
-        std::cerr << "Error opening file: BACKING_STORE.bin. Please place it in the same directory as this program." << std::endl;
-        exit(1);
+    if (storeMode == STORE_STREAM) {
+        checkStore("BACKING_STORE.bin");
+        this->backingStoreFile.open("BACKING_STORE.bin");
+        if (!this->backingStoreFile.is_open()) {
+            std::cerr << "Error opening file: BACKING_STORE.bin. Please place it in the same directory as this program." << std::endl;
+            exit(1);
+        }
+    } else if (storeMode != STORE_NONE) {
+        mapStore("BACKING_STORE.bin");
     }
 }
 
 /** FileProcessor destructor
- * Closes the files.
+ * Closes the files and unmaps the backing store.
  */
 FileProcessor::~FileProcessor() {
-    this->addrFile.close();
+    delete this->traceReader;
     this->backingStoreFile.close();
+    if (this->storeMap != nullptr)
+        munmap((void *)this->storeMap, this->storeSize);
+    pthread_mutex_destroy(&this->storeLock);
 }
 
-/** processFile
- * @param addrList The list of addresses to be filled.
- * @return 0 if successful, -1 if the file is not open.
+/** checkStore
+ * Records the size of the backing store. Virtual addresses past its end wrap around to its start, so it only
+ * has to hold a whole number of pages, not the whole address space.
+ * @param path The path to the backing store.
  */
-int FileProcessor::processFile(std::vector<Address*> &addrList) {
-    if (!this->addrFile.is_open()) {
-        return -1;
+void FileProcessor::checkStore(const char *path) {
+    struct stat info;
+    if (stat(path, &info) == -1) {
+        std::cerr << "Error opening file: " << path << ". Please place it in the same directory as this program." << std::endl;
+        exit(1);
+    }
+    if (info.st_size == 0 || (size_t)info.st_size % this->geometry.getPageSize() != 0) {
+        std::cerr << "Error: " << path << " must hold a whole number of " << this->geometry.getPageSize()
+                << "-byte pages." << std::endl;
+        exit(1);
     }
-    std::string line;
-    while (getline(addrFile, line)) {
-        if (VADDR_SIZE < std::stoi(line)) {
-            std::cerr << "Address out of bounds: " << line << std::endl;
+    this->storeSize = info.st_size;
+}
+
+/** mapStore
+ * Maps the backing store read-only and tells the kernel how it will be read.
+ * Small stores are prefetched whole, large ones are marked random so faults do not trigger readahead.
+ * @param path The path to the backing store.
+ */
+void FileProcessor::mapStore(const char *path) {
+    checkStore(path);
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        std::cerr << "Error opening file: " << path << ". Please place it in the same directory as this program." << std::endl;
+        exit(1);
+    }
+
+    void *map = mmap(nullptr, this->storeSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        std::cerr << "Error mapping file: " << path << std::endl;
+        exit(1);
+    }
+    if (this->storeSize <= STORE_WILLNEED_LIMIT)
+        madvise(map, this->storeSize, MADV_WILLNEED);
+    else
+        madvise(map, this->storeSize, MADV_RANDOM);
+    this->storeMap = (const char *)map;
+}
+
+/** readBatch
+ * Decodes the next addresses from the trace into a caller-provided batch.
+ * The trace is streamed by a TraceReader, so memory use does not grow with the trace.
+ * Each address is marked as a write if the trace says it is one.
+ * @param batch The batch to be filled.
+ * @param maxCount The capacity of the batch.
+ * @return The number of addresses decoded, 0 at the end of the trace, or -1 if the file could not be read.
+ */
+int FileProcessor::readBatch(Address *batch, int maxCount) {
+    if (maxCount > TRACE_BATCH_SIZE)
+        maxCount = TRACE_BATCH_SIZE;
+    if (this->traceReader == nullptr)
+        return 0;
+    int count = this->traceReader->readAddresses(this->rawBatch.data(), maxCount);
+    for (int i = 0; i < count; i++) {
+        u_int64_t value = this->rawBatch[i] & ~TRACE_WRITE_BIT;
+        if (value >= this->geometry.getAddressSpace()) {
+            std::cerr << "Address out of bounds: " << value << std::endl;
             exit(1);
         }
-        Address *address = new Address();
+        this->geometry.split(value, batch[i]);
+        batch[i].write = this->rawBatch[i] >> 63;
+    }
+    return count;
+}
+
+/** readRawBatch
+ * Reads the next addresses from the trace as they are stored, with TRACE_WRITE_BIT set for a write, leaving
+ * the bounds check and the split into pages to the caller, e.g. a batch decode kernel.
+ * @param values The values to be filled.
+ * @param maxCount The capacity of values.
+ * @return The number of values read, 0 at the end of the trace, or -1 if the file could not be read.
+ */
+int FileProcessor::readRawBatch(u_int64_t *values, int maxCount) {
+    if (maxCount > TRACE_BATCH_SIZE)
+        maxCount = TRACE_BATCH_SIZE;
+    if (this->traceReader == nullptr)
+        return 0;
+    return this->traceReader->readAddresses(values, maxCount);
+}
 
-        address->page = (std::stoi(line) >> 8) & 0xFF;
-        address->offset = std::stoi(line) & 0xFF;
-        addrList.push_back(address);
+/** skipAddresses
+ * Reads past addresses without decoding them, e.g. the ones a restored checkpoint already translated.
+ * @param count The number of addresses to skip.
+ * @return The number skipped, less than count if the trace ended first.
+ */
+u_int64_t FileProcessor::skipAddresses(u_int64_t count) {
+    u_int64_t skipped = 0;
+    while (skipped < count && this->traceReader != nullptr) {
+        int wanted = count - skipped < TRACE_BATCH_SIZE ? (int)(count - skipped) : TRACE_BATCH_SIZE;
+        int read = this->traceReader->readAddresses(this->rawBatch.data(), wanted);
+        if (read <= 0)
+            break;
+        skipped += read;
     }
-    return 0;
+    return skipped;
+}
+
+/** getStoreOffset
+ * @param page The page number.
+ * @return Where the page starts in the backing store.
+ */
+size_t FileProcessor::getStoreOffset(u_int64_t page) {
+    size_t pageSize = this->geometry.getPageSize();
+    return (size_t)(page % (this->storeSize / pageSize)) * pageSize;
 }
 
 /** getDataFromStore
  * @param page The page number to read from the backing store.
  * @param data The data to be filled.
  */
-void FileProcessor::getDataFromStore(u_int8_t page, char* data) {
-    this->backingStoreFile.seekg(page * PAGE_SIZE);
-    this->backingStoreFile.read(data, FRAME_SIZE);
+void FileProcessor::getDataFromStore(u_int64_t page, char* data) {
+    this->reads.fetch_add(1, std::memory_order_relaxed);
+    if (this->storeMap != nullptr) {
+        memcpy(data, this->storeMap + getStoreOffset(page), this->geometry.getPageSize());
+        return;
+    }
+    pthread_mutex_lock(&this->storeLock);
+    this->backingStoreFile.seekg(getStoreOffset(page));
+    this->backingStoreFile.read(data, this->geometry.getPageSize());
+    pthread_mutex_unlock(&this->storeLock);
+}
+
+/** mapPage
+ * Gets a page straight out of the backing store mapping without copying it.
+ * @param page The page number to read from the backing store.
+ * @return A read-only pointer to the page, or nullptr if the store is not mapped.
+ */
+const char *FileProcessor::mapPage(u_int64_t page) {
+    if (this->storeMap == nullptr)
+        return nullptr;
+    this->reads.fetch_add(1, std::memory_order_relaxed);
+    return this->storeMap + getStoreOffset(page);
+}
+
+/** getStoreMode
+ * @return How page faults read the backing store.
+ */
+StoreMode FileProcessor::getStoreMode() {
+    return this->storeMode;
+}
+
+/** getReadCount
+ * @return The number of pages read out of the backing store.
+ */
+u_int64_t FileProcessor::getReadCount() {
+    return this->reads.load(std::memory_order_relaxed);
+}
+
+/** setReadCount
+ * Carries the read count over from a restored checkpoint.
+ * @param count The number of pages read out of the backing store.
+ */
+void FileProcessor::setReadCount(u_int64_t count) {
+    this->reads.store(count, std::memory_order_relaxed);
 }
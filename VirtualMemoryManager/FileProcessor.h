@@ -5,28 +5,64 @@
 #ifndef VIRTUALMEMORYMANAGER_FILEPROCESSOR_H
 #define VIRTUALMEMORYMANAGER_FILEPROCESSOR_H
 
+#include <atomic>
 #include <fstream>
+#include <pthread.h>
 #include <string>
 #include <iostream>
 #include <vector>
 #include <cstdlib>
 #include "address.h"
+#include "TraceReader.h"
 
-#define VADDR_SIZE 65536
-#define PAGE_SIZE 256
-#define FRAME_SIZE 256
-#define NUM_FRAMES 256
+// Addresses are handed out of the trace in batches of this many.
+#define TRACE_BATCH_SIZE 4096
+
+// Backing stores up to this size are prefetched whole with MADV_WILLNEED, larger ones are read on demand.
+#define STORE_WILLNEED_LIMIT (64 * 1024 * 1024)
+
+/** StoreMode
+ * How page faults read the backing store.
+ * STORE_STREAM seeks and reads through an fstream, STORE_MMAP copies out of a read-only mapping,
+ * and STORE_ALIAS hands out pointers into the mapping so frames can share it without a copy.
+ * STORE_NONE never opens the backing store, for tools that only read the trace.
+ */
+enum StoreMode {
+    STORE_STREAM,
+    STORE_MMAP,
+    STORE_ALIAS,
+    STORE_NONE
+};
 
 class FileProcessor {
 public:
-    FileProcessor(std::string addrFilePath);
+    FileProcessor(std::string addrFilePath, StoreMode storeMode = STORE_MMAP, const Geometry &geometry = Geometry());
     ~FileProcessor();
-    int processFile(std::vector<Address*> &addrList);
-    void getDataFromStore(u_int8_t page, char* data);
+    int readBatch(Address *batch, int maxCount);
+    int readRawBatch(u_int64_t *values, int maxCount);
+    u_int64_t skipAddresses(u_int64_t count);
+    void getDataFromStore(u_int64_t page, char* data);
+    const char *mapPage(u_int64_t page);
+    StoreMode getStoreMode();
+    u_int64_t getReadCount();
+    void setReadCount(u_int64_t count);
 
 private:
-    std::fstream addrFile;
+    TraceReader *traceReader;
+    std::vector<u_int64_t> rawBatch;
     std::fstream backingStoreFile;
+    // Serializes the seek and read on backingStoreFile when several threads service faults at once.
+    pthread_mutex_t storeLock;
+    // Pages handed out by getDataFromStore or mapPage; faults may be serviced on several threads.
+    std::atomic<u_int64_t> reads;
+    StoreMode storeMode;
+    Geometry geometry;
+    const char *storeMap;
+    size_t storeSize;
+
+    void checkStore(const char *path);
+    void mapStore(const char *path);
+    size_t getStoreOffset(u_int64_t page);
 };
 
 
@@ -0,0 +1,222 @@
+// Metrics.cpp
+// The Histogram class records latencies in log-linear buckets in the style of HdrHistogram, and the Metrics class
+// keeps one histogram per stage of a translation.
+
+#include "Metrics.h"
+
+#include <algorithm>
+#include <cmath>
+
+/** Histogram constructor
+ * Allocates one bucket per sub-range of every power of two up to HISTOGRAM_MAX_BITS.
+ */
+Histogram::Histogram() {
+    counts.assign((size_t)(HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BITS + 1) * SUB_COUNT, 0);
+    clear();
+}
+
+/** bucketIndex
+ * Values below SUB_COUNT get a bucket each; above that, each power of two is split into SUB_COUNT buckets.
+ * @param value The value.
+ * @return The bucket index.
+ */
+int Histogram::bucketIndex(u_int64_t value) {
+    if (value >= (1ull << HISTOGRAM_MAX_BITS))
+        value = (1ull << HISTOGRAM_MAX_BITS) - 1;
+    if (value < (u_int64_t)SUB_COUNT)
+        return (int)value;
+    int shift = 63 - __builtin_clzll(value) - HISTOGRAM_SUB_BITS;
+    return (shift + 1) * SUB_COUNT + (int)((value >> shift) - SUB_COUNT);
+}
+
+/** bucketLow
+ * @param index The bucket index.
+ * @return The smallest value that lands in the bucket.
+ */
+u_int64_t Histogram::bucketLow(int index) {
+    int block = index / SUB_COUNT;
+    if (block == 0)
+        return (u_int64_t)index;
+    return (u_int64_t)(SUB_COUNT + index % SUB_COUNT) << (block - 1);
+}
+
+/** bucketHigh
+ * @param index The bucket index.
+ * @return The largest value that lands in the bucket.
+ */
+u_int64_t Histogram::bucketHigh(int index) {
+    int block = index / SUB_COUNT;
+    if (block <= 1)
+        return bucketLow(index);
+    return bucketLow(index) + (1ull << (block - 1)) - 1;
+}
+
+/** record
+ * Adds one value.
+ * @param value The value.
+ */
+void Histogram::record(u_int64_t value) {
+    counts[bucketIndex(value)]++;
+    count++;
+    sum += value;
+    if (value < min)
+        min = value;
+    if (value > max)
+        max = value;
+}
+
+/** merge
+ * Adds every value recorded in another histogram.
+ * @param other The other histogram.
+ */
+void Histogram::merge(const Histogram &other) {
+    if (other.count == 0)
+        return;
+    for (size_t i = 0; i < counts.size(); i++)
+        counts[i] += other.counts[i];
+    count += other.count;
+    sum += other.sum;
+    if (other.min < min)
+        min = other.min;
+    if (other.max > max)
+        max = other.max;
+}
+
+/** clear
+ * Forgets every recorded value.
+ */
+void Histogram::clear() {
+    std::fill(counts.begin(), counts.end(), 0);
+    count = 0;
+    min = ~0ull;
+    max = 0;
+    sum = 0;
+}
+
+/** getCount
+ * @return The number of recorded values.
+ */
+u_int64_t Histogram::getCount() const {
+    return count;
+}
+
+/** getMin
+ * @return The smallest recorded value, or 0 if there are none.
+ */
+u_int64_t Histogram::getMin() const {
+    return count == 0 ? 0 : min;
+}
+
+/** getMax
+ * @return The largest recorded value.
+ */
+u_int64_t Histogram::getMax() const {
+    return max;
+}
+
+/** getMean
+ * @return The mean of the recorded values, or 0 if there are none.
+ */
+double Histogram::getMean() const {
+    return count == 0 ? 0 : (double)(sum / count);
+}
+
+/** getPercentile
+ * @param percentile The percentile, from 0 to 100.
+ * @return The largest value equivalent to the one at that percentile, clamped to the recorded maximum.
+ */
+u_int64_t Histogram::getPercentile(double percentile) const {
+    if (count == 0)
+        return 0;
+    u_int64_t rank = (u_int64_t)std::ceil(percentile / 100.0 * count);
+    if (rank < 1)
+        rank = 1;
+    u_int64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            u_int64_t high = bucketHigh((int)i);
+            return high < max ? high : max;
+        }
+    }
+    return max;
+}
+
+/** writeJSON
+ * Writes the summary statistics and every non-empty bucket as [lowest value, count] pairs.
+ * @param out The stream to write to.
+ */
+void Histogram::writeJSON(std::ostream &out) const {
+    out << "{\"count\": " << count << ", \"min\": " << getMin() << ", \"max\": " << max
+        << ", \"mean\": " << getMean() << ", \"p50\": " << getPercentile(50) << ", \"p90\": " << getPercentile(90)
+        << ", \"p99\": " << getPercentile(99) << ", \"p999\": " << getPercentile(99.9) << ", \"buckets\": [";
+    bool first = true;
+    for (size_t i = 0; i < counts.size(); i++) {
+        if (counts[i] == 0)
+            continue;
+        out << (first ? "" : ", ") << "[" << bucketLow((int)i) << ", " << counts[i] << "]";
+        first = false;
+    }
+    out << "]}";
+}
+
+/** Metrics constructor
+ */
+Metrics::Metrics() {
+}
+
+/** record
+ * Adds one latency to a stage.
+ * @param stage The stage.
+ * @param nanoseconds The latency.
+ */
+void Metrics::record(MetricStage stage, u_int64_t nanoseconds) {
+    histograms[stage].record(nanoseconds);
+}
+
+/** merge
+ * Adds every latency recorded in another Metrics object, e.g. one filled by a worker thread.
+ * @param other The other metrics.
+ */
+void Metrics::merge(const Metrics &other) {
+    for (int s = 0; s < STAGE_COUNT; s++)
+        histograms[s].merge(other.histograms[s]);
+}
+
+/** clear
+ * Forgets every recorded latency.
+ */
+void Metrics::clear() {
+    for (Histogram &histogram : histograms)
+        histogram.clear();
+}
+
+/** getHistogram
+ * @param stage The stage.
+ * @return The stage's histogram.
+ */
+const Histogram &Metrics::getHistogram(MetricStage stage) const {
+    return histograms[stage];
+}
+
+/** writeJSON
+ * Writes one histogram per stage as a JSON object keyed by stage name.
+ * @param out The stream to write to.
+ */
+void Metrics::writeJSON(std::ostream &out) const {
+    out << "{";
+    for (int s = 0; s < STAGE_COUNT; s++) {
+        out << (s == 0 ? "" : ", ") << "\"" << getStageName((MetricStage)s) << "\": ";
+        histograms[s].writeJSON(out);
+    }
+    out << "}";
+}
+
+/** getStageName
+ * @param stage The stage.
+ * @return The stage's name in JSON output.
+ */
+const char *Metrics::getStageName(MetricStage stage) {
+    const char *names[] = {"tlb_hit", "tlb_miss", "page_walk", "fault_service", "store_read"};
+    return names[stage];
+}
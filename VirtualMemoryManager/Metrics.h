@@ -0,0 +1,75 @@
+// Metrics.h
+// The Histogram class records latencies in log-linear buckets in the style of HdrHistogram, and the Metrics class
+// keeps one histogram per stage of a translation.
+
+#ifndef VIRTUALMEMORYMANAGER_METRICS_H
+#define VIRTUALMEMORYMANAGER_METRICS_H
+
+#include <cstdlib>
+#include <ostream>
+#include <vector>
+
+// Every power of two is split into 2^HISTOGRAM_SUB_BITS buckets, so a recorded value is off by at most ~3%.
+#define HISTOGRAM_SUB_BITS 5
+// Values of 2^HISTOGRAM_MAX_BITS or more (about 18 minutes in nanoseconds) land in the last bucket.
+#define HISTOGRAM_MAX_BITS 40
+
+// Only one in this many TLB lookups and page walks is timed; faults and backing store reads always are.
+// Must be a power of two.
+#define METRICS_SAMPLE_INTERVAL 64
+
+class Histogram {
+public:
+    Histogram();
+    void record(u_int64_t value);
+    void merge(const Histogram &other);
+    void clear();
+    u_int64_t getCount() const;
+    u_int64_t getMin() const;
+    u_int64_t getMax() const;
+    double getMean() const;
+    u_int64_t getPercentile(double percentile) const;
+    void writeJSON(std::ostream &out) const;
+
+private:
+    static const int SUB_COUNT = 1 << HISTOGRAM_SUB_BITS;
+
+    std::vector<u_int64_t> counts;
+    u_int64_t count;
+    u_int64_t min;
+    u_int64_t max;
+    long double sum;
+
+    static int bucketIndex(u_int64_t value);
+    static u_int64_t bucketLow(int index);
+    static u_int64_t bucketHigh(int index);
+};
+
+/** MetricStage
+ * The parts of a translation that are timed.
+ */
+enum MetricStage {
+    STAGE_TLB_HIT,
+    STAGE_TLB_MISS,
+    STAGE_PAGE_WALK,
+    STAGE_FAULT_SERVICE,
+    STAGE_STORE_READ,
+    STAGE_COUNT
+};
+
+class Metrics {
+public:
+    Metrics();
+    void record(MetricStage stage, u_int64_t nanoseconds);
+    void merge(const Metrics &other);
+    void clear();
+    const Histogram &getHistogram(MetricStage stage) const;
+    void writeJSON(std::ostream &out) const;
+    static const char *getStageName(MetricStage stage);
+
+private:
+    Histogram histograms[STAGE_COUNT];
+};
+
+
+#endif //VIRTUALMEMORYMANAGER_METRICS_H
@@ -0,0 +1,207 @@
+// OutputWriter.cpp
+// The OutputWriter class reports translation results through a large buffer that is flushed with few write calls.
+
+#include "OutputWriter.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+/** appendUnsigned
+ * Writes a number in decimal without going through a stream or printf.
+ * @param value The number.
+ * @param out Where to write the digits.
+ * @return A pointer just past the last digit.
+ */
+static char *appendUnsigned(u_int64_t value, char *out) {
+    char digits[20];
+    int length = 0;
+    do {
+        digits[length++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (length > 0)
+        *out++ = digits[--length];
+    return out;
+}
+
+/** appendSigned
+ * Writes a signed number in decimal without going through a stream or printf.
+ * @param value The number.
+ * @param out Where to write the digits.
+ * @return A pointer just past the last digit.
+ */
+static char *appendSigned(int value, char *out) {
+    if (value < 0) {
+        *out++ = '-';
+        return appendUnsigned(0ull - (u_int64_t)value, out);
+    }
+    return appendUnsigned((u_int64_t)value, out);
+}
+
+/** appendLiteral
+ * Copies a string literal without its terminator.
+ * @param text The literal.
+ * @param out Where to write it.
+ * @return A pointer just past the copied text.
+ */
+template <size_t N>
+static char *appendLiteral(const char (&text)[N], char *out) {
+    memcpy(out, text, N - 1);
+    return out + N - 1;
+}
+
+/** OutputWriter constructor
+ * CSV output starts with its column names.
+ * @param mode What to report for every translation.
+ * @param fd The file descriptor to write to.
+ */
+OutputWriter::OutputWriter(OutputMode mode, int fd) {
+    this->fd = fd;
+    this->mode = mode;
+    this->buffer.resize(OUTPUT_BUFFER_SIZE);
+    this->used = 0;
+    if (mode == OUTPUT_CSV)
+        writeBytes("page,offset,frame,byte,tlb,fault\n", 33);
+}
+
+/** OutputWriter destructor
+ * Writes out whatever is still buffered.
+ */
+OutputWriter::~OutputWriter() {
+    flush();
+}
+
+/** formatTranslation
+ * Formats one translation into a caller-supplied buffer. Needs no OutputWriter, so worker threads can format
+ * their share of a batch and hand the bytes over later.
+ * @param mode The output mode.
+ * @param result The translation.
+ * @param out A buffer of at least OUTPUT_MAX_RECORD bytes.
+ * @return The number of bytes written, 0 in OUTPUT_STATS mode.
+ */
+size_t OutputWriter::formatTranslation(OutputMode mode, const Translation &result, char *out) {
+    char *end = out;
+    if (mode == OUTPUT_TEXT) {
+        end = appendLiteral("Translating ", end);
+        end = appendUnsigned(result.page, end);
+        *end++ = ' ';
+        end = appendUnsigned(result.offset, end);
+        end = appendLiteral("... | Frame number: ", end);
+        end = appendSigned(result.frame, end);
+        *end++ = ' ';
+        end = appendUnsigned(result.offset, end);
+        end = appendLiteral(" | Byte: ", end);
+        end = appendSigned(result.value, end);
+        *end++ = '\n';
+    } else if (mode == OUTPUT_CSV) {
+        end = appendUnsigned(result.page, end);
+        *end++ = ',';
+        end = appendUnsigned(result.offset, end);
+        *end++ = ',';
+        end = appendSigned(result.frame, end);
+        *end++ = ',';
+        end = appendSigned(result.value, end);
+        *end++ = ',';
+        *end++ = result.tlbHit ? '1' : '0';
+        *end++ = ',';
+        *end++ = result.pageFault ? '1' : '0';
+        *end++ = '\n';
+    } else if (mode == OUTPUT_BINARY) {
+        OutputRecord record;
+        memset(&record, 0, sizeof(record));
+        record.page = result.page;
+        record.frame = (u_int32_t)result.frame;
+        record.offset = result.offset;
+        record.value = (int8_t)result.value;
+        record.flags = (result.tlbHit ? OUTPUT_FLAG_TLB_HIT : 0) | (result.pageFault ? OUTPUT_FLAG_PAGE_FAULT : 0)
+                | (result.largePage ? OUTPUT_FLAG_LARGE_PAGE : 0);
+        memcpy(end, &record, sizeof(record));
+        end += sizeof(record);
+    }
+    return end - out;
+}
+
+/** writeTranslation
+ * Reports one translation.
+ * @param result The translation.
+ */
+void OutputWriter::writeTranslation(const Translation &result) {
+    if (this->mode == OUTPUT_STATS)
+        return;
+    if (this->buffer.size() - this->used < OUTPUT_MAX_RECORD)
+        flush();
+    this->used += formatTranslation(this->mode, result, this->buffer.data() + this->used);
+}
+
+/** writeBytes
+ * Appends already formatted output.
+ * @param data The bytes.
+ * @param length The number of bytes.
+ */
+void OutputWriter::writeBytes(const char *data, size_t length) {
+    if (this->buffer.size() - this->used < length) {
+        flush();
+        // Anything that would not fit in an empty buffer is written straight through.
+        if (length > this->buffer.size()) {
+            writeAll(data, length);
+            return;
+        }
+    }
+    memcpy(this->buffer.data() + this->used, data, length);
+    this->used += length;
+}
+
+/** flush
+ * Writes the buffered output.
+ */
+void OutputWriter::flush() {
+    writeAll(this->buffer.data(), this->used);
+    this->used = 0;
+}
+
+/** writeAll
+ * Writes bytes to the output file, retrying short and interrupted writes.
+ * @param data The bytes.
+ * @param length The number of bytes.
+ */
+void OutputWriter::writeAll(const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t n = write(this->fd, data, length);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            std::cerr << "Error writing output: " << strerror(errno) << std::endl;
+            exit(1);
+        }
+        data += n;
+        length -= n;
+    }
+}
+
+/** getMode
+ * @return What is reported for every translation.
+ */
+OutputMode OutputWriter::getMode() {
+    return this->mode;
+}
+
+/** parseOutputMode
+ * Converts an output mode name to an OutputMode.
+ * @param name The mode name.
+ * @param mode The parsed mode.
+ * @return True if the name is a known mode.
+ */
+bool parseOutputMode(const char *name, OutputMode &mode) {
+    if (strcmp(name, "text") == 0)
+        mode = OUTPUT_TEXT;
+    else if (strcmp(name, "csv") == 0)
+        mode = OUTPUT_CSV;
+    else if (strcmp(name, "binary") == 0)
+        mode = OUTPUT_BINARY;
+    else if (strcmp(name, "stats") == 0)
+        mode = OUTPUT_STATS;
+    else
+        return false;
+    return true;
+}
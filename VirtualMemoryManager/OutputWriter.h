@@ -0,0 +1,73 @@
+// OutputWriter.h
+// The OutputWriter class reports translation results through a large buffer that is flushed with few write calls.
+
+#ifndef VIRTUALMEMORYMANAGER_OUTPUTWRITER_H
+#define VIRTUALMEMORYMANAGER_OUTPUTWRITER_H
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "Translator.h"
+
+// Output is collected in a buffer of this many bytes before each write.
+#define OUTPUT_BUFFER_SIZE (1024 * 1024)
+
+// No single formatted translation is longer than this many bytes.
+#define OUTPUT_MAX_RECORD 128
+
+// Bits of OutputRecord::flags.
+#define OUTPUT_FLAG_TLB_HIT 0x01
+#define OUTPUT_FLAG_PAGE_FAULT 0x02
+#define OUTPUT_FLAG_LARGE_PAGE 0x04
+
+/** OutputMode
+ * What is reported for every translated address.
+ * OUTPUT_TEXT is the human readable line, OUTPUT_CSV is one page,offset,frame,byte,tlb,fault row,
+ * OUTPUT_BINARY is one OutputRecord, and OUTPUT_STATS reports nothing but the final statistics.
+ */
+enum OutputMode {
+    OUTPUT_TEXT,
+    OUTPUT_CSV,
+    OUTPUT_BINARY,
+    OUTPUT_STATS
+};
+
+/** OutputRecord
+ * One translation in OUTPUT_BINARY mode, in host byte order.
+ */
+struct OutputRecord {
+    u_int64_t page;
+    u_int32_t frame;
+    u_int32_t offset;
+    int8_t value;
+    u_int8_t flags;
+    u_int8_t reserved[6];
+};
+
+static_assert(sizeof(OutputRecord) == 24, "OutputRecord must be 24 bytes");
+
+class OutputWriter {
+public:
+    OutputWriter(OutputMode mode, int fd = STDOUT_FILENO);
+    ~OutputWriter();
+    void writeTranslation(const Translation &result);
+    void writeBytes(const char *data, size_t length);
+    void flush();
+    OutputMode getMode();
+    static size_t formatTranslation(OutputMode mode, const Translation &result, char *out);
+
+private:
+    int fd;
+    OutputMode mode;
+    std::vector<char> buffer;
+    size_t used;
+
+    void writeAll(const char *data, size_t length);
+};
+
+bool parseOutputMode(const char *name, OutputMode &mode);
+
+
+#endif //VIRTUALMEMORYMANAGER_OUTPUTWRITER_H
@@ -1,19 +1,153 @@
 // PageTable.cpp
 // Created by Brian Cassriel on 5/7/24.
-// The PageTable class is a simple hash map that maps page numbers to frame numbers.
+// The PageTable classes map page numbers to frame numbers with a direct, multi-level radix, hashed or
+// inverted table.
 
 #include "PageTable.h"
 
+#include "Checkpoint.h"
+
+/** hashPage
+ * Fibonacci hashing: the top bits of the product are well mixed even for runs of consecutive pages.
+ * @param page The page number.
+ * @param shift 64 minus the number of bits wanted.
+ * @return The hash, below 2^(64 - shift).
+ */
+static inline size_t hashPage(u_int64_t page, int shift) {
+    return (size_t)((page * 0x9E3779B97F4A7C15ull) >> shift);
+}
+
+/** log2Ceiling
+ * @param count A positive count.
+ * @return The smallest b with 2^b >= count.
+ */
+static int log2Ceiling(u_int64_t count) {
+    int bits = 0;
+    while ((1ull << bits) < count)
+        bits++;
+    return bits;
+}
+
+/** createPageTable
+ * Builds a page table by name.
+ * @param name The page table name: direct, radix, hashed or inverted.
+ * @param pageBits The number of bits in a page number.
+ * @param frameCount The number of physical frames, which sizes an inverted table.
+ * @param levels The number of radix levels, or 0 to pick them with levelsFor.
+ * @return The page table, or nullptr if the name is not known or does not fit the page size.
+ */
+PageTable *createPageTable(const std::string &name, int pageBits, int frameCount, int levels) {
+    if (name == "direct" && pageBits <= DIRECT_MAX_PAGE_BITS)
+        return new DirectPageTable(pageBits);
+    if (name == "radix" && levels >= 0 && levels <= MAX_PAGE_TABLE_LEVELS) {
+        if (levels == 0)
+            levels = PageTable::levelsFor(pageBits);
+        if (RadixPageTable::topLevelBits(pageBits, levels) <= RADIX_MAX_LEVEL_BITS)
+            return new RadixPageTable(pageBits, levels);
+    }
+    if (name == "hashed")
+        return new HashedPageTable();
+    if (name == "inverted" && frameCount > 0)
+        return new InvertedPageTable(frameCount);
+    return nullptr;
+}
+
 /** PageTable constructor
- * Initializes the pageFaults counter.
+ * Starts the lookup and fault counts at 0.
  */
 PageTable::PageTable() {
     pageFaults = 0;
+    lookups = 0;
+}
+
+/** lookup
+ * Looks a page up on a page walk, counting a fault if it is not mapped.
+ * @param page The page number.
+ * @return The frame number, or -1 if the page is not mapped.
+ */
+int PageTable::lookup(u_int64_t page) {
+    lookups++;
+    int frame = getFrame(page);
+    if (frame == -1)
+        pageFaults++;
+    return frame;
+}
+
+/** containsPage
+ * Checks if the page table contains a given page number, counting it like lookup.
+ * @param page The page number.
+ * @return True if the page is in the table, false otherwise.
+ */
+bool PageTable::containsPage(u_int64_t page) {
+    return lookup(page) != -1;
+}
+
+/** getFaultCount
+ * @return The number of lookups that found no mapping.
+ */
+long long PageTable::getFaultCount() {
+    return pageFaults;
+}
+
+/** getLookupCount
+ * @return The number of lookups made through lookup or containsPage.
+ */
+long long PageTable::getLookupCount() {
+    return lookups;
 }
 
-/** PageTable destructor
+/** getFaultRate
+ * Gets the page fault rate.
+ * @return The fraction of lookups that faulted, or 0 before the first lookup.
+ */
+double PageTable::getFaultRate() {
+    return lookups == 0 ? 0 : (double)pageFaults / lookups;
+}
+
+/** saveState
+ * Writes the lookup and fault counts. The entries themselves are not written: they are exactly the resident
+ * pages, which the translator maps again from physical memory on restore, into a table of any kind.
+ * @param out The checkpoint being written.
  */
-PageTable::~PageTable() {
+void PageTable::saveState(CheckpointWriter &out) {
+    out.beginSection("PGTB");
+    out.put(pageFaults);
+    out.put(lookups);
+}
+
+/** loadState
+ * Restores the counts saveState wrote.
+ * @param in The checkpoint being read.
+ * @return True if they were read.
+ */
+bool PageTable::loadState(CheckpointReader &in) {
+    if (!in.expectSection("PGTB"))
+        return false;
+    pageFaults = (long long)in.get();
+    lookups = (long long)in.get();
+    return in.isValid();
+}
+
+/** levelsFor
+ * Picks a level count that keeps every node at 2^14 entries or fewer, so a sparse wide address space
+ * only allocates nodes around the pages it maps. Narrow page numbers stay a single flat array.
+ * @param pageBits The number of bits in a page number.
+ * @return The number of levels.
+ */
+int PageTable::levelsFor(int pageBits) {
+    int levels = (pageBits + 13) / 14;
+    if (levels < 1)
+        return 1;
+    return levels > MAX_PAGE_TABLE_LEVELS ? MAX_PAGE_TABLE_LEVELS : levels;
+}
+
+/** DirectPageTable constructor
+ * Allocates an entry for every page up front.
+ * @param pageBits The number of bits in a page number.
+ */
+DirectPageTable::DirectPageTable(int pageBits) {
+    this->mask = (1ull << pageBits) - 1;
+    this->entries.assign((size_t)this->mask + 1, 0);
 }
 
 /** addEntry
@@ -21,37 +155,386 @@ PageTable::~PageTable() {
  * @param page The page number.
  * @param frame The frame number.
  */
-void PageTable::addEntry(u_int8_t page, u_int8_t frame) {
-    pageTable[page] = frame;
+void DirectPageTable::addEntry(u_int64_t page, u_int32_t frame) {
+    entries[page & mask] = frame | VALID_BIT;
+}
+
+/** removeEntry
+ * Invalidates the entry for a page, e.g. when its frame is evicted.
+ * @param page The page number.
+ */
+void DirectPageTable::removeEntry(u_int64_t page) {
+    entries[page & mask] = 0;
 }
 
 /** getFrame
- * Gets the frame number for a given page number.
  * @param page The page number.
- * @return The frame number.
+ * @return The frame number, or -1 if the page is not mapped.
  */
-int PageTable::getFrame(u_int8_t page) {
-    return pageTable[page];
+int DirectPageTable::getFrame(u_int64_t page) {
+    u_int32_t entry = entries[page & mask];
+    return (entry & VALID_BIT) ? (int)(entry & ~VALID_BIT) : -1;
 }
 
-/** containsPage
- * Checks if the page table contains a given page number.
+/** getMemoryUsage
+ * @return The number of bytes held by the entry array.
+ */
+size_t DirectPageTable::getMemoryUsage() {
+    return entries.capacity() * sizeof(u_int32_t);
+}
+
+/** clampLevels
+ * @param pageBits The number of bits in a page number.
+ * @param levels The number of levels asked for.
+ * @return The number of levels a radix table really uses: 1 to MAX_PAGE_TABLE_LEVELS, and no more than pageBits.
+ */
+static int clampLevels(int pageBits, int levels) {
+    if (levels < 1)
+        levels = 1;
+    if (levels > MAX_PAGE_TABLE_LEVELS)
+        levels = MAX_PAGE_TABLE_LEVELS;
+    if (levels > pageBits && pageBits > 0)
+        levels = pageBits;
+    return levels;
+}
+
+/** topLevelBits
+ * Gets how many page number bits index the top level, which is the widest: every lower level takes
+ * pageBits / levels bits and the top level takes the rest.
+ * @param pageBits The number of bits in a page number.
+ * @param levels The number of levels asked for.
+ * @return The number of bits.
+ */
+int RadixPageTable::topLevelBits(int pageBits, int levels) {
+    levels = clampLevels(pageBits, levels);
+    return pageBits - (levels - 1) * (pageBits / levels);
+}
+
+/** RadixPageTable constructor
+ * Splits the page number into one index per level and allocates the top-level node.
+ * With one level the whole page space is a single flat array, so a lookup is one load.
+ * With two or three levels lower nodes are only allocated when a page under them is mapped.
+ * @param pageBits The number of bits in a page number.
+ * @param levels The number of levels in the table (1 to MAX_PAGE_TABLE_LEVELS).
+ */
+RadixPageTable::RadixPageTable(int pageBits, int levels) {
+    levels = clampLevels(pageBits, levels);
+    this->levels = levels;
+
+    // The top level absorbs any bits that do not divide evenly.
+    int shift = 0;
+    for (int l = levels - 1; l >= 0; l--) {
+        int bits = l == 0 ? topLevelBits(pageBits, levels) : pageBits / levels;
+        shifts[l] = shift;
+        masks[l] = (1ull << bits) - 1;
+        shift += bits;
+    }
+
+    if (levels == 1)
+        leaves.assign((size_t)masks[0] + 1, 0);
+    else
+        directories[0].assign((size_t)masks[0] + 1, -1);
+}
+
+/** findEntry
+ * Walks the table to the leaf entry for a page.
  * @param page The page number.
- * @return True if the page is in the table, false otherwise.
+ * @param create Whether missing nodes along the walk should be allocated.
+ * @param path If not nullptr, path[l] is set to the slot taken in directories[l] at each directory level.
+ * @return A pointer to the leaf entry, or nullptr if the walk hit a missing node and create is false.
  */
-bool PageTable::containsPage(u_int8_t page) {
-    if (pageTable.find(page) != pageTable.end())
-        return true;
-    else {
-        pageFaults++;
-        return false;
+u_int32_t *RadixPageTable::findEntry(u_int64_t page, bool create, size_t *path) {
+    if (levels == 1)
+        return &leaves[page & masks[0]];
+
+    int node = 0;
+    for (int l = 0; l < levels - 1; l++) {
+        size_t slot = (size_t)node * (masks[l] + 1) + ((page >> shifts[l]) & masks[l]);
+        int child = directories[l][slot];
+        if (child == -1) {
+            if (!create)
+                return nullptr;
+            child = allocateNode(l + 1);
+            directories[l][slot] = child;
+            if (l > 0)
+                used[l][node]++;
+        }
+        if (path != nullptr)
+            path[l] = slot;
+        node = child;
     }
+    int last = levels - 1;
+    return &leaves[(size_t)node * (masks[last] + 1) + (page & masks[last])];
 }
 
-/** getFaultRate
- * Gets the page fault rate.
- * @return The page fault rate.
+/** allocateNode
+ * Takes an empty node for a level below the top, reusing a freed one if there is one.
+ * @param level The level, 1 to levels - 1.
+ * @return The node's index within its level.
  */
-int PageTable::getFaultRate() {
-    return pageFaults;
+int RadixPageTable::allocateNode(int level) {
+    if (!freeNodes[level].empty()) {
+        int node = freeNodes[level].back();
+        freeNodes[level].pop_back();
+        return node;
+    }
+    size_t nodeSize = (size_t)masks[level] + 1;
+    if (level < levels - 1)
+        directories[level].resize(directories[level].size() + nodeSize, -1);
+    else
+        leaves.resize(leaves.size() + nodeSize, 0);
+    used[level].push_back(0);
+    return (int)used[level].size() - 1;
+}
+
+/** addEntry
+ * Adds a page/frame entry to the page table.
+ * @param page The page number.
+ * @param frame The frame number.
+ */
+void RadixPageTable::addEntry(u_int64_t page, u_int32_t frame) {
+    size_t path[MAX_PAGE_TABLE_LEVELS];
+    u_int32_t *entry = findEntry(page, true, path);
+    if (levels > 1 && !(*entry & VALID_BIT))
+        used[levels - 1][directories[levels - 2][path[levels - 2]]]++;
+    *entry = frame | VALID_BIT;
+}
+
+/** removeEntry
+ * Invalidates the entry for a page, e.g. when its frame is evicted. A node left with nothing mapped under it
+ * is unlinked and kept for reuse, so the table stays in proportion to the resident pages however sparse the
+ * address space is. The top-level node is never freed.
+ * @param page The page number.
+ */
+void RadixPageTable::removeEntry(u_int64_t page) {
+    size_t path[MAX_PAGE_TABLE_LEVELS];
+    u_int32_t *entry = findEntry(page, false, path);
+    if (entry == nullptr || !(*entry & VALID_BIT))
+        return;
+    *entry = 0;
+    for (int l = levels - 1; l > 0; l--) {
+        int node = directories[l - 1][path[l - 1]];
+        if (--used[l][node] > 0)
+            return;
+        freeNodes[l].push_back(node);
+        directories[l - 1][path[l - 1]] = -1;
+    }
+}
+
+/** getFrame
+ * Gets the frame number for a given page number without modifying the table.
+ * @param page The page number.
+ * @return The frame number, or -1 if the page is not mapped.
+ */
+int RadixPageTable::getFrame(u_int64_t page) {
+    u_int32_t *entry = findEntry(page, false);
+    if (entry == nullptr || !(*entry & VALID_BIT))
+        return -1;
+    return (int)(*entry & ~VALID_BIT);
+}
+
+/** getMemoryUsage
+ * Gets the number of bytes held by the table's nodes.
+ * @return The memory usage in bytes.
+ */
+size_t RadixPageTable::getMemoryUsage() {
+    size_t bytes = leaves.capacity() * sizeof(u_int32_t);
+    for (int l = 0; l < levels - 1; l++)
+        bytes += directories[l].capacity() * sizeof(int);
+    for (int l = 1; l < levels; l++)
+        bytes += (used[l].capacity() + freeNodes[l].capacity()) * sizeof(int);
+    return bytes;
+}
+
+/** getLevelCount
+ * @return The number of levels in the table.
+ */
+int RadixPageTable::getLevelCount() {
+    return levels;
+}
+
+/** HashedPageTable constructor
+ * @param slots The initial number of slots, rounded up to a power of two.
+ */
+HashedPageTable::HashedPageTable(int slots) {
+    int bits = log2Ceiling(slots < 2 ? 2 : (u_int64_t)slots);
+    this->mask = ((size_t)1 << bits) - 1;
+    this->hashShift = 64 - bits;
+    this->pages.assign(this->mask + 1, 0);
+    this->frames.assign(this->mask + 1, 0);
+    this->used = 0;
+}
+
+/** homeSlot
+ * @param page The page number.
+ * @return The slot the page hashes to.
+ */
+size_t HashedPageTable::homeSlot(u_int64_t page) {
+    return hashPage(page, hashShift);
+}
+
+/** findSlot
+ * Probes from the page's home slot.
+ * @param page The page number.
+ * @return The slot holding the page, or the empty slot that ends its probe sequence.
+ */
+size_t HashedPageTable::findSlot(u_int64_t page) {
+    size_t slot = homeSlot(page);
+    while ((frames[slot] & VALID_BIT) && pages[slot] != page)
+        slot = (slot + 1) & mask;
+    return slot;
+}
+
+/** grow
+ * Doubles the number of slots and reinserts every entry.
+ */
+void HashedPageTable::grow() {
+    std::vector<u_int64_t> oldPages;
+    std::vector<u_int32_t> oldFrames;
+    oldPages.swap(pages);
+    oldFrames.swap(frames);
+    mask = mask * 2 + 1;
+    hashShift--;
+    pages.assign(mask + 1, 0);
+    frames.assign(mask + 1, 0);
+    for (size_t i = 0; i < oldFrames.size(); i++) {
+        if (oldFrames[i] & VALID_BIT) {
+            size_t slot = findSlot(oldPages[i]);
+            pages[slot] = oldPages[i];
+            frames[slot] = oldFrames[i];
+        }
+    }
+}
+
+/** addEntry
+ * Adds a page/frame entry to the page table, growing it once it would be more than half full.
+ * @param page The page number.
+ * @param frame The frame number.
+ */
+void HashedPageTable::addEntry(u_int64_t page, u_int32_t frame) {
+    size_t slot = findSlot(page);
+    if (!(frames[slot] & VALID_BIT)) {
+        if ((used + 1) * 2 > mask + 1) {
+            grow();
+            slot = findSlot(page);
+        }
+        used++;
+        pages[slot] = page;
+    }
+    frames[slot] = frame | VALID_BIT;
+}
+
+/** removeEntry
+ * Removes the entry for a page, shifting back any later entry of the probe run that would otherwise be
+ * cut off from its home slot.
+ * @param page The page number.
+ */
+void HashedPageTable::removeEntry(u_int64_t page) {
+    size_t hole = findSlot(page);
+    if (!(frames[hole] & VALID_BIT))
+        return;
+    used--;
+    for (size_t slot = (hole + 1) & mask; frames[slot] & VALID_BIT; slot = (slot + 1) & mask) {
+        // The entry may move into the hole only if its home slot is not between the hole and itself.
+        size_t home = homeSlot(pages[slot]);
+        if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+            pages[hole] = pages[slot];
+            frames[hole] = frames[slot];
+            hole = slot;
+        }
+    }
+    frames[hole] = 0;
+}
+
+/** getFrame
+ * @param page The page number.
+ * @return The frame number, or -1 if the page is not mapped.
+ */
+int HashedPageTable::getFrame(u_int64_t page) {
+    u_int32_t entry = frames[findSlot(page)];
+    return (entry & VALID_BIT) ? (int)(entry & ~VALID_BIT) : -1;
+}
+
+/** getMemoryUsage
+ * @return The number of bytes held by the slots.
+ */
+size_t HashedPageTable::getMemoryUsage() {
+    return pages.capacity() * sizeof(u_int64_t) + frames.capacity() * sizeof(u_int32_t);
+}
+
+/** InvertedPageTable constructor
+ * Allocates one entry per frame and at least as many hash chains as frames.
+ * @param frameCount The number of physical frames.
+ */
+InvertedPageTable::InvertedPageTable(int frameCount) {
+    int bits = log2Ceiling(frameCount < 2 ? 2 : (u_int64_t)frameCount);
+    this->anchorShift = 64 - bits;
+    this->framePages.assign(frameCount, 0);
+    this->next.assign(frameCount, -1);
+    this->anchors.assign((size_t)1 << bits, -1);
+}
+
+/** anchorFor
+ * @param page The page number.
+ * @return The hash chain the page belongs to.
+ */
+size_t InvertedPageTable::anchorFor(u_int64_t page) {
+    return hashPage(page, anchorShift);
+}
+
+/** addEntry
+ * Records that a frame holds a page. If the page was mapped to another frame, or the frame held another page,
+ * those entries are dropped first.
+ * @param page The page number.
+ * @param frame The frame number, below the frame count.
+ */
+void InvertedPageTable::addEntry(u_int64_t page, u_int32_t frame) {
+    if (framePages[frame] == (page | MAPPED_BIT))
+        return;
+    removeEntry(page);
+    if (framePages[frame] & MAPPED_BIT)
+        removeEntry(framePages[frame] & ~MAPPED_BIT);
+    size_t anchor = anchorFor(page);
+    framePages[frame] = page | MAPPED_BIT;
+    next[frame] = anchors[anchor];
+    anchors[anchor] = (int)frame;
+}
+
+/** removeEntry
+ * Unlinks the frame holding a page from its hash chain.
+ * @param page The page number.
+ */
+void InvertedPageTable::removeEntry(u_int64_t page) {
+    int *link = &anchors[anchorFor(page)];
+    while (*link != -1) {
+        int frame = *link;
+        if (framePages[frame] == (page | MAPPED_BIT)) {
+            *link = next[frame];
+            framePages[frame] = 0;
+            next[frame] = -1;
+            return;
+        }
+        link = &next[frame];
+    }
+}
+
+/** getFrame
+ * Follows the page's hash chain to the frame holding it.
+ * @param page The page number.
+ * @return The frame number, or -1 if the page is not mapped.
+ */
+int InvertedPageTable::getFrame(u_int64_t page) {
+    for (int frame = anchors[anchorFor(page)]; frame != -1; frame = next[frame]) {
+        if (framePages[frame] == (page | MAPPED_BIT))
+            return frame;
+    }
+    return -1;
+}
+
+/** getMemoryUsage
+ * @return The number of bytes held by the frame entries and the anchor table.
+ */
+size_t InvertedPageTable::getMemoryUsage() {
+    return framePages.capacity() * sizeof(u_int64_t) + next.capacity() * sizeof(int) +
+           anchors.capacity() * sizeof(int);
 }
@@ -1,25 +1,160 @@
 // PageTable.h
 // Created by Brian Cassriel on 5/7/24.
-// The PageTable class is a simple hash map that maps page numbers to frame numbers.
+// The PageTable classes map page numbers to frame numbers. PageTable is the interface the translator walks, and
+// it counts lookups and faults; DirectPageTable, RadixPageTable, HashedPageTable and InvertedPageTable trade
+// memory for lookup cost in different ways.
 
 #ifndef VIRTUALMEMORYMANAGER_PAGETABLE_H
 #define VIRTUALMEMORYMANAGER_PAGETABLE_H
 
-#include <map>
 #include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "address.h"
+
+class CheckpointWriter;
+class CheckpointReader;
+
+#define MAX_PAGE_TABLE_LEVELS 3
+// A direct table holds an entry for every page, so it is limited to 2^24 entries (64 MiB).
+#define DIRECT_MAX_PAGE_BITS 24
+// Each radix node is a flat array too, so no level may index more than 2^24 entries either.
+#define RADIX_MAX_LEVEL_BITS DIRECT_MAX_PAGE_BITS
+// A hashed table starts with this many slots and doubles whenever it gets half full.
+#define HASHED_INITIAL_SLOTS 1024
 
 class PageTable {
 public:
+    virtual ~PageTable() {}
+    virtual const char *getName() = 0;
+    virtual void addEntry(u_int64_t page, u_int32_t frame) = 0;
+    virtual void removeEntry(u_int64_t page) = 0;
+    // Looks a page up without counting it as a lookup; -1 if it is not mapped.
+    virtual int getFrame(u_int64_t page) = 0;
+    virtual size_t getMemoryUsage() = 0;
+    int lookup(u_int64_t page);
+    bool containsPage(u_int64_t page);
+    long long getFaultCount();
+    long long getLookupCount();
+    double getFaultRate();
+    void saveState(CheckpointWriter &out);
+    bool loadState(CheckpointReader &in);
+    static int levelsFor(int pageBits);
+
+protected:
     PageTable();
-    ~PageTable();
-    void addEntry(u_int8_t page, u_int8_t frame);
-    int getFrame(u_int8_t page);
-    bool containsPage(u_int8_t page);
-    int getFaultRate();
+
+    // Entries hold the frame number with VALID_BIT set once the page is mapped.
+    static const u_int32_t VALID_BIT = 0x80000000u;
+
+private:
+    long long pageFaults;
+    long long lookups;
+};
+
+PageTable *createPageTable(const std::string &name, int pageBits, int frameCount, int levels = 0);
+
+/** DirectPageTable
+ * One flat array with an entry for every page, so a lookup is a single load.
+ */
+class DirectPageTable : public PageTable {
+public:
+    DirectPageTable(int pageBits = PAGE_BITS);
+    const char *getName() override { return "direct"; }
+    void addEntry(u_int64_t page, u_int32_t frame) override;
+    void removeEntry(u_int64_t page) override;
+    int getFrame(u_int64_t page) override;
+    size_t getMemoryUsage() override;
+
+private:
+    std::vector<u_int32_t> entries;
+    u_int64_t mask;
+};
+
+/** RadixPageTable
+ * A multi-level table whose lower nodes are only allocated when a page under them is mapped, and are
+ * reused once every page under them is unmapped again. With one level it is a flat array like DirectPageTable.
+ */
+class RadixPageTable : public PageTable {
+public:
+    RadixPageTable(int pageBits = PAGE_BITS, int levels = 1);
+    const char *getName() override { return "radix"; }
+    void addEntry(u_int64_t page, u_int32_t frame) override;
+    void removeEntry(u_int64_t page) override;
+    int getFrame(u_int64_t page) override;
+    size_t getMemoryUsage() override;
+    int getLevelCount();
+    static int topLevelBits(int pageBits, int levels);
+
+private:
+    int levels;
+    int shifts[MAX_PAGE_TABLE_LEVELS];
+    u_int64_t masks[MAX_PAGE_TABLE_LEVELS];
+    // directories[l] holds every level-l node back to back; each slot is a child node index or -1.
+    std::vector<int> directories[MAX_PAGE_TABLE_LEVELS - 1];
+    std::vector<u_int32_t> leaves;
+    // For each node below the top level, how many of its slots are in use. A node that empties goes on its
+    // level's free list and is handed out again before the level grows.
+    std::vector<int> used[MAX_PAGE_TABLE_LEVELS];
+    std::vector<int> freeNodes[MAX_PAGE_TABLE_LEVELS];
+
+    u_int32_t *findEntry(u_int64_t page, bool create, size_t *path = nullptr);
+    int allocateNode(int level);
+};
+
+/** HashedPageTable
+ * An open addressing hash table with linear probing over the mapped pages only, so its size follows the
+ * number of resident pages rather than the width of the address space. Removals shift later entries back
+ * instead of leaving tombstones.
+ */
+class HashedPageTable : public PageTable {
+public:
+    HashedPageTable(int slots = HASHED_INITIAL_SLOTS);
+    const char *getName() override { return "hashed"; }
+    void addEntry(u_int64_t page, u_int32_t frame) override;
+    void removeEntry(u_int64_t page) override;
+    int getFrame(u_int64_t page) override;
+    size_t getMemoryUsage() override;
 
 private:
-    std::map<u_int8_t, u_int8_t> pageTable;
-    int pageFaults;
+    std::vector<u_int64_t> pages;
+    // A slot is in use while its frame has VALID_BIT set.
+    std::vector<u_int32_t> frames;
+    size_t mask;
+    int hashShift;
+    size_t used;
+
+    size_t homeSlot(u_int64_t page);
+    size_t findSlot(u_int64_t page);
+    void grow();
+};
+
+/** InvertedPageTable
+ * One entry per physical frame naming the page it holds, with a hash anchor table chaining together the
+ * frames whose pages hash alike. Its size follows the number of frames no matter how wide pages are.
+ */
+class InvertedPageTable : public PageTable {
+public:
+    InvertedPageTable(int frameCount);
+    const char *getName() override { return "inverted"; }
+    void addEntry(u_int64_t page, u_int32_t frame) override;
+    void removeEntry(u_int64_t page) override;
+    int getFrame(u_int64_t page) override;
+    size_t getMemoryUsage() override;
+
+private:
+    // A frame's entry is its page with MAPPED_BIT set, or 0 while the frame maps nothing.
+    static const u_int64_t MAPPED_BIT = 1ull << 63;
+
+    std::vector<u_int64_t> framePages;
+    // The next frame in the same hash chain, or -1.
+    std::vector<int> next;
+    // The first frame of each hash chain, or -1.
+    std::vector<int> anchors;
+    int anchorShift;
+
+    size_t anchorFor(u_int64_t page);
 };
 
 
@@ -0,0 +1,169 @@
+// ParallelTranslator.cpp
+// The ParallelTranslator class spreads the backing store loads, byte reads and output formatting of a batch
+// of translations over a pool of pthreads, while the Translator resolves every address in trace order.
+
+#include "ParallelTranslator.h"
+
+/** ParallelTranslator constructor
+ * Starts threadCount - 1 pool threads; the calling thread does the first share of every sub-batch itself.
+ * @param translator The translator that resolves addresses.
+ * @param mode How the workers format each translation.
+ * @param frameCount The number of frames in physical memory.
+ * @param threadCount The total number of threads to translate with.
+ */
+ParallelTranslator::ParallelTranslator(Translator *translator, OutputMode mode, int frameCount, int threadCount) {
+    this->translator = translator;
+    this->mode = mode;
+    this->threadCount = threadCount < 1 ? 1 : threadCount;
+    this->stopping = false;
+    this->results.resize(TRACE_BATCH_SIZE);
+    this->frameEpochs.assign(frameCount, 0);
+    this->epoch = 0;
+    this->rangeBegin = 0;
+    this->rangeEnd = 0;
+
+    pthread_barrier_init(&startBarrier, nullptr, this->threadCount);
+    pthread_barrier_init(&loadBarrier, nullptr, this->threadCount);
+    pthread_barrier_init(&endBarrier, nullptr, this->threadCount);
+
+    workers.resize(this->threadCount);
+    for (int i = 0; i < this->threadCount; i++) {
+        workers[i].owner = this;
+        workers[i].index = i;
+        workers[i].faultTime = 0;
+    }
+    for (int i = 1; i < this->threadCount; i++)
+        pthread_create(&workers[i].thread, nullptr, runWorker, &workers[i]);
+}
+
+/** ParallelTranslator destructor
+ * Releases the pool threads from the start barrier with the stop flag set and joins them.
+ */
+ParallelTranslator::~ParallelTranslator() {
+    stopping = true;
+    if (threadCount > 1)
+        pthread_barrier_wait(&startBarrier);
+    for (int i = 1; i < threadCount; i++)
+        pthread_join(workers[i].thread, nullptr);
+    pthread_barrier_destroy(&startBarrier);
+    pthread_barrier_destroy(&loadBarrier);
+    pthread_barrier_destroy(&endBarrier);
+}
+
+/** runWorker
+ * Entry point of a pool thread: waits for a sub-batch, loads its faults, waits for every other share to
+ * finish loading, then reads and formats its share.
+ * @param param The Worker this thread runs.
+ * @return nullptr
+ */
+void *ParallelTranslator::runWorker(void *param) {
+    Worker *worker = (Worker *)param;
+    ParallelTranslator *owner = worker->owner;
+    while (true) {
+        pthread_barrier_wait(&owner->startBarrier);
+        if (owner->stopping)
+            break;
+        owner->runShare(*worker, true);
+        pthread_barrier_wait(&owner->loadBarrier);
+        owner->runShare(*worker, false);
+        pthread_barrier_wait(&owner->endBarrier);
+    }
+    pthread_exit(nullptr);
+}
+
+/** runShare
+ * Processes one worker's slice of the current sub-batch.
+ * @param worker The worker.
+ * @param loading True to fill faulted frames, false to read bytes and format output.
+ */
+void ParallelTranslator::runShare(Worker &worker, bool loading) {
+    int length = rangeEnd - rangeBegin;
+    int begin = rangeBegin + (int)((long long)length * worker.index / threadCount);
+    int end = rangeBegin + (int)((long long)length * (worker.index + 1) / threadCount);
+    runRange(worker, begin, end, loading);
+}
+
+/** runRange
+ * Processes a range of resolved translations.
+ * @param worker The worker doing the work.
+ * @param begin The first translation.
+ * @param end One past the last translation.
+ * @param loading True to fill faulted frames, false to read bytes and format output.
+ */
+void ParallelTranslator::runRange(Worker &worker, int begin, int end, bool loading) {
+    for (int i = begin; i < end; i++) {
+        if (loading) {
+            if (results[i].pageFault) {
+                long long loadTime = translator->load(results[i]);
+                worker.faultTime += loadTime;
+                worker.metrics.record(STAGE_STORE_READ, loadTime);
+            }
+        } else {
+            char record[OUTPUT_MAX_RECORD];
+            translator->read(results[i]);
+            worker.output.append(record, OutputWriter::formatTranslation(mode, results[i], record));
+        }
+    }
+}
+
+/** dispatch
+ * Loads, reads and formats the resolved translations in [begin, end) and reports them in order.
+ * @param begin The first translation.
+ * @param end One past the last translation.
+ * @param writer The writer to report the translations to.
+ */
+void ParallelTranslator::dispatch(int begin, int end, OutputWriter &writer) {
+    if (begin == end)
+        return;
+    rangeBegin = begin;
+    rangeEnd = end;
+    if (threadCount == 1 || end - begin < PARALLEL_MIN_RANGE) {
+        runRange(workers[0], begin, end, true);
+        runRange(workers[0], begin, end, false);
+    } else {
+        pthread_barrier_wait(&startBarrier);
+        runShare(workers[0], true);
+        pthread_barrier_wait(&loadBarrier);
+        runShare(workers[0], false);
+        pthread_barrier_wait(&endBarrier);
+    }
+    for (Worker &worker : workers) {
+        writer.writeBytes(worker.output.data(), worker.output.size());
+        worker.output.clear();
+        translator->addFaultTime(worker.faultTime);
+        worker.faultTime = 0;
+    }
+}
+
+/** translateBatch
+ * Resolves every address in trace order, cutting the batch into sub-batches wherever a fault reuses a frame
+ * the current sub-batch already touched, and hands each sub-batch to the pool.
+ * @param batch The addresses.
+ * @param count The number of addresses.
+ * @param writer The writer to report the translations to.
+ */
+void ParallelTranslator::translateBatch(const Address *batch, int count, OutputWriter &writer) {
+    int begin = 0;
+    epoch++;
+    for (int i = 0; i < count; i++) {
+        translator->resolve(batch[i], results[i]);
+        int frame = results[i].frame;
+        if (results[i].pageFault && frameEpochs[frame] == epoch) {
+            dispatch(begin, i, writer);
+            begin = i;
+            epoch++;
+        }
+        frameEpochs[frame] = epoch;
+    }
+    dispatch(begin, count, writer);
+}
+
+/** collectMetrics
+ * Merges the latencies the workers recorded into the translator's metrics. Only call between batches.
+ */
+void ParallelTranslator::collectMetrics() {
+    for (Worker &worker : workers) {
+        translator->getMetrics().merge(worker.metrics);
+        worker.metrics.clear();
+    }
+}
@@ -0,0 +1,63 @@
+// ParallelTranslator.h
+// The ParallelTranslator class spreads the backing store loads, byte reads and output formatting of a batch
+// of translations over a pool of pthreads, while the Translator resolves every address in trace order.
+// Output is merged back in trace order, so it is byte-identical to translating the batch serially.
+
+#ifndef VIRTUALMEMORYMANAGER_PARALLELTRANSLATOR_H
+#define VIRTUALMEMORYMANAGER_PARALLELTRANSLATOR_H
+
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+#include "OutputWriter.h"
+#include "Translator.h"
+
+// Sub-batches shorter than this are finished on the calling thread; waking the pool would cost more.
+#define PARALLEL_MIN_RANGE 256
+
+class ParallelTranslator {
+public:
+    ParallelTranslator(Translator *translator, OutputMode mode, int frameCount, int threadCount);
+    ~ParallelTranslator();
+    void translateBatch(const Address *batch, int count, OutputWriter &writer);
+    void collectMetrics();
+
+private:
+    /** Worker
+     * One pool thread and the output it produced for its share of the current sub-batch.
+     */
+    struct Worker {
+        ParallelTranslator *owner;
+        int index;
+        pthread_t thread;
+        std::string output;
+        long long faultTime;
+        Metrics metrics;
+    };
+
+    Translator *translator;
+    OutputMode mode;
+    int threadCount;
+    std::vector<Worker> workers;
+    pthread_barrier_t startBarrier;
+    pthread_barrier_t loadBarrier;
+    pthread_barrier_t endBarrier;
+    bool stopping;
+
+    std::vector<Translation> results;
+    // frameEpochs[frame] is the last sub-batch that loaded or read the frame. A fault into a frame already
+    // used by the current sub-batch starts a new one, so no frame changes contents while it is being read.
+    std::vector<u_int64_t> frameEpochs;
+    u_int64_t epoch;
+    int rangeBegin;
+    int rangeEnd;
+
+    static void *runWorker(void *param);
+    void runShare(Worker &worker, bool loading);
+    void runRange(Worker &worker, int begin, int end, bool loading);
+    void dispatch(int begin, int end, OutputWriter &writer);
+};
+
+
+#endif //VIRTUALMEMORYMANAGER_PARALLELTRANSLATOR_H
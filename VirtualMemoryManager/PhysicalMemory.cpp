@@ -1,53 +1,587 @@
 // PhysicalMemory.cpp
 // Created by Brian Cassriel on 5/7/24.
-// The PhysicalMemory class is a simple vector that represents the physical memory of the system.
+// The PhysicalMemory class holds a fixed number of frames and evicts pages through a ReplacementPolicy once they are full.
 
 #include "PhysicalMemory.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <sys/mman.h>
+
+#include "Checkpoint.h"
+
+/** allocateArena
+ * Maps an anonymous, zeroed region for the frames. Regions of at least HUGE_PAGE_SIZE are rounded up to a
+ * whole number of huge pages and taken from the huge page pool if it has room; otherwise they are mapped
+ * with ordinary pages, aligned to HUGE_PAGE_SIZE and offered to transparent huge pages.
+ * @param size The number of bytes needed, updated to the number of bytes mapped.
+ * @param hugePages Set to true if the region came from the huge page pool.
+ * @return The region, or nullptr if it could not be mapped.
+ */
+static char *allocateArena(size_t &size, bool &hugePages) {
+    hugePages = false;
+    if (size < HUGE_PAGE_SIZE) {
+        void *region = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return region == MAP_FAILED ? nullptr : (char *)region;
+    }
+    size = (size + HUGE_PAGE_SIZE - 1) & ~(size_t)(HUGE_PAGE_SIZE - 1);
+#ifdef MAP_HUGETLB
+    void *huge = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (huge != MAP_FAILED) {
+        hugePages = true;
+        return (char *)huge;
+    }
+#endif
+    // Map an extra huge page's worth and trim both ends so the region starts on a huge page boundary.
+    size_t padded = size + HUGE_PAGE_SIZE;
+    void *region = mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED)
+        return nullptr;
+    char *start = (char *)region;
+    char *aligned = (char *)(((uintptr_t)start + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+    if (aligned > start)
+        munmap(start, aligned - start);
+    if (aligned + size < start + padded)
+        munmap(aligned + size, start + padded - (aligned + size));
+#ifdef MADV_HUGEPAGE
+    madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+    return aligned;
+}
+
 /** PhysicalMemory constructor
- * Initializes the memory vector with nullptrs.
+ * Maps the frame arena and initializes every frame as free.
  * @param frameCount The number of frames in the physical memory.
+ * @param policy The replacement policy, which PhysicalMemory takes ownership of.
+ * @param frameSize The number of bytes in a frame.
+ * @param reserveShift Free frames are handed out in aligned blocks of 2^reserveShift, 0 to hand them out in order.
  */
-PhysicalMemory::PhysicalMemory(int frameCount) {
+PhysicalMemory::PhysicalMemory(int frameCount, ReplacementPolicy *policy, u_int32_t frameSize, int reserveShift) {
+    framePages.assign(frameCount, 0);
+    frameUsed.assign(frameCount, 0);
+    frameDirty.assign(frameCount, 0);
+    dirtyEvictions = 0;
+    flusher = nullptr;
+    frameSpaces.assign(frameCount, 0);
+    loadedAt.assign(frameCount, 0);
+    usedAt.assign(frameCount, 0);
+    stampClock = 0;
+    freeNext.resize(frameCount);
+    freePrev.resize(frameCount);
     for (int i = 0; i < frameCount; i++) {
-        memory.push_back(nullptr);
+        freeNext[i] = i + 1 < frameCount ? i + 1 : -1;
+        freePrev[i] = i - 1;
     }
+    freeHead = frameCount > 0 ? 0 : -1;
+    this->frameCount = frameCount;
+    this->policy = policy;
+    this->frameSize = frameSize;
+    this->reserveShift = reserveShift;
+    frameShift = 0;
+    while ((1u << frameShift) < frameSize)
+        frameShift++;
+    arenaSize = (size_t)frameCount << frameShift;
+    arena = allocateArena(arenaSize, hugePages);
+    if (arena == nullptr)
+        throw std::bad_alloc();
+    framesUsed = 0;
+    evictions = 0;
+    nextBlock = 0;
+    mappings = 0;
+    copies = 0;
 }
 
 /** PhysicalMemory destructor
- * Deletes the memory.
+ * Unmaps the frame arena and deletes the replacement policy.
  */
 PhysicalMemory::~PhysicalMemory() {
-    for (char* & i : memory) {
-        delete[] i;
+    munmap(arena, arenaSize);
+    delete policy;
+}
+
+/** unlinkFreeFrame
+ * Takes a frame off the free list.
+ * @param frame The frame number, which must be free.
+ */
+void PhysicalMemory::unlinkFreeFrame(int frame) {
+    if (freePrev[frame] != -1)
+        freeNext[freePrev[frame]] = freeNext[frame];
+    else
+        freeHead = freeNext[frame];
+    if (freeNext[frame] != -1)
+        freePrev[freeNext[frame]] = freePrev[frame];
+}
+
+/** takeFreeFrame
+ * Picks a free frame for a page and takes it off the free list. Without reservations the lowest free frame
+ * is used. With them, the page goes to its slot in its group's block, and a group's block is set aside the
+ * first time one of its pages arrives. Once no whole block is left, any free frame is used, even one set
+ * aside for another group.
+ * @param page The page being loaded.
+ * @return The frame number. There must be at least one free frame.
+ */
+int PhysicalMemory::takeFreeFrame(u_int64_t page) {
+    int frame = freeHead;
+    if (reserveShift > 0 && reserveShift < 31 && (1 << reserveShift) <= frameCount) {
+        int blockSize = 1 << reserveShift;
+        int slot = (int)(page & (blockSize - 1));
+        auto reservation = reservations.find(page >> reserveShift);
+        if (reservation != reservations.end()) {
+            if (!frameUsed[reservation->second + slot])
+                frame = reservation->second + slot;
+        } else if (nextBlock + blockSize <= frameCount) {
+            reservations[page >> reserveShift] = nextBlock;
+            nextBlock += blockSize;
+            frame = nextBlock - blockSize + slot;
+        }
     }
-    memory.clear();
+    unlinkFreeFrame(frame);
+    return frame;
 }
 
-/** addOrFindFrame
- * Adds a frame to the memory or finds it if it already exists.
- * @param page The page number.
- * @param data The data to be added to the frame.
+/** claimFrame
+ * Picks the frame a page will be loaded into: a free frame, or a victim from the replacement policy.
+ * The frame's contents are filled in separately with fillFrame or mapFrame, so the choice can be made
+ * ahead of the backing store read. A dirty victim is written back straight away.
+ * @param page The page being loaded.
+ * @param evictedPage Set to the page that was evicted, or -1 if a free frame was used.
+ * @return The frame number.
+ */
+int PhysicalMemory::claimFrame(u_int64_t page, int64_t &evictedPage) {
+    u_int64_t evictedSpaces;
+    bool evictedDirty;
+    int frame = claimFrame(page, 0, false, evictedPage, evictedSpaces, evictedDirty);
+    if (evictedDirty)
+        writeBack(frame, (u_int64_t)evictedPage);
+    return frame;
+}
+
+/** claimFrame
+ * Picks the frame a page will be loaded into for one address space, as claimFrame above. An evicted page is
+ * unmapped from every address space that shared its frame, and those are reported back.
+ * @param page The page being loaded.
+ * @param space The address space loading it, below MAX_ADDRESS_SPACES.
+ * @param shared True to make the frame the page's shared copy, which other address spaces can then map.
+ * @param evictedPage Set to the page that was evicted, or -1 if a free frame was used.
+ * @param evictedSpaces Set to the mask of address spaces the evicted page was mapped in, or 0.
+ * @param evictedDirty Set to true if the evicted page was dirty. Its bytes are still in the frame, and must be
+ * passed to writeBack before the frame is filled.
  * @return The frame number.
  */
-u_int8_t PhysicalMemory::addOrFindFrame(u_int8_t page, char* data) {
-    if (memory[page] != nullptr) {
-        return page;
+int PhysicalMemory::claimFrame(u_int64_t page, int space, bool shared, int64_t &evictedPage,
+                               u_int64_t &evictedSpaces, bool &evictedDirty) {
+    int frame;
+    evictedSpaces = 0;
+    evictedDirty = false;
+    if (framesUsed < frameCount) {
+        frame = takeFreeFrame(page);
+        frameUsed[frame] = 1;
+        framesUsed++;
+        evictedPage = -1;
     } else {
-        memory[page] = new char[FRAME_SIZE];
-        for (int i = 0; i < FRAME_SIZE; i++) {
-            memory[page][i] = data[i];
+        frame = policy->selectVictim(page);
+        evictedPage = (int64_t)framePages[frame];
+        evictedSpaces = frameSpaces[frame];
+        evictedDirty = frameDirty[frame];
+        dirtyEvictions += evictedDirty;
+        mappings -= __builtin_popcountll(evictedSpaces);
+        if (!sharedFrames.empty()) {
+            auto entry = sharedFrames.find(framePages[frame]);
+            if (entry != sharedFrames.end() && entry->second == frame)
+                sharedFrames.erase(entry);
         }
-        return page;
+        evictions++;
     }
+    framePages[frame] = page;
+    frameSpaces[frame] = 1ull << space;
+    frameDirty[frame] = 0;
+    mappings++;
+    if (shared)
+        sharedFrames[page] = frame;
+    loadedAt[frame] = ++stampClock;
+    policy->frameLoaded(frame, page);
+    return frame;
+}
+
+/** findSharedFrame
+ * @param page The page number.
+ * @return The frame holding the page's shared copy, or -1 if it has none.
+ */
+int PhysicalMemory::findSharedFrame(u_int64_t page) {
+    auto entry = sharedFrames.find(page);
+    return entry == sharedFrames.end() ? -1 : entry->second;
+}
+
+/** shareFrame
+ * Maps a shared frame into one more address space.
+ * @param frame The frame, as returned by findSharedFrame.
+ * @param space The address space.
+ */
+void PhysicalMemory::shareFrame(int frame, int space) {
+    if ((frameSpaces[frame] & 1ull << space) == 0) {
+        frameSpaces[frame] |= 1ull << space;
+        mappings++;
+    }
+}
+
+/** copyOnWrite
+ * Gives an address space a private copy of a shared frame it is writing to. If no other address space maps
+ * the frame it is simply taken over; otherwise a frame is claimed (possibly evicting a page, even the shared
+ * frame itself) and the page is copied into it.
+ * @param frame The shared frame the address space maps.
+ * @param space The address space writing to it.
+ * @param evictedPage Set to the page that was evicted for the copy, or -1 if none was.
+ * @param evictedSpaces Set to the mask of address spaces the evicted page was mapped in, or 0.
+ * @return The private frame now holding the page for the address space.
+ */
+int PhysicalMemory::copyOnWrite(int frame, int space, int64_t &evictedPage, u_int64_t &evictedSpaces) {
+    evictedPage = -1;
+    evictedSpaces = 0;
+    if (frameSpaces[frame] == 1ull << space) {
+        sharedFrames.erase(framePages[frame]);
+        return frame;
+    }
+    frameSpaces[frame] &= ~(1ull << space);
+    mappings--;
+    const char *source = getFrameBytes(frame);
+    bool evictedDirty;
+    int copy = claimFrame(framePages[frame], space, false, evictedPage, evictedSpaces, evictedDirty);
+    // A shared frame is never dirty, so a dirty victim is some other frame and can be written back first.
+    if (evictedDirty)
+        writeBack(copy, (u_int64_t)evictedPage);
+    // When the shared frame itself was the victim its bytes are still intact, and may already be in its buffer.
+    char *target = getFrameBuffer(copy);
+    if (target != source)
+        memcpy(target, source, frameSize);
+    copies++;
+    return copy;
+}
+
+/** isShared
+ * @param frame The frame number.
+ * @return True if the frame is a page's shared copy, which must be copied before it is written.
+ */
+bool PhysicalMemory::isShared(int frame) {
+    if (sharedFrames.empty())
+        return false;
+    auto entry = sharedFrames.find(framePages[frame]);
+    return entry != sharedFrames.end() && entry->second == frame;
+}
+
+/** setWriteBack
+ * Hands dirty pages to a flusher from now on instead of dropping them.
+ * @param flusher The flusher, which the caller keeps ownership of, or nullptr.
+ */
+void PhysicalMemory::setWriteBack(WriteBackFlusher *flusher) {
+    this->flusher = flusher;
+}
+
+/** markDirty
+ * Records a write to a frame. Shared frames must be copied before they are written.
+ * @param frame The frame number.
+ */
+void PhysicalMemory::markDirty(int frame) {
+    frameDirty[frame] = 1;
+}
+
+/** isDirty
+ * @param frame The frame number.
+ * @return True if the frame's page was written since it was loaded.
+ */
+bool PhysicalMemory::isDirty(int frame) {
+    return frameDirty[frame];
+}
+
+/** writeBack
+ * Hands a dirty page's bytes to the flusher. For an evicted page this must happen before its old frame is
+ * filled again; it is safe to call from several threads for different frames.
+ * @param frame The frame still holding the page's bytes.
+ * @param page The page.
+ */
+void PhysicalMemory::writeBack(int frame, u_int64_t page) {
+    if (flusher != nullptr)
+        flusher->stage(page, getFrameBytes(frame));
+}
+
+/** syncDirtyFrames
+ * Writes back every resident dirty page, as on shutdown, and marks its frame clean.
+ * @return The number of pages written back.
+ */
+int PhysicalMemory::syncDirtyFrames() {
+    int synced = 0;
+    for (int frame = 0; frame < frameCount; frame++) {
+        if (frameDirty[frame]) {
+            writeBack(frame, framePages[frame]);
+            frameDirty[frame] = 0;
+            synced++;
+        }
+    }
+    return synced;
+}
+
+/** getFrameBytes
+ * @param frame The frame number.
+ * @return Where the frame's bytes currently are: its arena slot, or the backing store mapping when aliased.
+ */
+char *PhysicalMemory::getFrameBytes(int frame) {
+    if (aliases.empty())
+        return arena + ((size_t)frame << frameShift);
+    return aliases[frame];
+}
+
+/** getFrameBuffer
+ * Points a claimed frame back at its arena slot so the caller can read page data straight into it.
+ * @param frame The frame number.
+ * @return The frame's slot in the arena, frameSize bytes long.
+ */
+char *PhysicalMemory::getFrameBuffer(int frame) {
+    char *buffer = arena + ((size_t)frame << frameShift);
+    if (!aliases.empty())
+        aliases[frame] = buffer;
+    return buffer;
+}
+
+/** fillFrame
+ * Copies page data into a claimed frame.
+ * @param frame The frame number.
+ * @param data The data to be added to the frame.
+ */
+void PhysicalMemory::fillFrame(int frame, const char *data) {
+    memcpy(getFrameBuffer(frame), data, frameSize);
+}
+
+/** enableAliasing
+ * Sets up the per-frame pointers that mapFrame needs, every frame starting at its arena slot. From here on every
+ * byte lookup goes through them. Must be called before any frame is aliased and before frames are loaded from
+ * several threads, since mapFrame only writes its own frame's pointer.
+ */
+void PhysicalMemory::enableAliasing() {
+    if (!aliases.empty())
+        return;
+    aliases.resize(frameCount);
+    for (int i = 0; i < frameCount; i++)
+        aliases[i] = arena + ((size_t)i << frameShift);
+}
+
+/** mapFrame
+ * Points a claimed frame directly at read-only page data instead of copying it.
+ * The data must outlive the PhysicalMemory object, and enableAliasing must have been called.
+ * @param frame The frame number.
+ * @param data The page data to alias.
+ */
+void PhysicalMemory::mapFrame(int frame, const char *data) {
+    aliases[frame] = const_cast<char *>(data);
+}
+
+/** addFrame
+ * Copies a page into a frame, evicting another page if memory is full.
+ * @param page The page number.
+ * @param data The data to be added to the frame.
+ * @param evictedPage Set to the page that was evicted, or -1 if none was.
+ * @return The frame number.
+ */
+int PhysicalMemory::addFrame(u_int64_t page, const char *data, int64_t &evictedPage) {
+    int frame = claimFrame(page, evictedPage);
+    fillFrame(frame, data);
+    return frame;
+}
+
+/** aliasFrame
+ * Maps a frame directly onto read-only page data instead of copying it, evicting another page if memory is full.
+ * The data must outlive the PhysicalMemory object.
+ * @param page The page number.
+ * @param data The page data to alias.
+ * @param evictedPage Set to the page that was evicted, or -1 if none was.
+ * @return The frame number.
+ */
+int PhysicalMemory::aliasFrame(u_int64_t page, const char *data, int64_t &evictedPage) {
+    int frame = claimFrame(page, evictedPage);
+    mapFrame(frame, data);
+    return frame;
+}
+
+/** touchFrame
+ * Records a reference to a resident frame for the replacement policy.
+ * @param frame The frame number.
+ */
+void PhysicalMemory::touchFrame(int frame) {
+    usedAt[frame] = ++stampClock;
+    policy->frameAccessed(frame);
 }
 
 /** getByte
- * Gets a byte from the memory.
+ * Gets a byte from the memory. Unless frames are aliased this is a single load from the arena.
  * @param frame The frame number.
  * @param offset The offset in the frame.
  * @return The byte.
  */
-int PhysicalMemory::getByte(u_int8_t frame, u_int8_t offset) {
-    return memory[frame][offset];
+int PhysicalMemory::getByte(int frame, u_int32_t offset) {
+    if (aliases.empty())
+        return arena[((size_t)frame << frameShift) + offset];
+    return aliases[frame][offset];
+}
+
+/** getFrameCount
+ * @return The number of frames in the physical memory.
+ */
+int PhysicalMemory::getFrameCount() {
+    return frameCount;
+}
+
+/** getArenaSize
+ * @return The number of bytes mapped for the frames.
+ */
+size_t PhysicalMemory::getArenaSize() {
+    return arenaSize;
+}
+
+/** isHugePageBacked
+ * @return True if the frames came from the huge page pool. A smaller arena may still be backed by
+ * transparent huge pages, which the kernel does not report back.
+ */
+bool PhysicalMemory::isHugePageBacked() {
+    return hugePages;
+}
+
+/** getFramesUsed
+ * @return The number of frames that hold a page.
+ */
+int PhysicalMemory::getFramesUsed() {
+    return framesUsed;
+}
+
+/** getFrameSize
+ * @return The number of bytes in a frame.
+ */
+u_int32_t PhysicalMemory::getFrameSize() {
+    return frameSize;
+}
+
+/** getEvictionCount
+ * @return The number of pages evicted so far.
+ */
+long long PhysicalMemory::getEvictionCount() {
+    return evictions;
+}
+
+/** getSharedFrameCount
+ * @return The number of frames that currently hold a page's shared copy.
+ */
+int PhysicalMemory::getSharedFrameCount() {
+    return (int)sharedFrames.size();
+}
+
+/** getMappingCount
+ * @return The number of (address space, frame) mappings, i.e. the sum of every frame's reference count.
+ * Without sharing every mapping would need a frame of its own.
+ */
+long long PhysicalMemory::getMappingCount() {
+    return mappings;
+}
+
+/** getCopyCount
+ * @return The number of copy-on-write faults that had to copy a frame.
+ */
+long long PhysicalMemory::getCopyCount() {
+    return copies;
+}
+
+/** getDirtyEvictionCount
+ * @return The number of evicted pages that were dirty.
+ */
+long long PhysicalMemory::getDirtyEvictionCount() {
+    return dirtyEvictions;
+}
+
+/** getFramePage
+ * @param frame The frame number.
+ * @return The page in the frame, or -1 if the frame is free.
+ */
+int64_t PhysicalMemory::getFramePage(int frame) {
+    return frameUsed[frame] ? (int64_t)framePages[frame] : -1;
+}
+
+/** saveState
+ * Writes which page every resident frame holds, its dirty bit and when it was loaded and last used, the
+ * counters, and the replacement policy's own state under its name. Frame bytes are not written.
+ * Reservations for large pages and shared frames are not covered.
+ * @param out The checkpoint being written.
+ */
+void PhysicalMemory::saveState(CheckpointWriter &out) {
+    out.beginSection("PMEM");
+    out.put(frameCount);
+    out.put(frameSize);
+    out.put(framesUsed);
+    out.put(evictions);
+    out.put(dirtyEvictions);
+    out.put(mappings);
+    out.put(copies);
+    out.put(stampClock);
+    for (int frame = 0; frame < frameCount; frame++) {
+        out.put(frameUsed[frame]);
+        if (!frameUsed[frame])
+            continue;
+        out.put(framePages[frame]);
+        out.put(frameDirty[frame]);
+        out.put(frameSpaces[frame]);
+        out.put(loadedAt[frame]);
+        out.put(usedAt[frame]);
+    }
+    CheckpointWriter policyState;
+    policy->saveState(policyState);
+    out.putString(policy->getName());
+    out.putBlock(policyState);
+}
+
+/** loadState
+ * Restores what saveState wrote into a physical memory of the same size that has no frames in use yet.
+ * The frames are claimed but not filled; their bytes are up to the caller. When the checkpoint was taken
+ * under another replacement policy, this one is seeded with the resident frames in the order the old one
+ * loaded and used them.
+ * @param in The checkpoint being read.
+ * @param position The number of addresses translated when the checkpoint was taken.
+ * @return True if the sizes matched and everything was read.
+ */
+bool PhysicalMemory::loadState(CheckpointReader &in, u_int64_t position) {
+    if (!in.expectSection("PMEM") || framesUsed != 0 || in.get() != (u_int64_t)frameCount ||
+        in.get() != frameSize)
+        return false;
+    int used = (int)in.get();
+    evictions = (long long)in.get();
+    dirtyEvictions = (long long)in.get();
+    mappings = (long long)in.get();
+    copies = (long long)in.get();
+    stampClock = in.get();
+    std::vector<int> loadOrder;
+    for (int frame = 0; frame < frameCount && in.isValid(); frame++) {
+        if (!in.get())
+            continue;
+        frameUsed[frame] = 1;
+        framePages[frame] = in.get();
+        frameDirty[frame] = (u_int8_t)in.get();
+        frameSpaces[frame] = in.get();
+        loadedAt[frame] = in.get();
+        usedAt[frame] = in.get();
+        unlinkFreeFrame(frame);
+        framesUsed++;
+        loadOrder.push_back(frame);
+    }
+    std::string policyName = in.getString();
+    CheckpointReader policyState;
+    if (!in.getBlock(policyState) || framesUsed != used)
+        return false;
+    if (policyName == policy->getName())
+        return policy->loadState(policyState);
+
+    std::sort(loadOrder.begin(), loadOrder.end(), [this](int a, int b) { return loadedAt[a] < loadedAt[b]; });
+    std::vector<int> useOrder;
+    for (int frame : loadOrder) {
+        if (usedAt[frame] > loadedAt[frame])
+            useOrder.push_back(frame);
+    }
+    std::sort(useOrder.begin(), useOrder.end(), [this](int a, int b) { return usedAt[a] < usedAt[b]; });
+    policy->seedFrames(loadOrder, useOrder, framePages, position);
+    return true;
 }
@@ -1,25 +1,116 @@
 // PhysicalMemory.h
 // Created by Brian Cassriel on 5/7/24.
-// The PhysicalMemory class is a simple vector that represents the physical memory of the system.
+// The PhysicalMemory class holds a fixed number of frames and evicts pages through a ReplacementPolicy once they are full.
+// A frame can be mapped by several address spaces at once: a shared frame holds a clean copy of a backing store
+// page, and an address space that writes to it gets a private copy of its own (copy-on-write).
+// A frame that is written to is dirty until its page leaves it; with a WriteBackFlusher a dirty page is handed
+// to the flusher when it is evicted.
+// Every frame lives in one contiguous arena, backed by huge pages when the system has them, so a frame's bytes
+// are found by index rather than through a pointer per frame.
 
 #ifndef VIRTUALMEMORYMANAGER_PHYSICALMEMORY_H
 #define VIRTUALMEMORYMANAGER_PHYSICALMEMORY_H
 
 #include <cstdlib>
+#include <unordered_map>
 #include <vector>
 
+#include "address.h"
+#include "ReplacementPolicy.h"
+#include "WriteBackFlusher.h"
+
 #define NUM_FRAMES 256
-#define FRAME_SIZE 256
+// Address spaces are tracked in a 64-bit mask per frame.
+#define MAX_ADDRESS_SPACES 64
+// Arenas at least this large are aligned to it and backed by huge pages when possible.
+#define HUGE_PAGE_SIZE (2u << 20)
 
 class PhysicalMemory {
 public:
-    PhysicalMemory(int frameCount);
+    PhysicalMemory(int frameCount, ReplacementPolicy *policy, u_int32_t frameSize = FRAME_SIZE, int reserveShift = 0);
     ~PhysicalMemory();
-    u_int8_t addOrFindFrame(u_int8_t page, char *data);
-    int getByte(u_int8_t frame, u_int8_t offset);
+    int claimFrame(u_int64_t page, int64_t &evictedPage);
+    int claimFrame(u_int64_t page, int space, bool shared, int64_t &evictedPage, u_int64_t &evictedSpaces,
+                   bool &evictedDirty);
+    int findSharedFrame(u_int64_t page);
+    void shareFrame(int frame, int space);
+    int copyOnWrite(int frame, int space, int64_t &evictedPage, u_int64_t &evictedSpaces);
+    bool isShared(int frame);
+    void setWriteBack(WriteBackFlusher *flusher);
+    void markDirty(int frame);
+    bool isDirty(int frame);
+    void writeBack(int frame, u_int64_t page);
+    int syncDirtyFrames();
+    char *getFrameBuffer(int frame);
+    void fillFrame(int frame, const char *data);
+    void enableAliasing();
+    void mapFrame(int frame, const char *data);
+    int addFrame(u_int64_t page, const char *data, int64_t &evictedPage);
+    int aliasFrame(u_int64_t page, const char *data, int64_t &evictedPage);
+    void touchFrame(int frame);
+    int getByte(int frame, u_int32_t offset);
+    int getFrameCount();
+    size_t getArenaSize();
+    bool isHugePageBacked();
+    int getFramesUsed();
+    u_int32_t getFrameSize();
+    long long getEvictionCount();
+    int getSharedFrameCount();
+    long long getMappingCount();
+    long long getCopyCount();
+    long long getDirtyEvictionCount();
+    int64_t getFramePage(int frame);
+    void saveState(CheckpointWriter &out);
+    bool loadState(CheckpointReader &in, u_int64_t position);
 
 private:
-    std::vector<char *> memory;
+    // Frame f occupies arena[f << frameShift] onwards; a frame's slot is frameSize rounded up to a power of two.
+    char *arena;
+    size_t arenaSize;
+    int frameShift;
+    bool hugePages;
+    int frameCount;
+    // Only filled in by enableAliasing: aliases[frame] points at the frame's bytes, its arena slot or
+    // the backing store mapping.
+    std::vector<char *> aliases;
+    std::vector<u_int64_t> framePages;
+    std::vector<u_int8_t> frameUsed;
+    std::vector<u_int8_t> frameDirty;
+    long long dirtyEvictions;
+    // Not owned; nullptr when dirty pages are simply dropped.
+    WriteBackFlusher *flusher;
+    // frameSpaces[frame] has bit s set while address space s maps the frame, so its reference count is the
+    // number of bits set. Single address space callers only ever use bit 0.
+    std::vector<u_int64_t> frameSpaces;
+    // The frame holding the shared copy of each page that has one. A frame leaves it when it is evicted or
+    // when its last sharer writes to it.
+    std::unordered_map<u_int64_t, int> sharedFrames;
+    long long mappings;
+    long long copies;
+    ReplacementPolicy *policy;
+    // When each frame was last loaded and last referenced, on one clock, so a checkpoint can hand the resident
+    // frames to a different policy in the order the old one saw them.
+    std::vector<u_int64_t> loadedAt;
+    std::vector<u_int64_t> usedAt;
+    u_int64_t stampClock;
+    u_int32_t frameSize;
+    int framesUsed;
+    long long evictions;
+
+    // While frames are free, each aligned group of 2^reserveShift pages is given an aligned block of frames,
+    // so a group that becomes fully resident is physically contiguous and can be mapped as one large page.
+    int reserveShift;
+    std::unordered_map<u_int64_t, int> reservations;
+    int nextBlock;
+    // Free frames form a doubly linked list in frame order, so the lowest free frame is handed out first and
+    // a frame set aside by a reservation can be unlinked in O(1).
+    std::vector<int> freeNext;
+    std::vector<int> freePrev;
+    int freeHead;
+
+    int takeFreeFrame(u_int64_t page);
+    void unlinkFreeFrame(int frame);
+    char *getFrameBytes(int frame);
 };
 
 
@@ -0,0 +1,378 @@
+// Prefetcher.cpp
+// The Prefetcher class reads backing store pages ahead of demand on a background I/O thread, guided by a
+// sequential, stride-detecting or Markov PrefetchPredictor.
+
+#include "Prefetcher.h"
+
+#include <chrono>
+#include <cstring>
+
+/** createPrefetchPredictor
+ * Builds a predictor by name.
+ * @param name The predictor name.
+ * @param degree The most pages to predict per fault.
+ * @return The predictor, or nullptr if the name or the degree is not valid.
+ */
+PrefetchPredictor *createPrefetchPredictor(const std::string &name, int degree) {
+    if (degree < 1 || degree > PREFETCH_MAX_DEGREE)
+        return nullptr;
+    if (name == "sequential")
+        return new SequentialPredictor(degree);
+    if (name == "stride")
+        return new StridePredictor(degree);
+    if (name == "markov")
+        return new MarkovPredictor(degree);
+    return nullptr;
+}
+
+/** SequentialPredictor constructor
+ * @param degree The number of pages to predict per fault.
+ */
+SequentialPredictor::SequentialPredictor(int degree) {
+    this->degree = degree;
+}
+
+/** predict
+ * @param page The page that faulted.
+ * @param pages The predictions to be appended to.
+ */
+void SequentialPredictor::predict(u_int64_t page, std::vector<u_int64_t> &pages) {
+    for (int i = 1; i <= degree; i++)
+        pages.push_back(page + i);
+}
+
+/** StridePredictor constructor
+ * @param degree The number of steps to predict once a stride is confirmed.
+ */
+StridePredictor::StridePredictor(int degree) {
+    this->degree = degree;
+    this->lastPage = 0;
+    this->lastStride = 0;
+}
+
+/** predict
+ * @param page The page that faulted.
+ * @param pages The predictions to be appended to.
+ */
+void StridePredictor::predict(u_int64_t page, std::vector<u_int64_t> &pages) {
+    int64_t stride = (int64_t)(page - lastPage);
+    if (stride != 0 && stride == lastStride) {
+        for (int i = 1; i <= degree; i++)
+            pages.push_back(page + (u_int64_t)(stride * i));
+    }
+    lastStride = stride;
+    lastPage = page;
+}
+
+/** MarkovPredictor constructor
+ * @param degree The most successors to predict per fault.
+ */
+MarkovPredictor::MarkovPredictor(int degree) {
+    this->degree = degree < MARKOV_SUCCESSORS ? degree : MARKOV_SUCCESSORS;
+    this->table.resize(MARKOV_TABLE_SIZE);
+    for (Entry &entry : this->table)
+        entry.count = -1;
+    this->lastPage = 0;
+    this->haveLast = false;
+}
+
+/** entryFor
+ * Finds a page's table entry, taking the slot over from whatever page held it before.
+ * @param page The page.
+ * @return The entry.
+ */
+MarkovPredictor::Entry &MarkovPredictor::entryFor(u_int64_t page) {
+    Entry &entry = table[(page * 0x9E3779B97F4A7C15ull) >> 52 & (MARKOV_TABLE_SIZE - 1)];
+    if (entry.count == -1 || entry.page != page) {
+        entry.page = page;
+        entry.count = 0;
+    }
+    return entry;
+}
+
+/** predict
+ * Records the page as the newest successor of the previous fault, then predicts its own successors,
+ * most recent first.
+ * @param page The page that faulted.
+ * @param pages The predictions to be appended to.
+ */
+void MarkovPredictor::predict(u_int64_t page, std::vector<u_int64_t> &pages) {
+    if (haveLast) {
+        Entry &previous = entryFor(lastPage);
+        int at = 0;
+        while (at < previous.count && previous.successors[at] != page)
+            at++;
+        if (at == previous.count && previous.count < MARKOV_SUCCESSORS)
+            previous.count++;
+        if (at == MARKOV_SUCCESSORS)
+            at--;
+        for (; at > 0; at--)
+            previous.successors[at] = previous.successors[at - 1];
+        previous.successors[0] = page;
+    }
+    lastPage = page;
+    haveLast = true;
+
+    Entry &entry = entryFor(page);
+    for (int i = 0; i < entry.count && i < degree; i++)
+        pages.push_back(entry.successors[i]);
+}
+
+/** Prefetcher constructor
+ * Starts the I/O thread.
+ * @param fileProcessor The backing store to read from.
+ * @param predictor The predictor, which the Prefetcher deletes.
+ * @param pageSize The number of bytes in a page.
+ * @param slots The number of pages the staging buffer holds.
+ */
+Prefetcher::Prefetcher(FileProcessor *fileProcessor, PrefetchPredictor *predictor, u_int32_t pageSize, int slots) {
+    this->fileProcessor = fileProcessor;
+    this->predictor = predictor;
+    this->pageSize = pageSize;
+    this->slots = slots < 1 ? 1 : slots;
+    this->stopping = false;
+    this->ioIdle = false;
+    this->issued = 0;
+    this->faults = 0;
+    this->claimed = 0;
+    this->late = 0;
+    this->waits = 0;
+    this->waitTime = 0;
+    this->wasted = 0;
+    pthread_mutex_init(&lock, nullptr);
+    pthread_cond_init(&queued, nullptr);
+    pthread_cond_init(&ready, nullptr);
+    pthread_create(&ioThread, nullptr, runIO, this);
+}
+
+/** Prefetcher destructor
+ * Stops the I/O thread, dropping reads it has not started, and frees every staging buffer.
+ */
+Prefetcher::~Prefetcher() {
+    pthread_mutex_lock(&lock);
+    stopping = true;
+    pthread_cond_signal(&queued);
+    pthread_mutex_unlock(&lock);
+    pthread_join(ioThread, nullptr);
+    pthread_mutex_destroy(&lock);
+    pthread_cond_destroy(&queued);
+    pthread_cond_destroy(&ready);
+    for (PrefetchRequest *request : allocated) {
+        delete[] request->buffer;
+        delete request;
+    }
+    delete predictor;
+}
+
+/** runIO
+ * Entry point of the I/O thread: reads queued pages into their staging buffers in the order they were asked for.
+ * @param param The Prefetcher.
+ * @return nullptr
+ */
+void *Prefetcher::runIO(void *param) {
+    Prefetcher *owner = (Prefetcher *)param;
+    pthread_mutex_lock(&owner->lock);
+    while (true) {
+        while (owner->queue.empty() && !owner->stopping) {
+            owner->ioIdle = true;
+            pthread_cond_wait(&owner->queued, &owner->lock);
+        }
+        owner->ioIdle = false;
+        if (owner->stopping)
+            break;
+        PrefetchRequest *request = owner->queue.front();
+        owner->queue.pop_front();
+        if (request->cancelled) {
+            owner->recycle(request);
+            continue;
+        }
+        request->state = PREFETCH_READING;
+        pthread_mutex_unlock(&owner->lock);
+        owner->fileProcessor->getDataFromStore(request->page, request->buffer);
+        pthread_mutex_lock(&owner->lock);
+        request->state = PREFETCH_READY;
+        if (request->cancelled)
+            owner->recycle(request);
+        else
+            pthread_cond_broadcast(&owner->ready);
+    }
+    pthread_mutex_unlock(&owner->lock);
+    pthread_exit(nullptr);
+}
+
+/** recycle
+ * Puts a request back on the spare list. The lock must be held.
+ * @param request The request.
+ */
+void Prefetcher::recycle(PrefetchRequest *request) {
+    spare.push_back(request);
+}
+
+/** predict
+ * Called for every page fault in trace order.
+ * @param page The page that faulted.
+ * @param pages The pages worth prefetching, to be appended to.
+ */
+void Prefetcher::predict(u_int64_t page, std::vector<u_int64_t> &pages) {
+    faults++;
+    predictor->predict(page, pages);
+}
+
+/** request
+ * Stages a page: queues a read of it for the I/O thread unless it is already staged, dropping the oldest
+ * staged page if the staging buffer is full. Must be called in trace order.
+ * @param page The page, which should not be resident.
+ */
+void Prefetcher::request(u_int64_t page) {
+    if (staged.count(page))
+        return;
+    pthread_mutex_lock(&lock);
+    while ((int)staged.size() >= slots) {
+        PrefetchRequest *dropped = order.front();
+        order.pop_front();
+        staged.erase(dropped->page);
+        wasted++;
+        if (dropped->state == PREFETCH_READY)
+            recycle(dropped);
+        else
+            dropped->cancelled = true;
+    }
+
+    PrefetchRequest *request;
+    if (spare.empty()) {
+        request = new PrefetchRequest();
+        request->buffer = new char[pageSize];
+        allocated.push_back(request);
+    } else {
+        request = spare.back();
+        spare.pop_back();
+    }
+    request->page = page;
+    request->state = PREFETCH_QUEUED;
+    request->cancelled = false;
+    staged[page] = request;
+    request->position = order.insert(order.end(), request);
+    queue.push_back(request);
+    issued++;
+    if (ioIdle)
+        pthread_cond_signal(&queued);
+    pthread_mutex_unlock(&lock);
+}
+
+/** claim
+ * Takes a faulting page out of the staging buffer. Must be called in trace order.
+ * @param page The page that faulted.
+ * @return The page's request, to be passed to consume, or nullptr if it was not staged.
+ */
+PrefetchRequest *Prefetcher::claim(u_int64_t page) {
+    std::unordered_map<u_int64_t, PrefetchRequest *>::iterator found = staged.find(page);
+    if (found == staged.end())
+        return nullptr;
+    PrefetchRequest *request = found->second;
+    staged.erase(found);
+    order.erase(request->position);
+    claimed++;
+    return request;
+}
+
+/** consume
+ * Copies a claimed page into its frame, waiting if the I/O thread is still reading it. If the read has not
+ * started yet it is cancelled instead, since reading the page directly is quicker than waiting behind the queue.
+ * Safe to call from several threads.
+ * @param request The request returned by claim.
+ * @param data The frame's buffer, pageSize bytes long.
+ * @return True if the page was copied, false if the caller must read it from the backing store.
+ */
+bool Prefetcher::consume(PrefetchRequest *request, char *data) {
+    pthread_mutex_lock(&lock);
+    if (request->state == PREFETCH_QUEUED) {
+        request->cancelled = true;
+        late++;
+        pthread_mutex_unlock(&lock);
+        return false;
+    }
+    if (request->state == PREFETCH_READING) {
+        auto waitStart = std::chrono::steady_clock::now();
+        while (request->state != PREFETCH_READY)
+            pthread_cond_wait(&ready, &lock);
+        waits++;
+        waitTime += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - waitStart).count();
+    }
+    pthread_mutex_unlock(&lock);
+    memcpy(data, request->buffer, pageSize);
+    pthread_mutex_lock(&lock);
+    recycle(request);
+    pthread_mutex_unlock(&lock);
+    return true;
+}
+
+/** getName
+ * @return The predictor's name.
+ */
+const char *Prefetcher::getName() {
+    return predictor->getName();
+}
+
+/** getIssueCount
+ * @return The number of pages queued for prefetching.
+ */
+long long Prefetcher::getIssueCount() {
+    return issued;
+}
+
+/** getUsefulCount
+ * @return The number of faults on a page that was staged, whether or not its read was done in time.
+ */
+long long Prefetcher::getUsefulCount() {
+    return claimed;
+}
+
+/** getLateCount
+ * @return The number of staged pages that faulted before the I/O thread started reading them.
+ */
+long long Prefetcher::getLateCount() {
+    return late;
+}
+
+/** getWaitCount
+ * @return The number of faults that waited for a prefetch read in progress.
+ */
+long long Prefetcher::getWaitCount() {
+    return waits;
+}
+
+/** getWaitTime
+ * @return The total time faults spent waiting for prefetch reads in progress, in nanoseconds.
+ */
+long long Prefetcher::getWaitTime() {
+    return waitTime;
+}
+
+/** getFaultCount
+ * @return The number of page faults seen.
+ */
+long long Prefetcher::getFaultCount() {
+    return faults;
+}
+
+/** getWastedCount
+ * @return The number of staged pages dropped before they faulted.
+ */
+long long Prefetcher::getWastedCount() {
+    return wasted;
+}
+
+/** getAccuracy
+ * @return The fraction of prefetched pages that later faulted.
+ */
+double Prefetcher::getAccuracy() {
+    return issued == 0 ? 0 : (double)claimed / issued;
+}
+
+/** getCoverage
+ * @return The fraction of page faults whose page had been prefetched.
+ */
+double Prefetcher::getCoverage() {
+    return faults == 0 ? 0 : (double)claimed / faults;
+}
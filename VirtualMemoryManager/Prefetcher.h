@@ -0,0 +1,163 @@
+// Prefetcher.h
+// The Prefetcher class reads backing store pages ahead of demand on a background I/O thread. A PrefetchPredictor
+// watches the page fault stream and guesses which pages will fault next; those are read into a small staging
+// buffer, and a later fault on one of them copies it from there instead of waiting on the backing store.
+// Which pages are staged is decided in trace order, so the counters do not depend on thread timing.
+
+#ifndef VIRTUALMEMORYMANAGER_PREFETCHER_H
+#define VIRTUALMEMORYMANAGER_PREFETCHER_H
+
+#include <cstdlib>
+#include <deque>
+#include <list>
+#include <pthread.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "FileProcessor.h"
+
+#define PREFETCH_DEGREE 2
+#define PREFETCH_MAX_DEGREE 16
+// Pages held in the staging buffer; the oldest staged page is dropped to make room for a new one.
+#define PREFETCH_SLOTS 64
+#define MARKOV_TABLE_SIZE 4096
+#define MARKOV_SUCCESSORS 4
+
+class PrefetchPredictor {
+public:
+    virtual ~PrefetchPredictor() {}
+    virtual const char *getName() = 0;
+    // A page faulted; learn from it and append the pages expected to fault soon.
+    virtual void predict(u_int64_t page, std::vector<u_int64_t> &pages) = 0;
+};
+
+PrefetchPredictor *createPrefetchPredictor(const std::string &name, int degree);
+
+/** SequentialPredictor
+ * Predicts the next degree pages after every fault.
+ */
+class SequentialPredictor : public PrefetchPredictor {
+public:
+    SequentialPredictor(int degree);
+    const char *getName() override { return "sequential"; }
+    void predict(u_int64_t page, std::vector<u_int64_t> &pages) override;
+
+private:
+    int degree;
+};
+
+/** StridePredictor
+ * Predicts degree more steps once two faults in a row are the same (non-zero) distance apart.
+ */
+class StridePredictor : public PrefetchPredictor {
+public:
+    StridePredictor(int degree);
+    const char *getName() override { return "stride"; }
+    void predict(u_int64_t page, std::vector<u_int64_t> &pages) override;
+
+private:
+    int degree;
+    u_int64_t lastPage;
+    int64_t lastStride;
+};
+
+/** MarkovPredictor
+ * Remembers which pages faulted right after each page, in a direct-mapped table of the MARKOV_SUCCESSORS most
+ * recent successors per page, and predicts up to degree of those when the page faults again.
+ */
+class MarkovPredictor : public PrefetchPredictor {
+public:
+    MarkovPredictor(int degree);
+    const char *getName() override { return "markov"; }
+    void predict(u_int64_t page, std::vector<u_int64_t> &pages) override;
+
+private:
+    struct Entry {
+        u_int64_t page;
+        u_int64_t successors[MARKOV_SUCCESSORS];
+        int count;
+    };
+
+    int degree;
+    std::vector<Entry> table;
+    u_int64_t lastPage;
+    bool haveLast;
+
+    Entry &entryFor(u_int64_t page);
+};
+
+/** PrefetchRequest
+ * One page being read, or already read, into a staging buffer.
+ */
+struct PrefetchRequest {
+    u_int64_t page;
+    char *buffer;
+    // PREFETCH_QUEUED, PREFETCH_READING or PREFETCH_READY; guarded by the Prefetcher's lock.
+    int state;
+    // Set when the request is dropped before its read is done; whoever finishes with it last recycles it.
+    bool cancelled;
+    // Where the request sits in the staging order while it is staged.
+    std::list<PrefetchRequest *>::iterator position;
+};
+
+class Prefetcher {
+public:
+    Prefetcher(FileProcessor *fileProcessor, PrefetchPredictor *predictor, u_int32_t pageSize,
+               int slots = PREFETCH_SLOTS);
+    ~Prefetcher();
+    void predict(u_int64_t page, std::vector<u_int64_t> &pages);
+    void request(u_int64_t page);
+    PrefetchRequest *claim(u_int64_t page);
+    bool consume(PrefetchRequest *request, char *data);
+    const char *getName();
+    long long getIssueCount();
+    long long getUsefulCount();
+    long long getLateCount();
+    long long getWaitCount();
+    long long getWaitTime();
+    long long getFaultCount();
+    long long getWastedCount();
+    double getAccuracy();
+    double getCoverage();
+
+    static const int PREFETCH_QUEUED = 0;
+    static const int PREFETCH_READING = 1;
+    static const int PREFETCH_READY = 2;
+
+private:
+    FileProcessor *fileProcessor;
+    PrefetchPredictor *predictor;
+    u_int32_t pageSize;
+    int slots;
+
+    // Touched only by the thread resolving translations in trace order.
+    std::unordered_map<u_int64_t, PrefetchRequest *> staged;
+    std::list<PrefetchRequest *> order;
+
+    // Shared with the I/O thread and with threads consuming staged pages.
+    pthread_mutex_t lock;
+    pthread_cond_t queued;
+    pthread_cond_t ready;
+    std::deque<PrefetchRequest *> queue;
+    std::vector<PrefetchRequest *> spare;
+    std::vector<PrefetchRequest *> allocated;
+    bool stopping;
+    // True while the I/O thread sleeps on an empty queue, so requests only signal it when it needs waking.
+    bool ioIdle;
+    pthread_t ioThread;
+
+    long long issued;
+    long long faults;
+    long long claimed;
+    long long late;
+    long long waits;
+    long long waitTime;
+    long long wasted;
+
+    void recycle(PrefetchRequest *request);
+    static void *runIO(void *param);
+};
+
+
+#endif //VIRTUALMEMORYMANAGER_PREFETCHER_H
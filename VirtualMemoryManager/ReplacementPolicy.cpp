@@ -0,0 +1,660 @@
+// ReplacementPolicy.cpp
+// The ReplacementPolicy classes choose which frame PhysicalMemory evicts when every frame is in use.
+
+#include "ReplacementPolicy.h"
+
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+
+#include "Checkpoint.h"
+#include "TraceReader.h"
+
+/** createReplacementPolicy
+ * Builds a replacement policy by name.
+ * @param name The policy name: fifo, lru, clock, second, lfu, arc or opt.
+ * @param frameCount The number of frames in physical memory.
+ * @param tracePath The trace that will be replayed, which OPT scans ahead of time.
+ * @param offsetBits The number of offset bits in an address, which OPT needs to find each page.
+ * @return The policy, or nullptr if the name is unknown.
+ */
+ReplacementPolicy *createReplacementPolicy(const std::string &name, int frameCount, const std::string &tracePath,
+                                           int offsetBits) {
+    if (name == "fifo")
+        return new FIFOPolicy();
+    if (name == "lru")
+        return new LRUPolicy(frameCount);
+    if (name == "clock")
+        return new ClockPolicy(frameCount);
+    if (name == "second")
+        return new SecondChancePolicy(frameCount);
+    if (name == "lfu")
+        return new LFUPolicy(frameCount);
+    if (name == "arc")
+        return new ARCPolicy(frameCount);
+    if (name == "opt")
+        return new OPTPolicy(frameCount, tracePath, offsetBits);
+    return nullptr;
+}
+
+/** seedFrames
+ * Loads the frames in the order they were loaded and then references them in the order they were last used,
+ * which rebuilds LRU and FIFO order exactly and gives the other policies a close approximation of their state.
+ * @param loadOrder The resident frames, least recently loaded first.
+ * @param useOrder The resident frames referenced since they were loaded, least recently used first.
+ * @param framePages The page in every frame.
+ * @param position The number of addresses translated so far.
+ */
+void ReplacementPolicy::seedFrames(const std::vector<int> &loadOrder, const std::vector<int> &useOrder,
+                                   const std::vector<u_int64_t> &framePages, u_int64_t position) {
+    for (int frame : loadOrder)
+        frameLoaded(frame, framePages[frame]);
+    for (int frame : useOrder)
+        frameAccessed(frame);
+}
+
+/** FrameList constructor
+ * @param frameCount The number of frames that can be linked.
+ */
+FrameList::FrameList(int frameCount) {
+    prev.assign(frameCount, -1);
+    next.assign(frameCount, -1);
+    owner.assign(frameCount, -1);
+    for (int l = 0; l < 2; l++) {
+        heads[l] = -1;
+        tails[l] = -1;
+        sizes[l] = 0;
+    }
+}
+
+/** pushFront
+ * Links a frame at the front of a list. The frame must not be in any list.
+ * @param list The list index.
+ * @param frame The frame number.
+ */
+void FrameList::pushFront(int list, int frame) {
+    prev[frame] = -1;
+    next[frame] = heads[list];
+    if (heads[list] != -1)
+        prev[heads[list]] = frame;
+    heads[list] = frame;
+    if (tails[list] == -1)
+        tails[list] = frame;
+    owner[frame] = list;
+    sizes[list]++;
+}
+
+/** remove
+ * Unlinks a frame from whichever list holds it.
+ * @param frame The frame number.
+ */
+void FrameList::remove(int frame) {
+    int list = owner[frame];
+    if (list == -1)
+        return;
+    if (prev[frame] != -1)
+        next[prev[frame]] = next[frame];
+    else
+        heads[list] = next[frame];
+    if (next[frame] != -1)
+        prev[next[frame]] = prev[frame];
+    else
+        tails[list] = prev[frame];
+    owner[frame] = -1;
+    sizes[list]--;
+}
+
+/** back
+ * @param list The list index.
+ * @return The frame at the back of the list, or -1 if it is empty.
+ */
+int FrameList::back(int list) {
+    return tails[list];
+}
+
+/** size
+ * @param list The list index.
+ * @return The number of frames in the list.
+ */
+int FrameList::size(int list) {
+    return sizes[list];
+}
+
+/** listOf
+ * @param frame The frame number.
+ * @return The list holding the frame, or -1.
+ */
+int FrameList::listOf(int frame) {
+    return owner[frame];
+}
+
+/** saveState
+ * Writes both lists, each from its back to its front.
+ * @param out The checkpoint being written.
+ */
+void FrameList::saveState(CheckpointWriter &out) {
+    for (int l = 0; l < 2; l++) {
+        out.put(sizes[l]);
+        for (int frame = tails[l]; frame != -1; frame = prev[frame])
+            out.put(frame);
+    }
+}
+
+/** loadState
+ * Rebuilds both lists, which must be empty, from what saveState wrote.
+ * @param in The checkpoint being read.
+ * @return True if every frame was read and is in range.
+ */
+bool FrameList::loadState(CheckpointReader &in) {
+    for (int l = 0; l < 2; l++) {
+        u_int64_t count = in.get();
+        for (u_int64_t i = 0; i < count && in.isValid(); i++) {
+            u_int64_t frame = in.get();
+            if (frame >= owner.size() || owner[frame] != -1)
+                return false;
+            pushFront(l, (int)frame);
+        }
+    }
+    return in.isValid();
+}
+
+/** FIFOPolicy::frameAccessed
+ * FIFO ignores references.
+ */
+void FIFOPolicy::frameAccessed(int frame) {
+}
+
+/** FIFOPolicy::frameLoaded
+ * Queues the frame behind every frame loaded before it.
+ */
+void FIFOPolicy::frameLoaded(int frame, u_int64_t page) {
+    queue.push_back(frame);
+}
+
+/** FIFOPolicy::selectVictim
+ * @return The frame that was loaded longest ago.
+ */
+int FIFOPolicy::selectVictim(u_int64_t incomingPage) {
+    int frame = queue.front();
+    queue.pop_front();
+    return frame;
+}
+
+/** FIFOPolicy::saveState
+ * Writes the queue, oldest frame first.
+ */
+void FIFOPolicy::saveState(CheckpointWriter &out) {
+    out.put(queue.size());
+    for (int frame : queue)
+        out.put(frame);
+}
+
+/** FIFOPolicy::loadState
+ * Reads the queue back.
+ */
+bool FIFOPolicy::loadState(CheckpointReader &in) {
+    u_int64_t count = in.get();
+    for (u_int64_t i = 0; i < count && in.isValid(); i++)
+        queue.push_back((int)in.get());
+    return in.isValid();
+}
+
+/** LRUPolicy constructor
+ * @param frameCount The number of frames in physical memory.
+ */
+LRUPolicy::LRUPolicy(int frameCount) : order(frameCount) {
+}
+
+/** LRUPolicy::frameAccessed
+ * Moves the frame to the most recently used end.
+ */
+void LRUPolicy::frameAccessed(int frame) {
+    order.remove(frame);
+    order.pushFront(0, frame);
+}
+
+/** LRUPolicy::frameLoaded
+ * Inserts the frame at the most recently used end.
+ */
+void LRUPolicy::frameLoaded(int frame, u_int64_t page) {
+    order.pushFront(0, frame);
+}
+
+/** LRUPolicy::selectVictim
+ * @return The least recently used frame.
+ */
+int LRUPolicy::selectVictim(u_int64_t incomingPage) {
+    int frame = order.back(0);
+    order.remove(frame);
+    return frame;
+}
+
+/** LRUPolicy::saveState
+ * Writes the frames from least to most recently used.
+ */
+void LRUPolicy::saveState(CheckpointWriter &out) {
+    order.saveState(out);
+}
+
+/** LRUPolicy::loadState
+ * Reads the order back.
+ */
+bool LRUPolicy::loadState(CheckpointReader &in) {
+    return order.loadState(in);
+}
+
+/** ClockPolicy constructor
+ * @param frameCount The number of frames in physical memory.
+ */
+ClockPolicy::ClockPolicy(int frameCount) {
+    referenced.assign(frameCount, 0);
+    hand = 0;
+}
+
+/** ClockPolicy::frameAccessed
+ * Sets the frame's reference bit.
+ */
+void ClockPolicy::frameAccessed(int frame) {
+    referenced[frame] = 1;
+}
+
+/** ClockPolicy::frameLoaded
+ * A newly loaded frame starts referenced.
+ */
+void ClockPolicy::frameLoaded(int frame, u_int64_t page) {
+    referenced[frame] = 1;
+}
+
+/** ClockPolicy::selectVictim
+ * Sweeps the hand over the frames, clearing reference bits until it finds one already clear.
+ * @return The first unreferenced frame under the hand.
+ */
+int ClockPolicy::selectVictim(u_int64_t incomingPage) {
+    int frameCount = (int)referenced.size();
+    while (referenced[hand]) {
+        referenced[hand] = 0;
+        hand = (hand + 1) % frameCount;
+    }
+    int frame = hand;
+    hand = (hand + 1) % frameCount;
+    return frame;
+}
+
+/** ClockPolicy::saveState
+ * Writes the hand and every reference bit.
+ */
+void ClockPolicy::saveState(CheckpointWriter &out) {
+    out.put(hand);
+    out.put(referenced.size());
+    for (u_int8_t bit : referenced)
+        out.put(bit);
+}
+
+/** ClockPolicy::loadState
+ * Reads the hand and reference bits back.
+ */
+bool ClockPolicy::loadState(CheckpointReader &in) {
+    hand = (int)in.get();
+    if (in.get() != referenced.size() || hand >= (int)referenced.size())
+        return false;
+    for (u_int8_t &bit : referenced)
+        bit = (u_int8_t)in.get();
+    return in.isValid();
+}
+
+/** SecondChancePolicy constructor
+ * @param frameCount The number of frames in physical memory.
+ */
+SecondChancePolicy::SecondChancePolicy(int frameCount) {
+    referenced.assign(frameCount, 0);
+}
+
+/** SecondChancePolicy::frameAccessed
+ * Sets the frame's reference bit.
+ */
+void SecondChancePolicy::frameAccessed(int frame) {
+    referenced[frame] = 1;
+}
+
+/** SecondChancePolicy::frameLoaded
+ * Queues the frame with its reference bit clear.
+ */
+void SecondChancePolicy::frameLoaded(int frame, u_int64_t page) {
+    referenced[frame] = 0;
+    queue.push_back(frame);
+}
+
+/** SecondChancePolicy::selectVictim
+ * Takes frames off the front of the FIFO queue, sending referenced ones to the back with their bit cleared.
+ * @return The oldest frame that was not referenced since it was last queued.
+ */
+int SecondChancePolicy::selectVictim(u_int64_t incomingPage) {
+    while (referenced[queue.front()]) {
+        referenced[queue.front()] = 0;
+        queue.push_back(queue.front());
+        queue.pop_front();
+    }
+    int frame = queue.front();
+    queue.pop_front();
+    return frame;
+}
+
+/** SecondChancePolicy::saveState
+ * Writes the queue, oldest frame first, and every reference bit.
+ */
+void SecondChancePolicy::saveState(CheckpointWriter &out) {
+    out.put(queue.size());
+    for (int frame : queue)
+        out.put(frame);
+    out.put(referenced.size());
+    for (u_int8_t bit : referenced)
+        out.put(bit);
+}
+
+/** SecondChancePolicy::loadState
+ * Reads the queue and reference bits back.
+ */
+bool SecondChancePolicy::loadState(CheckpointReader &in) {
+    u_int64_t count = in.get();
+    for (u_int64_t i = 0; i < count && in.isValid(); i++)
+        queue.push_back((int)in.get());
+    if (in.get() != referenced.size())
+        return false;
+    for (u_int8_t &bit : referenced)
+        bit = (u_int8_t)in.get();
+    return in.isValid();
+}
+
+/** LFUPolicy constructor
+ * @param frameCount The number of frames in physical memory.
+ */
+LFUPolicy::LFUPolicy(int frameCount) {
+    counts.assign(frameCount, 0);
+    lastUse.assign(frameCount, 0);
+    clock = 0;
+}
+
+/** LFUPolicy::frameAccessed
+ * Bumps the frame's use count. O(log n) in the frame count.
+ */
+void LFUPolicy::frameAccessed(int frame) {
+    byFrequency.erase({{counts[frame], lastUse[frame]}, frame});
+    counts[frame]++;
+    lastUse[frame] = ++clock;
+    byFrequency.insert({{counts[frame], lastUse[frame]}, frame});
+}
+
+/** LFUPolicy::frameLoaded
+ * Starts the frame with a use count of one.
+ */
+void LFUPolicy::frameLoaded(int frame, u_int64_t page) {
+    counts[frame] = 1;
+    lastUse[frame] = ++clock;
+    byFrequency.insert({{counts[frame], lastUse[frame]}, frame});
+}
+
+/** LFUPolicy::selectVictim
+ * @return The least frequently used frame, the least recently used one among ties.
+ */
+int LFUPolicy::selectVictim(u_int64_t incomingPage) {
+    int frame = byFrequency.begin()->second;
+    byFrequency.erase(byFrequency.begin());
+    return frame;
+}
+
+/** LFUPolicy::saveState
+ * Writes the clock and the use count and last use of every resident frame.
+ */
+void LFUPolicy::saveState(CheckpointWriter &out) {
+    out.put(clock);
+    out.put(byFrequency.size());
+    for (auto &entry : byFrequency) {
+        out.put(entry.second);
+        out.put(entry.first.first);
+        out.put(entry.first.second);
+    }
+}
+
+/** LFUPolicy::loadState
+ * Reads the frames back and files them by frequency again.
+ */
+bool LFUPolicy::loadState(CheckpointReader &in) {
+    clock = in.get();
+    u_int64_t count = in.get();
+    for (u_int64_t i = 0; i < count && in.isValid(); i++) {
+        u_int64_t frame = in.get();
+        if (frame >= counts.size())
+            return false;
+        counts[frame] = in.get();
+        lastUse[frame] = in.get();
+        byFrequency.insert({{counts[frame], lastUse[frame]}, (int)frame});
+    }
+    return in.isValid();
+}
+
+/** ARCPolicy constructor
+ * @param frameCount The number of frames in physical memory.
+ */
+ARCPolicy::ARCPolicy(int frameCount) : resident(frameCount) {
+    capacity = frameCount;
+    target = 0;
+    framePages.assign(frameCount, 0);
+}
+
+/** ARCPolicy::frameAccessed
+ * A hit promotes the frame to the most recently used end of T2.
+ */
+void ARCPolicy::frameAccessed(int frame) {
+    resident.remove(frame);
+    resident.pushFront(T2, frame);
+}
+
+/** ARCPolicy::frameLoaded
+ * A page remembered in B1 or B2 goes straight to T2; a new page starts in T1.
+ * The ghost lists are then trimmed so T1+B1 stays within the frame count and all four lists within twice that.
+ */
+void ARCPolicy::frameLoaded(int frame, u_int64_t page) {
+    framePages[frame] = page;
+    if (b1.contains(page)) {
+        b1.remove(page);
+        resident.pushFront(T2, frame);
+    } else if (b2.contains(page)) {
+        b2.remove(page);
+        resident.pushFront(T2, frame);
+    } else {
+        resident.pushFront(T1, frame);
+    }
+
+    while (b1.size() > 0 && resident.size(T1) + b1.size() > capacity)
+        b1.popBack();
+    while (b2.size() > 0 && resident.size(T1) + resident.size(T2) + b1.size() + b2.size() > 2 * capacity)
+        b2.popBack();
+}
+
+/** ARCPolicy::selectVictim
+ * Adapts the target size of T1 when the incoming page is a ghost hit, then evicts from T1 if it is over target
+ * and from T2 otherwise. The evicted page is remembered in the matching ghost list.
+ * @return The evicted frame.
+ */
+int ARCPolicy::selectVictim(u_int64_t incomingPage) {
+    bool inB2 = b2.contains(incomingPage);
+    if (b1.contains(incomingPage)) {
+        int step = b1.size() >= b2.size() ? 1 : b2.size() / b1.size();
+        target = std::min(capacity, target + step);
+    } else if (inB2) {
+        int step = b2.size() >= b1.size() ? 1 : b1.size() / b2.size();
+        target = std::max(0, target - step);
+    }
+
+    int t1Size = resident.size(T1);
+    int frame;
+    if (t1Size > 0 && (t1Size > target || (inB2 && t1Size == target) || resident.size(T2) == 0)) {
+        frame = resident.back(T1);
+        b1.pushFront(framePages[frame]);
+    } else {
+        frame = resident.back(T2);
+        b2.pushFront(framePages[frame]);
+    }
+    resident.remove(frame);
+    return frame;
+}
+
+/** ARCPolicy::saveState
+ * Writes the target size of T1, the resident lists with their pages, and both ghost lists, oldest page first.
+ */
+void ARCPolicy::saveState(CheckpointWriter &out) {
+    out.put(target);
+    resident.saveState(out);
+    out.put(framePages.size());
+    for (u_int64_t page : framePages)
+        out.put(page);
+    for (GhostList *ghosts : {&b1, &b2}) {
+        out.put(ghosts->size());
+        for (auto page = ghosts->pages.rbegin(); page != ghosts->pages.rend(); ++page)
+            out.put(*page);
+    }
+}
+
+/** ARCPolicy::loadState
+ * Reads the lists back.
+ */
+bool ARCPolicy::loadState(CheckpointReader &in) {
+    target = (int)in.get();
+    if (!resident.loadState(in) || in.get() != framePages.size())
+        return false;
+    for (u_int64_t &page : framePages)
+        page = in.get();
+    for (GhostList *ghosts : {&b1, &b2}) {
+        u_int64_t count = in.get();
+        for (u_int64_t i = 0; i < count && in.isValid(); i++)
+            ghosts->pushFront(in.get());
+    }
+    return in.isValid();
+}
+
+/** OPTPolicy constructor
+ * Scans the whole trace up front and records every position each page is referenced at.
+ * This is the only policy whose memory grows with the trace.
+ * @param frameCount The number of frames in physical memory.
+ * @param tracePath The trace that will be replayed.
+ * @param offsetBits The number of offset bits in an address.
+ */
+OPTPolicy::OPTPolicy(int frameCount, const std::string &tracePath, int offsetBits) {
+    framePages.assign(frameCount, 0);
+    nextUse.assign(frameCount, 0);
+    replayed = 0;
+
+    TraceReader reader(tracePath);
+    if (!reader.isOpen()) {
+        std::cerr << "Error opening file: " << tracePath << std::endl;
+        exit(1);
+    }
+    std::vector<u_int64_t> addresses(TRACE_BLOCK_SIZE / sizeof(u_int64_t));
+    u_int64_t position = 0;
+    int count;
+    while ((count = reader.readAddresses(addresses.data(), (int)addresses.size())) > 0) {
+        for (int i = 0; i < count; i++)
+            uses[(addresses[i] & ~TRACE_WRITE_BIT) >> offsetBits].positions.push_back(position++);
+    }
+}
+
+/** advance
+ * Consumes the current reference to a page and re-files its frame under the page's next reference.
+ * @param frame The frame holding the page.
+ * @param page The page number.
+ */
+void OPTPolicy::advance(int frame, u_int64_t page) {
+    PageUses &pageUses = uses[page];
+    pageUses.cursor++;
+    replayed++;
+    nextUse[frame] = pageUses.cursor < pageUses.positions.size() ? pageUses.positions[pageUses.cursor] : ~0ull;
+    byNextUse.insert({nextUse[frame], frame});
+}
+
+/** OPTPolicy::frameAccessed
+ * O(log n) in the frame count.
+ */
+void OPTPolicy::frameAccessed(int frame) {
+    byNextUse.erase({nextUse[frame], frame});
+    advance(frame, framePages[frame]);
+}
+
+/** OPTPolicy::frameLoaded
+ * Files the frame under the next reference to its page.
+ */
+void OPTPolicy::frameLoaded(int frame, u_int64_t page) {
+    framePages[frame] = page;
+    advance(frame, page);
+}
+
+/** OPTPolicy::selectVictim
+ * @return The frame whose page is referenced furthest in the future, or never again.
+ */
+int OPTPolicy::selectVictim(u_int64_t incomingPage) {
+    auto last = std::prev(byNextUse.end());
+    int frame = last->second;
+    byNextUse.erase(last);
+    return frame;
+}
+
+/** seek
+ * Moves every page's cursor to a trace position and files the resident frames under their next references,
+ * as if the trace had been replayed up to it.
+ * @param position The number of references replayed.
+ * @param frames The resident frames, whose pages must already be in framePages.
+ */
+void OPTPolicy::seek(u_int64_t position, const std::vector<int> &frames) {
+    for (auto &entry : uses) {
+        std::vector<u_int64_t> &positions = entry.second.positions;
+        entry.second.cursor = std::lower_bound(positions.begin(), positions.end(), position) - positions.begin();
+    }
+    replayed = position;
+    byNextUse.clear();
+    for (int frame : frames) {
+        PageUses &pageUses = uses[framePages[frame]];
+        nextUse[frame] = pageUses.cursor < pageUses.positions.size() ? pageUses.positions[pageUses.cursor] : ~0ull;
+        byNextUse.insert({nextUse[frame], frame});
+    }
+}
+
+/** OPTPolicy::saveState
+ * Writes the trace position and the resident frames with their pages; the rest follows from the trace.
+ */
+void OPTPolicy::saveState(CheckpointWriter &out) {
+    out.put(replayed);
+    out.put(byNextUse.size());
+    for (auto &entry : byNextUse) {
+        out.put(entry.second);
+        out.put(framePages[entry.second]);
+    }
+}
+
+/** OPTPolicy::loadState
+ * Reads the frames back and seeks to the trace position.
+ */
+bool OPTPolicy::loadState(CheckpointReader &in) {
+    u_int64_t position = in.get();
+    u_int64_t count = in.get();
+    std::vector<int> frames;
+    for (u_int64_t i = 0; i < count && in.isValid(); i++) {
+        u_int64_t frame = in.get();
+        if (frame >= framePages.size())
+            return false;
+        framePages[frame] = in.get();
+        frames.push_back((int)frame);
+    }
+    if (!in.isValid())
+        return false;
+    seek(position, frames);
+    return true;
+}
+
+/** OPTPolicy::seedFrames
+ * OPT's state depends only on the trace position, so frames from another policy are filed exactly.
+ */
+void OPTPolicy::seedFrames(const std::vector<int> &loadOrder, const std::vector<int> &useOrder,
+                           const std::vector<u_int64_t> &framePages, u_int64_t position) {
+    for (int frame : loadOrder)
+        this->framePages[frame] = framePages[frame];
+    seek(position, loadOrder);
+}
@@ -0,0 +1,220 @@
+// ReplacementPolicy.h
+// The ReplacementPolicy classes choose which frame PhysicalMemory evicts when every frame is in use.
+// PhysicalMemory reports every access to a resident frame and every page it loads, and asks for a victim
+// when it needs a frame back. Each policy keeps those hot paths at O(1) or O(log n) in the frame count.
+
+#ifndef VIRTUALMEMORYMANAGER_REPLACEMENTPOLICY_H
+#define VIRTUALMEMORYMANAGER_REPLACEMENTPOLICY_H
+
+#include <cstdlib>
+#include <deque>
+#include <list>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "address.h"
+
+class CheckpointWriter;
+class CheckpointReader;
+
+class ReplacementPolicy {
+public:
+    virtual ~ReplacementPolicy() {}
+    virtual const char *getName() = 0;
+    // A resident frame was referenced.
+    virtual void frameAccessed(int frame) = 0;
+    // A page was loaded into a frame that is now resident.
+    virtual void frameLoaded(int frame, u_int64_t page) = 0;
+    // Every frame is resident and incomingPage needs one; remove a frame from the policy and return it.
+    virtual int selectVictim(u_int64_t incomingPage) = 0;
+    // Writes the policy's own state to a checkpoint, and reads it back into a policy that has seen nothing yet.
+    virtual void saveState(CheckpointWriter &out) = 0;
+    virtual bool loadState(CheckpointReader &in) = 0;
+    // Gives a policy that has seen nothing yet the frames resident under another policy, position addresses in.
+    virtual void seedFrames(const std::vector<int> &loadOrder, const std::vector<int> &useOrder,
+                            const std::vector<u_int64_t> &framePages, u_int64_t position);
+};
+
+ReplacementPolicy *createReplacementPolicy(const std::string &name, int frameCount, const std::string &tracePath,
+                                           int offsetBits = OFFSET_BITS);
+
+/** FrameList
+ * An intrusive doubly-linked list over frame indices, most recently inserted at the front.
+ * Several lists can share one FrameList object as long as each frame is in at most one of them.
+ */
+class FrameList {
+public:
+    FrameList(int frameCount);
+    void pushFront(int list, int frame);
+    void remove(int frame);
+    int back(int list);
+    int size(int list);
+    int listOf(int frame);
+    void saveState(CheckpointWriter &out);
+    bool loadState(CheckpointReader &in);
+
+private:
+    std::vector<int> prev;
+    std::vector<int> next;
+    std::vector<int> owner;
+    int heads[2];
+    int tails[2];
+    int sizes[2];
+};
+
+class FIFOPolicy : public ReplacementPolicy {
+public:
+    const char *getName() override { return "fifo"; }
+    void frameAccessed(int frame) override;
+    void frameLoaded(int frame, u_int64_t page) override;
+    int selectVictim(u_int64_t incomingPage) override;
+    void saveState(CheckpointWriter &out) override;
+    bool loadState(CheckpointReader &in) override;
+
+private:
+    std::deque<int> queue;
+};
+
+class LRUPolicy : public ReplacementPolicy {
+public:
+    LRUPolicy(int frameCount);
+    const char *getName() override { return "lru"; }
+    void frameAccessed(int frame) override;
+    void frameLoaded(int frame, u_int64_t page) override;
+    int selectVictim(u_int64_t incomingPage) override;
+    void saveState(CheckpointWriter &out) override;
+    bool loadState(CheckpointReader &in) override;
+
+private:
+    FrameList order;
+};
+
+class ClockPolicy : public ReplacementPolicy {
+public:
+    ClockPolicy(int frameCount);
+    const char *getName() override { return "clock"; }
+    void frameAccessed(int frame) override;
+    void frameLoaded(int frame, u_int64_t page) override;
+    int selectVictim(u_int64_t incomingPage) override;
+    void saveState(CheckpointWriter &out) override;
+    bool loadState(CheckpointReader &in) override;
+
+private:
+    std::vector<u_int8_t> referenced;
+    int hand;
+};
+
+class SecondChancePolicy : public ReplacementPolicy {
+public:
+    SecondChancePolicy(int frameCount);
+    const char *getName() override { return "second"; }
+    void frameAccessed(int frame) override;
+    void frameLoaded(int frame, u_int64_t page) override;
+    int selectVictim(u_int64_t incomingPage) override;
+    void saveState(CheckpointWriter &out) override;
+    bool loadState(CheckpointReader &in) override;
+
+private:
+    std::deque<int> queue;
+    std::vector<u_int8_t> referenced;
+};
+
+class LFUPolicy : public ReplacementPolicy {
+public:
+    LFUPolicy(int frameCount);
+    const char *getName() override { return "lfu"; }
+    void frameAccessed(int frame) override;
+    void frameLoaded(int frame, u_int64_t page) override;
+    int selectVictim(u_int64_t incomingPage) override;
+    void saveState(CheckpointWriter &out) override;
+    bool loadState(CheckpointReader &in) override;
+
+private:
+    // Ordered by (use count, last use), so the least frequently used frame is first and ties go to the older one.
+    std::set<std::pair<std::pair<u_int64_t, u_int64_t>, int>> byFrequency;
+    std::vector<u_int64_t> counts;
+    std::vector<u_int64_t> lastUse;
+    u_int64_t clock;
+};
+
+class ARCPolicy : public ReplacementPolicy {
+public:
+    ARCPolicy(int frameCount);
+    const char *getName() override { return "arc"; }
+    void frameAccessed(int frame) override;
+    void frameLoaded(int frame, u_int64_t page) override;
+    int selectVictim(u_int64_t incomingPage) override;
+    void saveState(CheckpointWriter &out) override;
+    bool loadState(CheckpointReader &in) override;
+
+private:
+    // T1 holds pages seen once recently, T2 pages seen at least twice. B1 and B2 remember pages evicted from each.
+    static const int T1 = 0;
+    static const int T2 = 1;
+
+    /** GhostList
+     * An LRU list of evicted page numbers with O(1) membership checks. Private copies of one page in several
+     * address spaces share its number, so a page already in the list is moved to the front instead of added twice.
+     */
+    struct GhostList {
+        std::list<u_int64_t> pages;
+        std::unordered_map<u_int64_t, std::list<u_int64_t>::iterator> index;
+
+        bool contains(u_int64_t page) { return index.count(page) != 0; }
+        void pushFront(u_int64_t page) {
+            if (contains(page))
+                remove(page);
+            pages.push_front(page);
+            index[page] = pages.begin();
+        }
+        void remove(u_int64_t page) { pages.erase(index[page]); index.erase(page); }
+        void popBack() { index.erase(pages.back()); pages.pop_back(); }
+        int size() { return (int)pages.size(); }
+    };
+
+    int capacity;
+    int target;
+    FrameList resident;
+    std::vector<u_int64_t> framePages;
+    GhostList b1;
+    GhostList b2;
+};
+
+class OPTPolicy : public ReplacementPolicy {
+public:
+    OPTPolicy(int frameCount, const std::string &tracePath, int offsetBits);
+    const char *getName() override { return "opt"; }
+    void frameAccessed(int frame) override;
+    void frameLoaded(int frame, u_int64_t page) override;
+    int selectVictim(u_int64_t incomingPage) override;
+    void saveState(CheckpointWriter &out) override;
+    bool loadState(CheckpointReader &in) override;
+    void seedFrames(const std::vector<int> &loadOrder, const std::vector<int> &useOrder,
+                    const std::vector<u_int64_t> &framePages, u_int64_t position) override;
+
+private:
+    /** PageUses
+     * Every position in the trace where a page is referenced, and how many of those have been replayed.
+     */
+    struct PageUses {
+        std::vector<u_int64_t> positions;
+        size_t cursor = 0;
+    };
+
+    std::unordered_map<u_int64_t, PageUses> uses;
+    // Ordered by next use, so the frame needed furthest in the future is last.
+    std::set<std::pair<u_int64_t, int>> byNextUse;
+    std::vector<u_int64_t> framePages;
+    std::vector<u_int64_t> nextUse;
+    // References replayed so far, which is also the trace position of the next one.
+    u_int64_t replayed;
+
+    void advance(int frame, u_int64_t page);
+    void seek(u_int64_t position, const std::vector<int> &frames);
+};
+
+
+#endif //VIRTUALMEMORYMANAGER_REPLACEMENTPOLICY_H
@@ -0,0 +1,241 @@
+// ReuseDistance.cpp
+// The ReuseDistance class measures the reuse (LRU stack) distance of every reference in a page stream in one
+// pass, exactly or on a hashed sample of pages.
+
+#include "ReuseDistance.h"
+
+#include <algorithm>
+
+/** samplePoint
+ * Fibonacci hashing, as the hashed page table uses: the top bits of the product are well mixed even for runs of
+ * consecutive pages, so a sample of pages is spread over the whole address space.
+ * @param page The page number.
+ * @return The hash, below REUSE_SAMPLE_MODULUS.
+ */
+static inline u_int64_t samplePoint(u_int64_t page) {
+    return (page * 0x9E3779B97F4A7C15ull) >> 40;
+}
+
+/** ReuseDistance constructor
+ * @param sampleRate The fraction of pages tracked, in (0, 1]; 1 measures every reference exactly.
+ */
+ReuseDistance::ReuseDistance(double sampleRate) {
+    if (sampleRate <= 0 || sampleRate > 1)
+        sampleRate = 1;
+    this->threshold = (u_int64_t)(sampleRate * REUSE_SAMPLE_MODULUS);
+    if (this->threshold == 0)
+        this->threshold = 1;
+    this->sampleRate = (double)this->threshold / REUSE_SAMPLE_MODULUS;
+    this->accesses = 0;
+    this->sampled = 0;
+    this->nextStamp = 0;
+    this->cold = 0;
+    this->tree.assign(REUSE_MIN_STAMPS + 1, 0);
+    this->stampPages.resize(REUSE_MIN_STAMPS);
+    for (int b = 0; b < 64; b++) {
+        this->timeCounts[b] = 0;
+        this->timeSums[b] = 0;
+    }
+}
+
+/** add
+ * Adds to the count at a stamp.
+ * @param stamp The stamp.
+ * @param delta 1 when a page's last reference moves to the stamp, -1 when it moves away.
+ */
+void ReuseDistance::add(u_int64_t stamp, int delta) {
+    for (u_int64_t i = stamp + 1; i < tree.size(); i += i & (0 - i))
+        tree[i] += delta;
+}
+
+/** prefix
+ * @param stamp The stamp.
+ * @return The number of tracked pages last referenced at or before the stamp.
+ */
+u_int64_t ReuseDistance::prefix(u_int64_t stamp) {
+    u_int64_t sum = 0;
+    for (u_int64_t i = stamp + 1; i > 0; i -= i & (0 - i))
+        sum += tree[i];
+    return sum;
+}
+
+/** compact
+ * Renumbers the live stamps 0 to M - 1 in their current order, dropping stale ones, and rebuilds the tree with
+ * room for as many new stamps again. Each compaction follows at least M new stamps, so the work per reference
+ * stays constant.
+ */
+void ReuseDistance::compact() {
+    u_int64_t live = 0;
+    for (u_int64_t s = 0; s < nextStamp; s++) {
+        PageState &state = pages[stampPages[s]];
+        if (state.stamp == s) {
+            state.stamp = live;
+            stampPages[live++] = stampPages[s];
+        }
+    }
+    u_int64_t capacity = live * 2 > REUSE_MIN_STAMPS ? live * 2 : REUSE_MIN_STAMPS;
+    stampPages.resize(capacity);
+    // Every live stamp has a count of 1, so each tree node holds the length of the range it covers.
+    tree.assign(capacity + 1, 0);
+    for (u_int64_t i = 1; i <= capacity; i++) {
+        if (i <= live)
+            tree[i]++;
+        u_int64_t parent = i + (i & (0 - i));
+        if (parent < tree.size())
+            tree[parent] += tree[i];
+    }
+    nextStamp = live;
+}
+
+/** access
+ * Records one reference. A page seen before has its distance counted as the number of tracked pages referenced
+ * since, and its reuse time as the references since; a page seen for the first time is a cold miss.
+ * @param page The page number.
+ */
+void ReuseDistance::access(u_int64_t page) {
+    u_int64_t time = accesses++;
+    if (samplePoint(page) >= threshold)
+        return;
+    sampled++;
+    if (nextStamp == stampPages.size())
+        compact();
+    u_int64_t stamp = nextStamp++;
+    stampPages[stamp] = page;
+
+    auto inserted = pages.emplace(page, PageState{stamp, time});
+    if (inserted.second) {
+        cold++;
+    } else {
+        PageState &state = inserted.first->second;
+        u_int64_t distance = pages.size() - prefix(state.stamp);
+        if (distance >= distances.size())
+            distances.resize(distance + 1, 0);
+        distances[distance]++;
+
+        u_int64_t reuseTime = time - state.time;
+        int bucket = 63 - __builtin_clzll(reuseTime);
+        timeCounts[bucket]++;
+        timeSums[bucket] += reuseTime;
+
+        add(state.stamp, -1);
+        state.stamp = stamp;
+        state.time = time;
+    }
+    add(stamp, 1);
+}
+
+/** getSampleRate
+ * @return The fraction of pages tracked, after rounding to the hash's resolution.
+ */
+double ReuseDistance::getSampleRate() {
+    return sampleRate;
+}
+
+/** getAccessCount
+ * @return The number of references recorded.
+ */
+u_int64_t ReuseDistance::getAccessCount() {
+    return accesses;
+}
+
+/** getSampledCount
+ * @return The number of references to tracked pages.
+ */
+u_int64_t ReuseDistance::getSampledCount() {
+    return sampled;
+}
+
+/** getDistinctPages
+ * @return The number of distinct pages referenced, estimated from the tracked ones when sampling.
+ */
+double ReuseDistance::getDistinctPages() {
+    return pages.size() / sampleRate;
+}
+
+/** getMisses
+ * @param size The number of entries in a fully associative LRU cache of pages, at least 1.
+ * @return The number of references that would miss in it, estimated from the tracked ones when sampling.
+ */
+double ReuseDistance::getMisses(u_int64_t size) {
+    // A sampled distance d stands for d / sampleRate pages.
+    double misses = cold;
+    for (size_t d = 0; d < distances.size(); d++) {
+        if (d / sampleRate >= size)
+            misses += distances[d];
+    }
+    return misses / sampleRate;
+}
+
+/** getMissRatio
+ * When sampling, the references to tracked pages are rarely exactly the sample rate's share of all references,
+ * since a few hot pages being in or out of the sample swings them. The difference is taken to be hits (as in
+ * SHARDS-adj), so misses are divided by all references rather than by the sampled ones.
+ * @param size The number of entries in a fully associative LRU cache of pages, at least 1.
+ * @return The fraction of references that would miss in it.
+ */
+double ReuseDistance::getMissRatio(u_int64_t size) {
+    if (accesses == 0)
+        return 0;
+    double ratio = getMisses(size) / accesses;
+    return ratio < 1 ? ratio : 1;
+}
+
+/** getCurve
+ * Lists the whole miss ratio curve. It is a step function that only drops where some reference's distance
+ * fits for the first time, so those sizes are all that are listed.
+ * @param points Filled with (size, miss ratio) pairs in increasing size, as getMissRatio gives them; size 1 is
+ * always first.
+ */
+void ReuseDistance::getCurve(std::vector<std::pair<u_int64_t, double>> &points) {
+    points.clear();
+    if (sampled == 0)
+        return;
+    // misses counts the sampled references with a distance of d or more; see getMissRatio for the scaling.
+    u_int64_t misses = sampled - (distances.empty() ? 0 : distances[0]);
+    double scale = 1 / (sampleRate * accesses);
+    points.push_back({1, std::min(misses * scale, 1.0)});
+    for (size_t d = 1; d < distances.size(); d++) {
+        if (distances[d] == 0)
+            continue;
+        u_int64_t size = (u_int64_t)(d / sampleRate) + 1;
+        misses -= distances[d];
+        if (size > points.back().first)
+            points.push_back({size, std::min(misses * scale, 1.0)});
+        else
+            points.back().second = std::min(misses * scale, 1.0);
+    }
+}
+
+/** getWorkingSetSize
+ * The average number of distinct pages referenced in the window of references ending at each point of the trace
+ * (cut short at its start). A reference is counted in every window that ends before the next reference to its
+ * page and is no more than the window length later, so over all windows it counts min(forward reuse time,
+ * window) times, and a page's last reference min(window, references left) times. Forward reuse times are the
+ * backward ones paired the other way round, so the sum is exact whenever the window is a power of two.
+ * @param window The window length in references, at least 1.
+ * @return The average working set size in pages, estimated from the tracked ones when sampling.
+ */
+double ReuseDistance::getWorkingSetSize(u_int64_t window) {
+    if (accesses == 0)
+        return 0;
+    double sum = 0;
+    for (int b = 0; b < 64; b++) {
+        if (timeCounts[b] == 0)
+            continue;
+        u_int64_t low = 1ull << b;
+        if (low >= window)
+            sum += (double)timeCounts[b] * window;
+        else if (b == 63 || (low << 1) <= window)
+            sum += timeSums[b];
+        else {
+            // The bucket straddles the window; assume its times are spread evenly.
+            double below = (double)(window - low) / low;
+            sum += timeCounts[b] * (below * (low + window) / 2 + (1 - below) * window);
+        }
+    }
+    for (auto &entry : pages) {
+        u_int64_t left = accesses - entry.second.time;
+        sum += left < window ? left : window;
+    }
+    return sum / accesses / sampleRate;
+}
@@ -0,0 +1,72 @@
+// ReuseDistance.h
+// The ReuseDistance class measures the reuse (LRU stack) distance of every reference in a page stream in one
+// pass, and from it the miss ratio of a fully associative LRU cache of any size: a reference misses in a cache of
+// C entries exactly when C or more distinct pages were touched since the page's last reference.
+// Distances come from a Fenwick tree over access stamps in O(log M) per reference for M distinct pages. With a
+// sample rate below 1, only pages whose hash falls under the rate are tracked and their distances are scaled up
+// (fixed-rate SHARDS), which bounds memory for traces with huge footprints.
+// Reuse times (references since the page's last reference) are kept too, and give the average working set size
+// for any window, as in Denning and Schwartz.
+
+#ifndef VIRTUALMEMORYMANAGER_REUSEDISTANCE_H
+#define VIRTUALMEMORYMANAGER_REUSEDISTANCE_H
+
+#include <cstdlib>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Stamps are compacted once this many have been handed out, or twice the live pages if that is more.
+#define REUSE_MIN_STAMPS 4096
+// Pages are sampled by comparing a hash of the page with the rate scaled to this modulus.
+#define REUSE_SAMPLE_MODULUS (1ull << 24)
+
+class ReuseDistance {
+public:
+    ReuseDistance(double sampleRate = 1.0);
+    void access(u_int64_t page);
+    double getSampleRate();
+    u_int64_t getAccessCount();
+    u_int64_t getSampledCount();
+    double getDistinctPages();
+    double getMisses(u_int64_t size);
+    double getMissRatio(u_int64_t size);
+    void getCurve(std::vector<std::pair<u_int64_t, double>> &points);
+    double getWorkingSetSize(u_int64_t window);
+
+private:
+    /** PageState
+     * Where a tracked page was last referenced: its stamp in the tree and the reference count at the time.
+     */
+    struct PageState {
+        u_int64_t stamp;
+        u_int64_t time;
+    };
+
+    double sampleRate;
+    u_int64_t threshold;
+    u_int64_t accesses;
+    u_int64_t sampled;
+
+    std::unordered_map<u_int64_t, PageState> pages;
+    // tree is a Fenwick tree with a 1 at the stamp of every tracked page's last reference.
+    std::vector<u_int32_t> tree;
+    // stampPages[s] is the page stamped s, kept so stamps can be compacted; stale stamps hold the page too, but
+    // are told apart because the page's current stamp differs.
+    std::vector<u_int64_t> stampPages;
+    u_int64_t nextStamp;
+
+    // distances[d] is the number of sampled references at (unscaled) distance d; first references are cold.
+    std::vector<u_int64_t> distances;
+    u_int64_t cold;
+    // Reuse times in power-of-two buckets: bucket b holds times in [2^b, 2^(b+1)), with their count and sum.
+    u_int64_t timeCounts[64];
+    double timeSums[64];
+
+    void add(u_int64_t stamp, int delta);
+    u_int64_t prefix(u_int64_t stamp);
+    void compact();
+};
+
+
+#endif //VIRTUALMEMORYMANAGER_REUSEDISTANCE_H
@@ -1,14 +1,39 @@
 // TLB.cpp
 // Created by Brian Cassriel on 5/5/24.
-// The TLB class is a simple associative array that represents the Translation Lookaside Buffer (TLB).
+// The TLB class is a fixed-size set-associative array with O(1) LRU replacement inside each set.
 
 #include "TLB.h"
 
+#include "Checkpoint.h"
+
 /** TLB constructor
- * Initializes the TLB.
+ * Initializes every slot as invalid and every set's LRU list as empty.
+ * The number of sets is rounded down to a power of two so a page's set is picked by its low bits.
+ * @param size The number of entries in the TLB.
+ * @param ways The number of entries per set, or 0 for a fully associative TLB.
  */
-TLB::TLB() {
+TLB::TLB(int size, int ways) {
+    if (size < 1)
+        size = 1;
+    if (ways < 1 || ways > size)
+        ways = size;
+    int sets = 1;
+    while (sets * 2 <= size / ways)
+        sets *= 2;
+    this->ways = ways;
+    this->size = sets * ways;
+    this->setMask = sets - 1;
+    pages.assign(this->size, 0);
+    frames.assign(this->size, 0);
+    valid.assign(this->size, 0);
+    prev.assign(this->size, -1);
+    next.assign(this->size, -1);
+    heads.assign(sets, -1);
+    tails.assign(sets, -1);
+    used.assign(sets, 0);
+    lastSlot = -1;
     tlbHits = 0;
+    lookups = 0;
 }
 
 /** TLB destructor
@@ -16,56 +41,142 @@ TLB::TLB() {
 TLB::~TLB() {
 }
 
+/** findSlot
+ * Finds the slot holding a page. The most recently found slot is checked first,
+ * since the translation loop always asks about the same page several times in a row.
+ * @param page The page number.
+ * @return The slot index, or -1 if the page is not in the TLB.
+ */
+int TLB::findSlot(u_int64_t page) {
+    if (lastSlot >= 0 && valid[lastSlot] && pages[lastSlot] == page)
+        return lastSlot;
+    int set = (int)(page & setMask);
+    int first = set * ways;
+    int end = first + used[set];
+    for (int i = first; i < end; i++) {
+        if (valid[i] && pages[i] == page) {
+            lastSlot = i;
+            return i;
+        }
+    }
+    return -1;
+}
+
+/** unlink
+ * Removes a slot from its set's LRU list.
+ * @param set The set index.
+ * @param slot The slot index.
+ */
+void TLB::unlink(int set, int slot) {
+    if (prev[slot] != -1)
+        next[prev[slot]] = next[slot];
+    else
+        heads[set] = next[slot];
+    if (next[slot] != -1)
+        prev[next[slot]] = prev[slot];
+    else
+        tails[set] = prev[slot];
+    prev[slot] = -1;
+    next[slot] = -1;
+}
+
+/** pushFront
+ * Inserts a slot at the most recently used end of its set's LRU list.
+ * @param set The set index.
+ * @param slot The slot index.
+ */
+void TLB::pushFront(int set, int slot) {
+    prev[slot] = -1;
+    next[slot] = heads[set];
+    if (heads[set] != -1)
+        prev[heads[set]] = slot;
+    heads[set] = slot;
+    if (tails[set] == -1)
+        tails[set] = slot;
+}
+
 /** addEntry
- * Adds an entry to the TLB.
+ * Adds an entry to the TLB, or refreshes it if the page is already present.
+ * When the page's set is full its least recently used entry is replaced.
  * @param page The page number.
  * @param frame The frame number.
  */
-void TLB::addEntry(u_int8_t page, u_int8_t frame) {
-    if (tlb.find(page) != tlb.end()) {
-        tlb[page] = frame;
-        for (std::pair<const unsigned char, int> & i : lru) {
-            i.second++;
+void TLB::addEntry(u_int64_t page, u_int32_t frame) {
+    int set = (int)(page & setMask);
+    int slot = findSlot(page);
+    if (slot != -1) {
+        frames[slot] = frame;
+        if (heads[set] != slot) {
+            unlink(set, slot);
+            pushFront(set, slot);
         }
+        return;
+    }
+
+    if (used[set] < ways && (tails[set] == -1 || valid[tails[set]])) {
+        slot = set * ways + used[set]++;
     } else {
-        if (tlb.size() == MAX_TLB_SIZE) {
-            removeLRU();
-            tlb[page] = frame;
-            lru[page] = 0;
-        } else {
-            tlb[page] = frame;
-            for (std::pair<const unsigned char, int>& i : lru) {
-                i.second++;
-            }
-            lru[page] = 0;
-        }
+        slot = tails[set];
+        unlink(set, slot);
     }
+    pages[slot] = page;
+    frames[slot] = frame;
+    valid[slot] = 1;
+    pushFront(set, slot);
+    lastSlot = slot;
 }
 
-/** removeLRU
- * Removes the least recently used entry from the TLB.
+/** removeEntry
+ * Invalidates the entry for a page, e.g. when its frame is evicted.
+ * The slot moves to the LRU end of its set so it is the next one reused.
+ * @param page The page number.
  */
-void TLB::removeLRU() {
-    int longestSinceUse = 0;
-    u_int8_t oldestPage;
-
-    for (std::pair<const unsigned char, int> currPage : lru) {
-        if (currPage.second > longestSinceUse) {
-            longestSinceUse = currPage.second;
-            oldestPage = currPage.first;
-        }
+void TLB::removeEntry(u_int64_t page) {
+    int slot = findSlot(page);
+    if (slot == -1)
+        return;
+    int set = (int)(page & setMask);
+    valid[slot] = 0;
+    if (tails[set] != slot) {
+        unlink(set, slot);
+        prev[slot] = tails[set];
+        next[slot] = -1;
+        if (tails[set] != -1)
+            next[tails[set]] = slot;
+        tails[set] = slot;
+        if (heads[set] == -1)
+            heads[set] = slot;
     }
-    lru.erase(oldestPage);
-    tlb.erase(oldestPage);
+}
+
+/** flush
+ * Invalidates every entry, e.g. on an address space switch. The hit and lookup counts are kept.
+ * @return The number of valid entries that were dropped.
+ */
+int TLB::flush() {
+    int dropped = 0;
+    for (u_int8_t v : valid)
+        dropped += v;
+    valid.assign(size, 0);
+    prev.assign(size, -1);
+    next.assign(size, -1);
+    heads.assign(heads.size(), -1);
+    tails.assign(tails.size(), -1);
+    used.assign(used.size(), 0);
+    lastSlot = -1;
+    return dropped;
 }
 
 /** getFrame
  * Gets the frame number from the TLB.
  * @param page The page number.
- * @return The frame number.
+ * @return The frame number, or -1 if the page is not in the TLB.
  */
-int TLB::getFrame(u_int8_t page) {
-    return tlb[page];
+int TLB::getFrame(u_int64_t page) {
+    int slot = findSlot(page);
+    if (slot == -1)
+        return -1;
+    return frames[slot];
 }
 
 /** containsPage
@@ -73,8 +184,9 @@ int TLB::getFrame(u_int8_t page) {
  * @param page The page number.
  * @return True if the page is in the TLB.
  */
-bool TLB::containsPage(u_int8_t page) {
-    if (tlb.find(page) != tlb.end()) {
+bool TLB::containsPage(u_int64_t page) {
+    lookups++;
+    if (findSlot(page) != -1) {
         tlbHits++;
         return true;
     } else {
@@ -82,10 +194,101 @@ bool TLB::containsPage(u_int8_t page) {
     }
 }
 
+/** lookup
+ * Does what containsPage, getFrame and addEntry do for a hit, with a single probe:
+ * counts the hit and makes the entry the most recently used in its set.
+ * @param page The page number.
+ * @return The frame number, or -1 if the page is not in the TLB.
+ */
+int TLB::lookup(u_int64_t page) {
+    lookups++;
+    int slot = findSlot(page);
+    if (slot == -1)
+        return -1;
+    tlbHits++;
+    int set = (int)(page & setMask);
+    if (heads[set] != slot) {
+        unlink(set, slot);
+        pushFront(set, slot);
+    }
+    return frames[slot];
+}
+
+/** getHitCount
+ * @return The number of lookups that found their page.
+ */
+long long TLB::getHitCount() {
+    return tlbHits;
+}
+
+/** getLookupCount
+ * @return The number of lookups made through containsPage or lookup.
+ */
+long long TLB::getLookupCount() {
+    return lookups;
+}
+
 /** getHitRate
  * Gets the hit rate of the TLB.
- * @return The hit rate.
+ * @return The fraction of lookups that hit, or 0 before the first lookup.
  */
-int TLB::getHitRate() {
-    return tlbHits;
+double TLB::getHitRate() {
+    return lookups == 0 ? 0 : (double)tlbHits / lookups;
+}
+
+/** getSize
+ * @return The number of entries in the TLB.
+ */
+int TLB::getSize() {
+    return size;
+}
+
+/** getWays
+ * @return The number of entries per set.
+ */
+int TLB::getWays() {
+    return ways;
+}
+
+/** saveState
+ * Writes the TLB's shape, counters and valid entries, set by set from least to most recently used.
+ * @param out The checkpoint being written.
+ */
+void TLB::saveState(CheckpointWriter &out) {
+    out.put(size);
+    out.put(ways);
+    out.put(tlbHits);
+    out.put(lookups);
+    int entries = 0;
+    for (u_int8_t v : valid)
+        entries += v;
+    out.put(entries);
+    for (size_t set = 0; set < heads.size(); set++) {
+        for (int slot = tails[set]; slot != -1; slot = prev[slot]) {
+            if (valid[slot]) {
+                out.put(pages[slot]);
+                out.put(frames[slot]);
+            }
+        }
+    }
+}
+
+/** loadState
+ * Restores what saveState wrote into an empty TLB of the same shape. Adding the entries back oldest first
+ * rebuilds each set's LRU order, though not necessarily in the same slots.
+ * @param in The checkpoint being read.
+ * @return True if the shape matched and every entry was read.
+ */
+bool TLB::loadState(CheckpointReader &in) {
+    if (in.get() != (u_int64_t)size || in.get() != (u_int64_t)ways)
+        return false;
+    flush();
+    tlbHits = (long long)in.get();
+    lookups = (long long)in.get();
+    u_int64_t entries = in.get();
+    for (u_int64_t i = 0; i < entries && in.isValid(); i++) {
+        u_int64_t page = in.get();
+        addEntry(page, (u_int32_t)in.get());
+    }
+    return in.isValid();
 }
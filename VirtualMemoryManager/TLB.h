@@ -1,30 +1,60 @@
 // TLB.h
 // Created by Brian Cassriel on 5/5/24.
-//
+// The TLB class is a fixed-size set-associative array with O(1) LRU replacement inside each set.
 
 #ifndef VIRTUALMEMORYMANAGER_TLB_H
 #define VIRTUALMEMORYMANAGER_TLB_H
 
 #define MAX_TLB_SIZE 16
+// Large pages are cached in a separate, smaller TLB.
+#define LARGE_TLB_SIZE 8
 
-#include <map>
 #include <cstdlib>
+#include <vector>
+
+class CheckpointWriter;
+class CheckpointReader;
 
 class TLB {
 public:
-    TLB();
+    TLB(int size = MAX_TLB_SIZE, int ways = 0);
     ~TLB();
-    void addEntry(u_int8_t page, u_int8_t frame);
-    int getFrame(u_int8_t page);
-    bool containsPage(u_int8_t page);
-    int getHitRate();
+    void addEntry(u_int64_t page, u_int32_t frame);
+    void removeEntry(u_int64_t page);
+    int flush();
+    int getFrame(u_int64_t page);
+    bool containsPage(u_int64_t page);
+    int lookup(u_int64_t page);
+    long long getHitCount();
+    long long getLookupCount();
+    double getHitRate();
+    int getSize();
+    int getWays();
+    void saveState(CheckpointWriter &out);
+    bool loadState(CheckpointReader &in);
 
 private:
-    std::map<u_int8_t, u_int8_t> tlb;
-    std::map<u_int8_t, int> lru;
-    int tlbHits;
-
-    void removeLRU();
+    // Slots are stored as parallel arrays so a full probe of a 16-entry set touches one cache line per field.
+    // Set s owns slots [s * ways, (s + 1) * ways).
+    std::vector<u_int64_t> pages;
+    std::vector<u_int32_t> frames;
+    std::vector<u_int8_t> valid;
+    // Doubly-linked LRU order over slot indices within each set, most recently used at head.
+    std::vector<int> prev;
+    std::vector<int> next;
+    std::vector<int> heads;
+    std::vector<int> tails;
+    std::vector<int> used;
+    int size;
+    int ways;
+    u_int64_t setMask;
+    int lastSlot;
+    long long tlbHits;
+    long long lookups;
+
+    int findSlot(u_int64_t page);
+    void unlink(int set, int slot);
+    void pushFront(int set, int slot);
 };
 
 
@@ -0,0 +1,270 @@
+// TLBHierarchy.cpp
+// The TLBHierarchy class puts a split L1 (one TLB for base pages, one for large pages) in front of an optional
+// shared L2 TLB that caches both page sizes, and counts hits, misses and modeled cycles at each level.
+
+#include "TLBHierarchy.h"
+
+#include <cstring>
+
+#include "Checkpoint.h"
+
+/** TLBHierarchy constructor
+ * @param levels The L1 base page TLB followed by the optional L2.
+ * @param largeShift How many bits a base page number is shifted by to get its large page number,
+ * or 0 if there are no large pages and so no large page L1.
+ */
+TLBHierarchy::TLBHierarchy(const std::vector<TLBLevelConfig> &levels, int largeShift) {
+    for (size_t l = 0; l < levels.size() && l < MAX_TLB_LEVELS; l++) {
+        this->levels.push_back(new TLB(levels[l].size, levels[l].ways));
+        this->latencies.push_back(levels[l].latency);
+    }
+    if (this->levels.empty()) {
+        this->levels.push_back(new TLB());
+        this->latencies.push_back(TLB_L1_LATENCY);
+    }
+    this->largeShift = largeShift;
+    this->largeMask = (1ull << largeShift) - 1;
+    this->largeL1 = largeShift > 0 ? new TLB(LARGE_TLB_SIZE) : nullptr;
+    memset(hits, 0, sizeof(hits));
+    memset(misses, 0, sizeof(misses));
+    memset(cycles, 0, sizeof(cycles));
+    largeHits = 0;
+}
+
+/** TLBHierarchy destructor
+ * Deletes every level.
+ */
+TLBHierarchy::~TLBHierarchy() {
+    for (TLB *level : levels)
+        delete level;
+    delete largeL1;
+}
+
+/** lookup
+ * Probes L1 (large pages first, then base pages) and then L2. An L2 hit is copied back into L1.
+ * @param page The base page number.
+ * @param large Set to true if the page was found through a large page entry.
+ * @return The frame holding the page, or -1 if every level missed.
+ */
+int TLBHierarchy::lookup(u_int64_t page, bool &large) {
+    int frame;
+    large = false;
+    cycles[0] += latencies[0];
+    if (largeL1 != nullptr && (frame = largeL1->lookup(page >> largeShift)) != -1) {
+        hits[0]++;
+        largeHits++;
+        large = true;
+        return frame + (int)(page & largeMask);
+    }
+    if ((frame = levels[0]->lookup(page)) != -1) {
+        hits[0]++;
+        return frame;
+    }
+    misses[0]++;
+    if (levels.size() < 2)
+        return -1;
+
+    cycles[1] += latencies[1];
+    if ((frame = levels[1]->lookup(page)) != -1) {
+        hits[1]++;
+        levels[0]->addEntry(page, frame);
+        return frame;
+    }
+    if (largeL1 != nullptr && (frame = levels[1]->lookup((page >> largeShift) | LARGE_KEY)) != -1) {
+        hits[1]++;
+        largeHits++;
+        large = true;
+        largeL1->addEntry(page >> largeShift, frame);
+        return frame + (int)(page & largeMask);
+    }
+    misses[1]++;
+    return -1;
+}
+
+/** addEntry
+ * Caches a base page translation at every level.
+ * @param page The page number.
+ * @param frame The frame number.
+ */
+void TLBHierarchy::addEntry(u_int64_t page, u_int32_t frame) {
+    for (TLB *level : levels)
+        level->addEntry(page, frame);
+}
+
+/** addLargeEntry
+ * Caches a large page translation in the large page L1 and the shared L2.
+ * @param largePage The large page number.
+ * @param frame The first frame of the large page.
+ */
+void TLBHierarchy::addLargeEntry(u_int64_t largePage, u_int32_t frame) {
+    largeL1->addEntry(largePage, frame);
+    if (levels.size() > 1)
+        levels[1]->addEntry(largePage | LARGE_KEY, frame);
+}
+
+/** removeEntry
+ * Drops a base page translation from every level.
+ * @param page The page number.
+ */
+void TLBHierarchy::removeEntry(u_int64_t page) {
+    for (TLB *level : levels)
+        level->removeEntry(page);
+}
+
+/** removeLargeEntry
+ * Drops a large page translation from every level.
+ * @param largePage The large page number.
+ */
+void TLBHierarchy::removeLargeEntry(u_int64_t largePage) {
+    largeL1->removeEntry(largePage);
+    if (levels.size() > 1)
+        levels[1]->removeEntry(largePage | LARGE_KEY);
+}
+
+/** flush
+ * Drops every base and large page translation from every level.
+ * @return The number of valid entries that were dropped, over all levels.
+ */
+int TLBHierarchy::flush() {
+    int dropped = 0;
+    for (TLB *level : levels)
+        dropped += level->flush();
+    if (largeL1 != nullptr)
+        dropped += largeL1->flush();
+    return dropped;
+}
+
+/** getLevelCount
+ * @return The number of levels, 1 or 2.
+ */
+int TLBHierarchy::getLevelCount() {
+    return (int)levels.size();
+}
+
+/** getLevel
+ * @param level The level, 0 for L1.
+ * @return The base page TLB at that level.
+ */
+TLB *TLBHierarchy::getLevel(int level) {
+    return levels[level];
+}
+
+/** getHits
+ * @param level The level, 0 for L1.
+ * @return The number of lookups that hit at that level.
+ */
+long long TLBHierarchy::getHits(int level) {
+    return hits[level];
+}
+
+/** getMisses
+ * @param level The level, 0 for L1.
+ * @return The number of lookups that missed at that level.
+ */
+long long TLBHierarchy::getMisses(int level) {
+    return misses[level];
+}
+
+/** getCycles
+ * @param level The level, 0 for L1.
+ * @return The modeled cycles spent probing that level.
+ */
+long long TLBHierarchy::getCycles(int level) {
+    return cycles[level];
+}
+
+/** getHitCount
+ * @return The number of lookups that hit at any level.
+ */
+long long TLBHierarchy::getHitCount() {
+    long long total = 0;
+    for (size_t l = 0; l < levels.size(); l++)
+        total += hits[l];
+    return total;
+}
+
+/** getLargeHitCount
+ * @return The number of lookups that hit a large page entry at any level.
+ */
+long long TLBHierarchy::getLargeHitCount() {
+    return largeHits;
+}
+
+/** parseTLBLevels
+ * Parses a hierarchy spec of the form entries[:ways[:latency]][,entries[:ways[:latency]]], L1 first.
+ * Ways of 0 or left out mean fully associative.
+ * @param spec The spec.
+ * @param levels The parsed levels.
+ * @return True if the spec is well formed.
+ */
+bool parseTLBLevels(const char *spec, std::vector<TLBLevelConfig> &levels) {
+    levels.clear();
+    const char *cursor = spec;
+    while (true) {
+        TLBLevelConfig level;
+        char *end;
+        level.size = (int)strtol(cursor, &end, 10);
+        level.ways = 0;
+        level.latency = levels.empty() ? TLB_L1_LATENCY : TLB_L2_LATENCY;
+        if (end == cursor || level.size < 1)
+            return false;
+        if (*end == ':') {
+            cursor = end + 1;
+            level.ways = (int)strtol(cursor, &end, 10);
+            if (end == cursor || level.ways < 0)
+                return false;
+        }
+        if (*end == ':') {
+            cursor = end + 1;
+            level.latency = (int)strtol(cursor, &end, 10);
+            if (end == cursor || level.latency < 0)
+                return false;
+        }
+        levels.push_back(level);
+        if (*end == '\0')
+            return true;
+        if (*end != ',' || levels.size() == MAX_TLB_LEVELS)
+            return false;
+        cursor = end + 1;
+    }
+}
+
+/** saveState
+ * Writes every level's entries and the hierarchy's counters.
+ * @param out The checkpoint being written.
+ */
+void TLBHierarchy::saveState(CheckpointWriter &out) {
+    out.beginSection("TLBS");
+    out.put(levels.size());
+    for (size_t l = 0; l < levels.size(); l++) {
+        levels[l]->saveState(out);
+        out.put(hits[l]);
+        out.put(misses[l]);
+        out.put(cycles[l]);
+    }
+    out.put(largeL1 != nullptr);
+    if (largeL1 != nullptr)
+        largeL1->saveState(out);
+    out.put(largeHits);
+}
+
+/** loadState
+ * Restores what saveState wrote into an empty hierarchy with the same levels.
+ * @param in The checkpoint being read.
+ * @return True if the levels matched and everything was read.
+ */
+bool TLBHierarchy::loadState(CheckpointReader &in) {
+    if (!in.expectSection("TLBS") || in.get() != levels.size())
+        return false;
+    for (size_t l = 0; l < levels.size(); l++) {
+        if (!levels[l]->loadState(in))
+            return false;
+        hits[l] = (long long)in.get();
+        misses[l] = (long long)in.get();
+        cycles[l] = (long long)in.get();
+    }
+    if (in.get() != (largeL1 != nullptr) || (largeL1 != nullptr && !largeL1->loadState(in)))
+        return false;
+    largeHits = (long long)in.get();
+    return in.isValid();
+}
@@ -0,0 +1,71 @@
+// TLBHierarchy.h
+// The TLBHierarchy class puts a split L1 (one TLB for base pages, one for large pages) in front of an optional
+// shared L2 TLB that caches both page sizes, and counts hits, misses and modeled cycles at each level.
+
+#ifndef VIRTUALMEMORYMANAGER_TLBHIERARCHY_H
+#define VIRTUALMEMORYMANAGER_TLBHIERARCHY_H
+
+#include <cstdlib>
+#include <vector>
+
+#include "TLB.h"
+
+class CheckpointWriter;
+class CheckpointReader;
+
+#define MAX_TLB_LEVELS 2
+
+// Modeled cost in cycles of probing each level when a level spec leaves it out, and of a page table walk.
+#define TLB_L1_LATENCY 1
+#define TLB_L2_LATENCY 7
+#define TLB_WALK_LATENCY 30
+
+/** TLBLevelConfig
+ * The shape and probe cost of one level of the hierarchy.
+ */
+struct TLBLevelConfig {
+    int size;
+    // Entries per set, 0 for fully associative.
+    int ways;
+    int latency;
+};
+
+class TLBHierarchy {
+public:
+    TLBHierarchy(const std::vector<TLBLevelConfig> &levels, int largeShift = 0);
+    ~TLBHierarchy();
+    int lookup(u_int64_t page, bool &large);
+    void addEntry(u_int64_t page, u_int32_t frame);
+    void addLargeEntry(u_int64_t largePage, u_int32_t frame);
+    void removeEntry(u_int64_t page);
+    void removeLargeEntry(u_int64_t largePage);
+    int flush();
+    int getLevelCount();
+    TLB *getLevel(int level);
+    long long getHits(int level);
+    long long getMisses(int level);
+    long long getCycles(int level);
+    long long getHitCount();
+    long long getLargeHitCount();
+    void saveState(CheckpointWriter &out);
+    bool loadState(CheckpointReader &in);
+
+private:
+    // Large pages share the L2 with base pages under keys with this bit set.
+    static const u_int64_t LARGE_KEY = 1ull << 63;
+
+    std::vector<TLB *> levels;
+    std::vector<int> latencies;
+    TLB *largeL1;
+    int largeShift;
+    u_int64_t largeMask;
+    long long hits[MAX_TLB_LEVELS];
+    long long misses[MAX_TLB_LEVELS];
+    long long cycles[MAX_TLB_LEVELS];
+    long long largeHits;
+};
+
+bool parseTLBLevels(const char *spec, std::vector<TLBLevelConfig> &levels);
+
+
+#endif //VIRTUALMEMORYMANAGER_TLBHIERARCHY_H
@@ -0,0 +1,124 @@
+// TraceFormat.h
+// The binary address trace format shared by vmmgr and tracecvt.
+// A trace is a TraceHeader followed by the address stream, either as fixed-width little-endian
+// values or as zigzag-encoded deltas between consecutive addresses stored as LEB128 varints.
+// Traces can carry an access type per address. In the text format a W before an address marks it as a write;
+// in the binary format each stored value is the address shifted left once with the write flag in bit 0.
+// Readers hand a write out as its address with TRACE_WRITE_BIT set.
+
+#ifndef VIRTUALMEMORYMANAGER_TRACEFORMAT_H
+#define VIRTUALMEMORYMANAGER_TRACEFORMAT_H
+
+#include <cstdlib>
+#include <cstring>
+
+#define TRACE_MAGIC "VMTR"
+// Version 2 added TraceHeader.flags; version 1 traces are still read.
+#define TRACE_VERSION 2
+
+// Set in TraceHeader.flags when every stored value carries its access type in bit 0.
+#define TRACE_FLAG_ACCESS_TYPES 1
+// Addresses never reach bit 63, so it marks a write in a decoded address stream.
+#define TRACE_WRITE_BIT (1ull << 63)
+
+/** TraceEncoding
+ * How the address stream after the header is stored.
+ */
+enum TraceEncoding {
+    TRACE_RAW = 0,
+    TRACE_DELTA_VARINT = 1
+};
+
+/** TraceHeader
+ * The fixed 24-byte header at the start of every binary trace. All fields are little-endian.
+ */
+struct TraceHeader {
+    char magic[4];
+    u_int16_t version;
+    u_int8_t addressBits;
+    u_int8_t pageBits;
+    u_int8_t encoding;
+    u_int8_t flags;
+    u_int8_t reserved[6];
+    u_int64_t count;
+};
+
+static_assert(sizeof(TraceHeader) == 24, "TraceHeader must stay 24 bytes on disk");
+
+/** rawAddressWidth
+ * @param addressBits The number of bits in an address.
+ * @return The number of bytes one address takes in a TRACE_RAW stream.
+ */
+inline int rawAddressWidth(int addressBits) {
+    return (addressBits + 7) / 8;
+}
+
+/** packAccess
+ * Turns a decoded address, with TRACE_WRITE_BIT set for a write, into the value a trace with access types stores.
+ * @param value The decoded address.
+ * @return The address shifted left once with the write flag in bit 0.
+ */
+inline u_int64_t packAccess(u_int64_t value) {
+    return value << 1 | value >> 63;
+}
+
+/** unpackAccess
+ * @param stored A value stored in a trace with access types.
+ * @return The decoded address, with TRACE_WRITE_BIT set for a write.
+ */
+inline u_int64_t unpackAccess(u_int64_t stored) {
+    return stored >> 1 | stored << 63;
+}
+
+/** zigzagEncode
+ * Maps signed deltas onto unsigned values so small negative steps stay small.
+ * @param delta The signed delta.
+ * @return The zigzag-encoded delta.
+ */
+inline u_int64_t zigzagEncode(int64_t delta) {
+    return ((u_int64_t)delta << 1) ^ (u_int64_t)(delta >> 63);
+}
+
+/** zigzagDecode
+ * @param value The zigzag-encoded delta.
+ * @return The signed delta.
+ */
+inline int64_t zigzagDecode(u_int64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+/** writeVarint
+ * Writes a value as an LEB128 varint.
+ * @param value The value to write.
+ * @param out The output buffer, which must have room for 10 bytes.
+ * @return The number of bytes written.
+ */
+inline int writeVarint(u_int64_t value, unsigned char *out) {
+    int length = 0;
+    while (value >= 0x80) {
+        out[length++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    out[length++] = (unsigned char)value;
+    return length;
+}
+
+/** readVarint
+ * Reads an LEB128 varint.
+ * @param in The input cursor, advanced past the varint.
+ * @param end The end of the input.
+ * @param value The decoded value.
+ * @return True if a complete varint was read.
+ */
+inline bool readVarint(const unsigned char *&in, const unsigned char *end, u_int64_t &value) {
+    value = 0;
+    for (int shift = 0; in < end && shift < 64; shift += 7) {
+        unsigned char byte = *in++;
+        value |= (u_int64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+#endif //VIRTUALMEMORYMANAGER_TRACEFORMAT_H
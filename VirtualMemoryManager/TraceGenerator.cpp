@@ -0,0 +1,226 @@
+// TraceGenerator.cpp
+// The TraceGenerator class produces synthetic address traces with sequential (strided), uniform random, Zipfian,
+// looping, phase-shifting working set and pointer-chasing access patterns.
+
+#include "TraceGenerator.h"
+
+#include <cmath>
+#include <cstring>
+
+/** mix
+ * Hashes a value so nearby seeds and indices give unrelated generator states.
+ * @param value The value.
+ * @return The hash.
+ */
+static u_int64_t mix(u_int64_t value) {
+    SplitMix64 rng(value);
+    return rng.next();
+}
+
+/** maskFor
+ * @param count A count of at least 1.
+ * @return The smallest power of two minus one that is at least count - 1.
+ */
+static u_int64_t maskFor(u_int64_t count) {
+    u_int64_t mask = 0;
+    while (mask < count - 1)
+        mask = (mask << 1) | 1;
+    return mask;
+}
+
+/** TraceGenerator constructor
+ * The random stream depends on the seed and on firstIndex, and the deterministic patterns (sequential, loop,
+ * phase windows, chase) only on the index, so a trace can be produced in independent pieces: the pieces are
+ * reproducible as long as they always start at the same indices.
+ * @param config The pattern and its parameters.
+ * @param firstIndex The position in the trace of the first address to generate.
+ */
+TraceGenerator::TraceGenerator(const TraceGeneratorConfig &config, u_int64_t firstIndex)
+        : config(config), rng(mix(config.seed) ^ mix(firstIndex + 0x5851F42D4C957F2Dull)) {
+    this->index = firstIndex;
+    this->pageSize = config.geometry.getPageSize();
+    u_int64_t pages = 1ull << config.geometry.getPageBits();
+    this->workingSet = config.workingSet;
+    if (this->workingSet == 0)
+        this->workingSet = config.pattern == PATTERN_LOOP || config.pattern == PATTERN_PHASE ? DEFAULT_LOOP_PAGES : pages;
+    if (this->workingSet > pages)
+        this->workingSet = pages;
+    if (this->config.stride == 0)
+        this->config.stride = DEFAULT_SEQUENTIAL_STRIDE;
+    if (this->config.phaseLength == 0)
+        this->config.phaseLength = DEFAULT_PHASE_LENGTH;
+
+    this->scatterMask = maskFor(this->workingSet);
+    u_int64_t span = this->workingSet * this->pageSize;
+    this->nodeCount = span / this->config.stride;
+    if (this->nodeCount == 0)
+        this->nodeCount = 1;
+    this->nodeMask = maskFor(this->nodeCount);
+    this->step = this->config.stride % span;
+    this->position = (u_int64_t)(((unsigned __int128)firstIndex * this->config.stride) % span);
+
+    // Rejection-inversion (Hormann and Derflinger) samples Zipf ranks in O(1) without a table.
+    if (config.pattern == PATTERN_ZIPF) {
+        hIntegralX1 = hIntegral(1.5) - 1.0;
+        hIntegralMax = hIntegral((double)this->workingSet + 0.5);
+        sCutoff = 2.0 - hIntegralInverse(hIntegral(2.5) - h(2.0));
+    }
+}
+
+/** helper1
+ * @param x The argument.
+ * @return log1p(x) / x, accurate near 0.
+ */
+static double helper1(double x) {
+    if (std::fabs(x) > 1e-8)
+        return std::log1p(x) / x;
+    return 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+}
+
+/** helper2
+ * @param x The argument.
+ * @return expm1(x) / x, accurate near 0.
+ */
+static double helper2(double x) {
+    if (std::fabs(x) > 1e-8)
+        return std::expm1(x) / x;
+    return 1.0 + x * 0.5 * (1.0 + x * (1.0 / 3.0) * (1.0 + 0.25 * x));
+}
+
+/** h
+ * @param x The rank.
+ * @return The unnormalized Zipf density x^-s.
+ */
+double TraceGenerator::h(double x) {
+    return std::exp(-config.zipfExponent * std::log(x));
+}
+
+/** hIntegral
+ * @param x The rank.
+ * @return An antiderivative of h.
+ */
+double TraceGenerator::hIntegral(double x) {
+    double logX = std::log(x);
+    return helper2((1.0 - config.zipfExponent) * logX) * logX;
+}
+
+/** hIntegralInverse
+ * @param x A value of hIntegral.
+ * @return The rank it came from.
+ */
+double TraceGenerator::hIntegralInverse(double x) {
+    double t = x * (1.0 - config.zipfExponent);
+    if (t < -1.0)
+        t = -1.0;
+    return std::exp(helper1(t) * x);
+}
+
+/** sampleZipf
+ * @return A rank in [0, workingSet), 0 being the most popular.
+ */
+u_int64_t TraceGenerator::sampleZipf() {
+    while (true) {
+        double u = hIntegralMax + rng.nextDouble() * (hIntegralX1 - hIntegralMax);
+        double x = hIntegralInverse(u);
+        double k = std::floor(x + 0.5);
+        if (k < 1.0)
+            k = 1.0;
+        else if (k > (double)workingSet)
+            k = (double)workingSet;
+        if (k - x <= sCutoff || u >= hIntegral(k + 0.5) - h(k))
+            return (u_int64_t)k - 1;
+    }
+}
+
+/** scatter
+ * Maps a value to a pseudo-random one with a bijection on [0, mask], repeating until the result is below limit,
+ * which makes it a bijection on [0, limit). Spreads popular Zipf ranks over the working set and orders the
+ * nodes of a pointer chase.
+ * @param value The value, below limit.
+ * @param mask A power of two minus one, at least limit - 1.
+ * @param limit The size of the range.
+ * @return The scattered value.
+ */
+u_int64_t TraceGenerator::scatter(u_int64_t value, u_int64_t mask, u_int64_t limit) {
+    do {
+        value = (value * 0x9E3779B97F4A7C15ull + config.seed) & mask;
+        value ^= value >> 7;
+        value = (value * 0xBF58476D1CE4E5B9ull) & mask;
+    } while (value >= limit);
+    return value;
+}
+
+/** nextPage
+ * @return The page of the next random or looping address.
+ */
+u_int64_t TraceGenerator::nextPage() {
+    if (config.pattern == PATTERN_UNIFORM)
+        return rng.nextBelow(workingSet);
+    if (config.pattern == PATTERN_ZIPF)
+        return scatter(sampleZipf(), scatterMask, workingSet);
+    if (config.pattern == PATTERN_PHASE) {
+        // Each phase's window starts at a page picked from the seed and the phase number alone.
+        u_int64_t pages = 1ull << config.geometry.getPageBits();
+        SplitMix64 phase(mix(config.seed) ^ mix(index / config.phaseLength));
+        return phase.nextBelow(pages - workingSet + 1) + rng.nextBelow(workingSet);
+    }
+    return index % workingSet;
+}
+
+/** generate
+ * Produces the next addresses of the trace.
+ * @param addresses The addresses to be filled.
+ * @param count The number of addresses.
+ */
+void TraceGenerator::generate(u_int64_t *addresses, int count) {
+    u_int64_t span = workingSet * pageSize;
+    for (int i = 0; i < count; i++) {
+        if (config.pattern == PATTERN_SEQUENTIAL) {
+            addresses[i] = position;
+            position += step;
+            if (position >= span)
+                position -= span;
+        } else if (config.pattern == PATTERN_CHASE) {
+            addresses[i] = scatter(index % nodeCount, nodeMask, nodeCount) * config.stride;
+        } else {
+            addresses[i] = nextPage() * pageSize + rng.nextBelow(pageSize);
+        }
+        index++;
+    }
+}
+
+/** getWorkingSet
+ * @return The number of pages the trace touches.
+ */
+u_int64_t TraceGenerator::getWorkingSet() {
+    return workingSet;
+}
+
+/** parseTracePattern
+ * Converts a pattern name to a TracePattern. "strided" and "random" are accepted for sequential and uniform.
+ * @param name The pattern name.
+ * @param pattern The parsed pattern.
+ * @return True if the name is a known pattern.
+ */
+bool parseTracePattern(const char *name, TracePattern &pattern) {
+    if (strcmp(name, "strided") == 0)
+        name = "sequential";
+    else if (strcmp(name, "random") == 0)
+        name = "uniform";
+    for (int p = PATTERN_SEQUENTIAL; p <= PATTERN_CHASE; p++) {
+        if (strcmp(name, getTracePatternName((TracePattern)p)) == 0) {
+            pattern = (TracePattern)p;
+            return true;
+        }
+    }
+    return false;
+}
+
+/** getTracePatternName
+ * @param pattern The pattern.
+ * @return The pattern's name.
+ */
+const char *getTracePatternName(TracePattern pattern) {
+    const char *names[] = {"sequential", "uniform", "zipf", "loop", "phase", "chase"};
+    return names[pattern];
+}
@@ -0,0 +1,153 @@
+// TraceGenerator.h
+// The TraceGenerator class produces synthetic address traces with sequential (strided), uniform random, Zipfian,
+// looping, phase-shifting working set and pointer-chasing access patterns. The random number generation is done here rather than with <random>
+// distributions, whose output differs between standard libraries, so a seed gives the same trace everywhere.
+
+#ifndef VIRTUALMEMORYMANAGER_TRACEGENERATOR_H
+#define VIRTUALMEMORYMANAGER_TRACEGENERATOR_H
+
+#include <cstdlib>
+#include <string>
+
+#include "address.h"
+
+#define DEFAULT_ZIPF_EXPONENT 0.99
+#define DEFAULT_SEQUENTIAL_STRIDE 64
+#define DEFAULT_LOOP_PAGES 64
+#define DEFAULT_PHASE_LENGTH 100000
+
+/** TracePattern
+ * How a synthetic trace walks the address space.
+ * PATTERN_SEQUENTIAL scans the working set stride bytes at a time and wraps around, PATTERN_UNIFORM picks any
+ * page of the working set with equal probability, PATTERN_ZIPF picks pages with Zipfian popularity (hot pages
+ * are scattered over the working set), PATTERN_LOOP cycles through the working set's pages in order,
+ * PATTERN_PHASE picks pages uniformly from a window of working set pages that jumps to a random place in the
+ * address space every phaseLength accesses, and PATTERN_CHASE follows a random cycle through the stride-byte
+ * nodes of the working set, like walking a linked list that was allocated in random order.
+ * The random, looping and phase patterns use a random offset within the page.
+ */
+enum TracePattern {
+    PATTERN_SEQUENTIAL,
+    PATTERN_UNIFORM,
+    PATTERN_ZIPF,
+    PATTERN_LOOP,
+    PATTERN_PHASE,
+    PATTERN_CHASE
+};
+
+/** TraceGeneratorConfig
+ * Everything that determines a synthetic trace.
+ */
+struct TraceGeneratorConfig {
+    TracePattern pattern;
+    Geometry geometry;
+    // The number of pages the trace touches, 0 for every page in the address space
+    // (DEFAULT_LOOP_PAGES for PATTERN_LOOP and PATTERN_PHASE, where it is the size of one phase's window).
+    u_int64_t workingSet;
+    double zipfExponent;
+    // Bytes between consecutive PATTERN_SEQUENTIAL addresses, and the node size of PATTERN_CHASE.
+    u_int64_t stride;
+    // Accesses per PATTERN_PHASE window.
+    u_int64_t phaseLength;
+    u_int64_t seed;
+
+    /** TraceGeneratorConfig constructor
+     * Uniform random addresses over the default geometry with seed 1.
+     */
+    TraceGeneratorConfig() {
+        pattern = PATTERN_UNIFORM;
+        workingSet = 0;
+        zipfExponent = DEFAULT_ZIPF_EXPONENT;
+        stride = DEFAULT_SEQUENTIAL_STRIDE;
+        phaseLength = DEFAULT_PHASE_LENGTH;
+        seed = 1;
+    }
+};
+
+/** SplitMix64
+ * A small, fast 64-bit generator that is identical on every platform.
+ */
+class SplitMix64 {
+public:
+    /** SplitMix64 constructor
+     * @param seed The seed.
+     */
+    explicit SplitMix64(u_int64_t seed) {
+        state = seed;
+    }
+
+    /** next
+     * @return The next 64 random bits.
+     */
+    u_int64_t next() {
+        u_int64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    /** skip
+     * Moves ahead as count calls to next would, in constant time.
+     * @param count The number of values to skip.
+     */
+    void skip(u_int64_t count) {
+        state += count * 0x9E3779B97F4A7C15ull;
+    }
+
+    /** nextBelow
+     * @param bound The exclusive upper bound, at least 1.
+     * @return A value in [0, bound), by multiply-shift (the bias is below 2^-64 * bound).
+     */
+    u_int64_t nextBelow(u_int64_t bound) {
+        return (u_int64_t)(((unsigned __int128)next() * bound) >> 64);
+    }
+
+    /** nextDouble
+     * @return A value in [0, 1) with 53 random bits.
+     */
+    double nextDouble() {
+        return (double)(next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+private:
+    u_int64_t state;
+};
+
+class TraceGenerator {
+public:
+    TraceGenerator(const TraceGeneratorConfig &config, u_int64_t firstIndex = 0);
+    void generate(u_int64_t *addresses, int count);
+    u_int64_t getWorkingSet();
+
+private:
+    TraceGeneratorConfig config;
+    SplitMix64 rng;
+    u_int64_t index;
+    u_int64_t workingSet;
+    u_int64_t pageSize;
+    // The smallest powers of two minus one covering the working set's pages and PATTERN_CHASE's nodes.
+    u_int64_t scatterMask;
+    u_int64_t nodeCount;
+    u_int64_t nodeMask;
+    // PATTERN_SEQUENTIAL's next address, advanced by stride modulo the working set's span.
+    u_int64_t position;
+    u_int64_t step;
+
+    // Constants of the Zipf rejection-inversion sampler.
+    double hIntegralX1;
+    double hIntegralMax;
+    double sCutoff;
+
+    u_int64_t nextPage();
+    u_int64_t sampleZipf();
+    u_int64_t scatter(u_int64_t value, u_int64_t mask, u_int64_t limit);
+    double h(double x);
+    double hIntegral(double x);
+    double hIntegralInverse(double x);
+};
+
+bool parseTracePattern(const char *name, TracePattern &pattern);
+const char *getTracePatternName(TracePattern pattern);
+
+
+#endif //VIRTUALMEMORYMANAGER_TRACEGENERATOR_H
@@ -0,0 +1,257 @@
+// TraceReader.cpp
+// The TraceReader class streams addresses out of a trace file in either the text or the binary trace format.
+// Writes come out with TRACE_WRITE_BIT set.
+
+#include "TraceReader.h"
+
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** TraceReader constructor
+ * Opens a trace and detects its format from the first bytes of the file.
+ * @param path The path to the trace.
+ */
+TraceReader::TraceReader(const std::string &path) {
+    this->binary = false;
+    this->readPos = 0;
+    this->readEnd = 0;
+    this->atEndOfFile = false;
+    this->partialValue = 0;
+    this->inNumber = false;
+    this->pendingWrite = 0;
+    memset(&this->header, 0, sizeof(this->header));
+    this->map = nullptr;
+    this->mapSize = 0;
+    this->cursor = nullptr;
+    this->end = nullptr;
+    this->remaining = 0;
+    this->previous = 0;
+
+    this->fd = open(path.c_str(), O_RDONLY);
+    if (this->fd == -1)
+        return;
+
+    char magic[4];
+    if (pread(this->fd, magic, sizeof(magic), 0) == sizeof(magic) && memcmp(magic, TRACE_MAGIC, sizeof(magic)) == 0) {
+        this->binary = true;
+        mapBinary(path);
+    } else {
+        this->readBuffer.resize(TRACE_BLOCK_SIZE);
+    }
+}
+
+/** TraceReader destructor
+ * Closes the file and unmaps a binary trace.
+ */
+TraceReader::~TraceReader() {
+    if (this->map != nullptr)
+        munmap((void *)this->map, this->mapSize);
+    if (this->fd != -1)
+        close(this->fd);
+}
+
+/** mapBinary
+ * Maps a binary trace and validates its header.
+ * @param path The path to the trace, used in error messages.
+ */
+void TraceReader::mapBinary(const std::string &path) {
+    struct stat info;
+    if (fstat(this->fd, &info) == -1 || (size_t)info.st_size < sizeof(TraceHeader)) {
+        std::cerr << "Error: " << path << " is too short to be a binary trace." << std::endl;
+        exit(1);
+    }
+    this->mapSize = info.st_size;
+    void *mapped = mmap(nullptr, this->mapSize, PROT_READ, MAP_PRIVATE, this->fd, 0);
+    if (mapped == MAP_FAILED) {
+        std::cerr << "Error mapping file: " << path << std::endl;
+        exit(1);
+    }
+    madvise(mapped, this->mapSize, MADV_SEQUENTIAL);
+    this->map = (const unsigned char *)mapped;
+
+    memcpy(&this->header, this->map, sizeof(TraceHeader));
+    bool accessTypes = this->header.flags & TRACE_FLAG_ACCESS_TYPES;
+    if (this->header.version < 1 || this->header.version > TRACE_VERSION || this->header.addressBits == 0
+            || this->header.addressBits > (accessTypes ? 63 : 64) || this->header.pageBits >= this->header.addressBits
+            || (this->header.encoding != TRACE_RAW && this->header.encoding != TRACE_DELTA_VARINT)
+            || (this->header.flags & ~TRACE_FLAG_ACCESS_TYPES) != 0) {
+        std::cerr << "Error: " << path << " has an unsupported binary trace header." << std::endl;
+        exit(1);
+    }
+    this->cursor = this->map + sizeof(TraceHeader);
+    this->end = this->map + this->mapSize;
+    this->remaining = this->header.count;
+    if (this->header.encoding == TRACE_RAW
+            && (u_int64_t)(this->end - this->cursor) / rawAddressWidth(this->header.addressBits + accessTypes)
+               < this->remaining) {
+        std::cerr << "Error: " << path << " is truncated." << std::endl;
+        exit(1);
+    }
+}
+
+/** isOpen
+ * @return True if the trace file was opened.
+ */
+bool TraceReader::isOpen() {
+    return this->fd != -1;
+}
+
+/** isBinary
+ * @return True if the trace is in the binary format.
+ */
+bool TraceReader::isBinary() {
+    return this->binary;
+}
+
+/** getAddressBits
+ * @return The address width recorded in a binary trace, or 0 for a text trace.
+ */
+int TraceReader::getAddressBits() {
+    return this->header.addressBits;
+}
+
+/** getPageBits
+ * @return The page size (as a power of two) recorded in a binary trace, or 0 for a text trace.
+ */
+int TraceReader::getPageBits() {
+    return this->header.pageBits;
+}
+
+/** hasAccessTypes
+ * @return True if a binary trace stores whether each access is a write. Text traces may always mark writes.
+ */
+bool TraceReader::hasAccessTypes() {
+    return this->header.flags & TRACE_FLAG_ACCESS_TYPES;
+}
+
+/** readAddresses
+ * Reads the next addresses from the trace.
+ * @param addresses The buffer to be filled, with TRACE_WRITE_BIT set on writes.
+ * @param maxCount The capacity of the buffer.
+ * @return The number of addresses read, 0 at the end of the trace, or -1 if the file could not be read.
+ */
+int TraceReader::readAddresses(u_int64_t *addresses, int maxCount) {
+    if (this->fd == -1)
+        return -1;
+    if (this->binary)
+        return readBinary(addresses, maxCount);
+    return readText(addresses, maxCount);
+}
+
+/** readText
+ * Parses decimal addresses out of the text trace. Any run of digits is an address;
+ * every other character separates addresses, and a W or w anywhere before an address marks it as a write.
+ * @param addresses The buffer to be filled.
+ * @param maxCount The capacity of the buffer.
+ * @return The number of addresses read, 0 at the end of the trace, or -1 if the file could not be read.
+ */
+int TraceReader::readText(u_int64_t *addresses, int maxCount) {
+    int count = 0;
+    while (count < maxCount) {
+        if (this->readPos == this->readEnd) {
+            if (this->atEndOfFile)
+                break;
+            ssize_t bytesRead = read(this->fd, this->readBuffer.data(), this->readBuffer.size());
+            if (bytesRead < 0) {
+                std::cerr << "Error reading address file." << std::endl;
+                return -1;
+            }
+            if (bytesRead == 0) {
+                this->atEndOfFile = true;
+                if (this->inNumber)
+                    addresses[count++] = this->partialValue | this->pendingWrite;
+                this->inNumber = false;
+                this->pendingWrite = 0;
+                break;
+            }
+            this->readPos = 0;
+            this->readEnd = bytesRead;
+        }
+
+        const char *buffer = this->readBuffer.data();
+        size_t pos = this->readPos;
+        size_t end = this->readEnd;
+        u_int64_t value = this->partialValue;
+        bool inNumber = this->inNumber;
+        u_int64_t write = this->pendingWrite;
+        while (pos < end) {
+            unsigned char c = (unsigned char)buffer[pos++];
+            unsigned digit = c - '0';
+            if (digit < 10) {
+                // Saturate instead of overflowing so huge values still fail the caller's bounds check.
+                value = value < (1ull << 59) ? value * 10 + digit : value;
+                inNumber = true;
+                continue;
+            }
+            bool full = false;
+            if (inNumber) {
+                addresses[count++] = value | write;
+                value = 0;
+                inNumber = false;
+                write = 0;
+                full = count == maxCount;
+            }
+            if ((c | 0x20) == 'w')
+                write = TRACE_WRITE_BIT;
+            if (full)
+                break;
+        }
+        this->readPos = pos;
+        this->partialValue = value;
+        this->inNumber = inNumber;
+        this->pendingWrite = write;
+    }
+    return count;
+}
+
+/** readBinary
+ * Decodes addresses straight out of the mapped binary trace. Deltas are taken between stored values, so a trace
+ * with access types is unpacked only after each value is rebuilt.
+ * @param addresses The buffer to be filled.
+ * @param maxCount The capacity of the buffer.
+ * @return The number of addresses read, 0 at the end of the trace, or -1 if the stream is corrupt.
+ */
+int TraceReader::readBinary(u_int64_t *addresses, int maxCount) {
+    int count = maxCount;
+    if (this->remaining < (u_int64_t)count)
+        count = (int)this->remaining;
+
+    bool accessTypes = this->header.flags & TRACE_FLAG_ACCESS_TYPES;
+    if (this->header.encoding == TRACE_RAW) {
+        int width = rawAddressWidth(this->header.addressBits + accessTypes);
+        const unsigned char *in = this->cursor;
+        if (width == 2) {
+            for (int i = 0; i < count; i++, in += 2)
+                addresses[i] = (u_int64_t)in[0] | ((u_int64_t)in[1] << 8);
+        } else {
+            for (int i = 0; i < count; i++, in += width) {
+                u_int64_t value = 0;
+                for (int b = 0; b < width; b++)
+                    value |= (u_int64_t)in[b] << (8 * b);
+                addresses[i] = value;
+            }
+        }
+        this->cursor = in;
+        if (accessTypes) {
+            for (int i = 0; i < count; i++)
+                addresses[i] = unpackAccess(addresses[i]);
+        }
+    } else {
+        u_int64_t value = this->previous;
+        for (int i = 0; i < count; i++) {
+            u_int64_t delta;
+            if (!readVarint(this->cursor, this->end, delta)) {
+                std::cerr << "Error: binary trace ends in the middle of an address." << std::endl;
+                return -1;
+            }
+            value += (u_int64_t)zigzagDecode(delta);
+            addresses[i] = accessTypes ? unpackAccess(value) : value;
+        }
+        this->previous = value;
+    }
+    this->remaining -= count;
+    return count;
+}
@@ -0,0 +1,58 @@
+// TraceReader.h
+// The TraceReader class streams addresses out of a trace file in either the text or the binary trace format.
+// Writes come out with TRACE_WRITE_BIT set.
+
+#ifndef VIRTUALMEMORYMANAGER_TRACEREADER_H
+#define VIRTUALMEMORYMANAGER_TRACEREADER_H
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "TraceFormat.h"
+
+// The text trace is read in blocks of this many bytes.
+#define TRACE_BLOCK_SIZE (1024 * 1024)
+
+class TraceReader {
+public:
+    TraceReader(const std::string &path);
+    ~TraceReader();
+    bool isOpen();
+    bool isBinary();
+    int getAddressBits();
+    int getPageBits();
+    bool hasAccessTypes();
+    int readAddresses(u_int64_t *addresses, int maxCount);
+
+private:
+    int fd;
+    bool binary;
+
+    // Text traces are parsed block by block. An address can straddle two blocks,
+    // so the digits parsed so far carry over between reads.
+    std::vector<char> readBuffer;
+    size_t readPos;
+    size_t readEnd;
+    bool atEndOfFile;
+    u_int64_t partialValue;
+    bool inNumber;
+    // TRACE_WRITE_BIT once a W has been seen since the last address, else 0.
+    u_int64_t pendingWrite;
+
+    // Binary traces are mapped whole and decoded straight out of the mapping.
+    TraceHeader header;
+    const unsigned char *map;
+    size_t mapSize;
+    const unsigned char *cursor;
+    const unsigned char *end;
+    u_int64_t remaining;
+    u_int64_t previous;
+
+    void mapBinary(const std::string &path);
+    int readText(u_int64_t *addresses, int maxCount);
+    int readBinary(u_int64_t *addresses, int maxCount);
+};
+
+
+#endif //VIRTUALMEMORYMANAGER_TRACEREADER_H
@@ -0,0 +1,209 @@
+// TraceWriter.cpp
+// The TraceWriter class writes addresses to a trace file in the text or the binary trace format.
+
+#include "TraceWriter.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+/** TraceWriter constructor
+ * Creates the trace file. Binary traces get a placeholder header that close() fills in.
+ * @param path The path to the trace.
+ * @param format The file format to write.
+ * @param addressBits The number of bits in an address.
+ * @param pageBits The page size as a power of two.
+ * @param accessTypes True to store whether each address is a write in a binary trace. Text traces always do.
+ */
+TraceWriter::TraceWriter(const std::string &path, TraceOutputFormat format, int addressBits, int pageBits,
+                         bool accessTypes) {
+    this->format = format;
+    this->buffer.resize(TRACE_WRITE_BUFFER_SIZE);
+    this->used = 0;
+    this->previous = 0;
+    this->bytesWritten = 0;
+
+    memset(&this->header, 0, sizeof(this->header));
+    memcpy(this->header.magic, TRACE_MAGIC, sizeof(this->header.magic));
+    this->header.version = TRACE_VERSION;
+    this->header.addressBits = addressBits;
+    this->header.pageBits = pageBits;
+    this->header.encoding = format == TRACE_OUT_DELTA ? TRACE_DELTA_VARINT : TRACE_RAW;
+    this->header.flags = accessTypes ? TRACE_FLAG_ACCESS_TYPES : 0;
+
+    this->fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (this->fd != -1 && format != TRACE_OUT_TEXT) {
+        memcpy(this->buffer.data(), &this->header, sizeof(this->header));
+        this->used = sizeof(this->header);
+    }
+}
+
+/** TraceWriter destructor
+ * Finishes the trace if close() was not called.
+ */
+TraceWriter::~TraceWriter() {
+    close();
+}
+
+/** isOpen
+ * @return True if the trace file was created.
+ */
+bool TraceWriter::isOpen() {
+    return this->fd != -1;
+}
+
+/** flush
+ * Writes the buffered bytes to the file.
+ * @return True if every byte was written.
+ */
+bool TraceWriter::flush() {
+    size_t done = 0;
+    while (done < this->used) {
+        ssize_t n = write(this->fd, this->buffer.data() + done, this->used - done);
+        if (n <= 0)
+            return false;
+        done += n;
+    }
+    this->bytesWritten += this->used;
+    this->used = 0;
+    return true;
+}
+
+/** encodeAddresses
+ * Encodes addresses the way writeAddresses stores them, without a TraceWriter, so several threads can encode
+ * pieces of a trace at once and hand the bytes to writeEncoded in order.
+ * @param format The output format.
+ * @param addressBits The number of bits in an address.
+ * @param addresses The addresses to encode, with TRACE_WRITE_BIT set on writes.
+ * @param count The number of addresses.
+ * @param previous The value stored before the first one, updated to the last one; only used by TRACE_OUT_DELTA.
+ * @param out A buffer of at least count * TRACE_MAX_RECORD bytes.
+ * @param accessTypes True to keep writes in a binary trace; without it they are stored as reads.
+ * @return The number of bytes written to out.
+ */
+size_t TraceWriter::encodeAddresses(TraceOutputFormat format, int addressBits, const u_int64_t *addresses, int count,
+                                    u_int64_t &previous, unsigned char *out, bool accessTypes) {
+    unsigned char *start = out;
+    int width = rawAddressWidth(addressBits + accessTypes);
+
+    for (int i = 0; i < count; i++) {
+        u_int64_t value = addresses[i];
+
+        if (format == TRACE_OUT_TEXT) {
+            if (value & TRACE_WRITE_BIT) {
+                out[0] = 'W';
+                out[1] = ' ';
+                out += 2;
+                value &= ~TRACE_WRITE_BIT;
+            }
+            char digits[20];
+            int length = 0;
+            do {
+                digits[length++] = (char)('0' + value % 10);
+                value /= 10;
+            } while (value != 0);
+            for (int d = 0; d < length; d++)
+                out[d] = digits[length - 1 - d];
+            out[length] = '\n';
+            out += length + 1;
+            continue;
+        }
+        value = accessTypes ? packAccess(value) : value & ~TRACE_WRITE_BIT;
+        if (format == TRACE_OUT_RAW) {
+            for (int b = 0; b < width; b++)
+                out[b] = (unsigned char)(value >> (8 * b));
+            out += width;
+        } else {
+            out += writeVarint(zigzagEncode((int64_t)(value - previous)), out);
+            previous = value;
+        }
+    }
+    return out - start;
+}
+
+/** writeAddresses
+ * Appends addresses to the trace.
+ * @param addresses The addresses to write.
+ * @param count The number of addresses.
+ * @return True if the addresses were written.
+ */
+bool TraceWriter::writeAddresses(const u_int64_t *addresses, int count) {
+    if (this->fd == -1)
+        return false;
+    int done = 0;
+    while (done < count) {
+        int room = (int)((this->buffer.size() - this->used) / TRACE_MAX_RECORD);
+        if (room == 0) {
+            if (!flush())
+                return false;
+            continue;
+        }
+        int n = count - done < room ? count - done : room;
+        this->used += encodeAddresses(this->format, this->header.addressBits, addresses + done, n, this->previous,
+                                      this->buffer.data() + this->used, this->header.flags & TRACE_FLAG_ACCESS_TYPES);
+        done += n;
+    }
+    this->header.count += count;
+    return true;
+}
+
+/** writeEncoded
+ * Appends addresses that were already encoded with encodeAddresses.
+ * @param data The encoded addresses.
+ * @param length The number of bytes.
+ * @param count The number of addresses they hold.
+ * @param last The last of those addresses, which the next delta is taken from.
+ * @return True if the bytes were written.
+ */
+bool TraceWriter::writeEncoded(const unsigned char *data, size_t length, u_int64_t count, u_int64_t last) {
+    if (this->fd == -1)
+        return false;
+    if (length > this->buffer.size() - this->used) {
+        if (!flush())
+            return false;
+    }
+    if (length > this->buffer.size()) {
+        size_t done = 0;
+        while (done < length) {
+            ssize_t n = write(this->fd, data + done, length - done);
+            if (n <= 0)
+                return false;
+            done += n;
+        }
+        this->bytesWritten += length;
+    } else {
+        memcpy(this->buffer.data() + this->used, data, length);
+        this->used += length;
+    }
+    this->header.count += count;
+    this->previous = last;
+    return true;
+}
+
+/** close
+ * Flushes the remaining output, records the final address count in a binary header, and closes the file.
+ * @return True if the trace was written completely.
+ */
+bool TraceWriter::close() {
+    if (this->fd == -1)
+        return true;
+    bool ok = flush();
+    if (ok && this->format != TRACE_OUT_TEXT)
+        ok = pwrite(this->fd, &this->header, sizeof(this->header), 0) == sizeof(this->header);
+    ok = ::close(this->fd) == 0 && ok;
+    this->fd = -1;
+    return ok;
+}
+
+/** getAddressCount
+ * @return The number of addresses written so far.
+ */
+u_int64_t TraceWriter::getAddressCount() {
+    return this->header.count;
+}
+
+/** getBytesWritten
+ * @return The number of bytes flushed to the file so far.
+ */
+u_int64_t TraceWriter::getBytesWritten() {
+    return this->bytesWritten;
+}
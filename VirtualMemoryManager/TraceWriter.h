@@ -0,0 +1,54 @@
+// TraceWriter.h
+// The TraceWriter class writes addresses to a trace file in the text or the binary trace format.
+
+#ifndef VIRTUALMEMORYMANAGER_TRACEWRITER_H
+#define VIRTUALMEMORYMANAGER_TRACEWRITER_H
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "TraceFormat.h"
+
+// Output is collected in a buffer of this many bytes before each write.
+#define TRACE_WRITE_BUFFER_SIZE (1024 * 1024)
+// The longest single record is a W and a space, a 20-digit decimal and a newline, or a 10-byte varint.
+#define TRACE_MAX_RECORD 23
+
+/** TraceOutputFormat
+ * The file format a TraceWriter produces.
+ */
+enum TraceOutputFormat {
+    TRACE_OUT_TEXT,
+    TRACE_OUT_RAW,
+    TRACE_OUT_DELTA
+};
+
+class TraceWriter {
+public:
+    TraceWriter(const std::string &path, TraceOutputFormat format, int addressBits, int pageBits,
+                bool accessTypes = false);
+    ~TraceWriter();
+    bool isOpen();
+    bool writeAddresses(const u_int64_t *addresses, int count);
+    bool writeEncoded(const unsigned char *data, size_t length, u_int64_t count, u_int64_t last);
+    static size_t encodeAddresses(TraceOutputFormat format, int addressBits, const u_int64_t *addresses, int count,
+                                  u_int64_t &previous, unsigned char *out, bool accessTypes = false);
+    bool close();
+    u_int64_t getAddressCount();
+    u_int64_t getBytesWritten();
+
+private:
+    int fd;
+    TraceOutputFormat format;
+    TraceHeader header;
+    std::vector<unsigned char> buffer;
+    size_t used;
+    u_int64_t previous;
+    u_int64_t bytesWritten;
+
+    bool flush();
+};
+
+
+#endif //VIRTUALMEMORYMANAGER_TRACEWRITER_H
@@ -0,0 +1,154 @@
+// TranslationEngine.cpp
+// The TranslationEngine classes translate whole batches of addresses for the plain case, compiled for one page
+// geometry and TLB shape; createTranslationEngine picks the instantiation at runtime.
+
+#include "TranslationEngine.h"
+
+/** TranslationEngine constructor
+ * @param fileProcessor The source of backing store pages.
+ * @param physicalMemory The physical memory.
+ */
+TranslationEngine::TranslationEngine(FileProcessor *fileProcessor, PhysicalMemory *physicalMemory) {
+    this->fileProcessor = fileProcessor;
+    this->physicalMemory = physicalMemory;
+    this->kernels = &getBatchKernels();
+    this->frameData.assign(physicalMemory->getFrameCount(), nullptr);
+    this->translations = 0;
+    this->tlbHits = 0;
+    this->faults = 0;
+    this->faultTime = 0;
+    if (fileProcessor->getStoreMode() == STORE_ALIAS)
+        physicalMemory->enableAliasing();
+}
+
+/** setVectorized
+ * Picks the batch kernels: the fastest ones the CPU runs, or the scalar ones to compare against.
+ * @param vectorized True for the fastest kernels.
+ */
+void TranslationEngine::setVectorized(bool vectorized) {
+    kernels = &getBatchKernels(vectorized);
+}
+
+/** getKernelName
+ * @return What the batch kernels in use are built on, e.g. "avx2".
+ */
+const char *TranslationEngine::getKernelName() {
+    return kernels->name;
+}
+
+/** decodeBatch
+ * Splits a batch of raw trace values into pages and offsets, stopping the run on an address out of bounds.
+ * @param values The raw values.
+ * @param count The number of values.
+ * @param addressBits The number of bits in a virtual address.
+ * @param offsetBits The number of bits in a page offset.
+ */
+void TranslationEngine::decodeBatch(const u_int64_t *values, int count, int addressBits, int offsetBits) {
+    if ((size_t)count > pages.size()) {
+        pages.resize(count);
+        offsets.resize(count);
+    }
+    int bad = kernels->decode(values, count, addressBits, offsetBits, pages.data(), offsets.data());
+    if (bad != -1) {
+        std::cerr << "Address out of bounds: " << (values[bad] & ~TRACE_WRITE_BIT) << std::endl;
+        exit(1);
+    }
+}
+
+/** loadFrame
+ * Fills a claimed frame from the backing store, the same way the Translator does for each store mode.
+ * @param frame The frame number.
+ * @param page The page being loaded into it.
+ * @return Where the frame's bytes can be read from.
+ */
+const char *TranslationEngine::loadFrame(int frame, u_int64_t page) {
+    if (fileProcessor->getStoreMode() == STORE_ALIAS) {
+        const char *data = fileProcessor->mapPage(page);
+        physicalMemory->mapFrame(frame, data);
+        return data;
+    }
+    char *buffer = physicalMemory->getFrameBuffer(frame);
+    if (fileProcessor->getStoreMode() == STORE_MMAP)
+        physicalMemory->fillFrame(frame, fileProcessor->mapPage(page));
+    else
+        fileProcessor->getDataFromStore(page, buffer);
+    return buffer;
+}
+
+/** writeMetrics
+ * Writes the engine's counters as one JSON object, in the layout the Translator uses. No latencies are sampled.
+ * @param out The stream to write to.
+ */
+void TranslationEngine::writeMetrics(std::ostream &out) {
+    long long misses = translations - tlbHits;
+    out << "{\"translations\": " << translations << ",\n";
+    out << " \"engine\": \"" << getName() << "\", \"kernels\": \"" << getKernelName() << "\",\n";
+    out << " \"tlb\": {\"lookups\": " << translations << ", \"hits\": " << tlbHits << ", \"misses\": " << misses
+        << ", \"hit_rate\": " << (translations == 0 ? 0 : (double)tlbHits / translations)
+        << ", \"large_hits\": 0, \"levels\": [{\"entries\": " << getTLBSize() << ", \"ways\": " << getTLBWays()
+        << ", \"hits\": " << tlbHits << ", \"misses\": " << misses
+        << ", \"hit_rate\": " << (translations == 0 ? 0 : (double)tlbHits / translations) << "}]},\n";
+    out << " \"page_table\": {\"type\": \"direct\", \"walks\": " << misses << ", \"large_walks\": 0"
+        << ", \"lookups\": " << misses << ", \"faults\": " << faults
+        << ", \"fault_rate\": " << (misses == 0 ? 0 : (double)faults / misses)
+        << ", \"memory_bytes\": " << getPageTableMemory() << "},\n";
+    out << " \"physical_memory\": {\"frames\": " << physicalMemory->getFrameCount()
+        << ", \"frames_used\": " << physicalMemory->getFramesUsed()
+        << ", \"evictions\": " << physicalMemory->getEvictionCount()
+        << ", \"arena_bytes\": " << physicalMemory->getArenaSize()
+        << ", \"huge_pages\": " << (physicalMemory->isHugePageBacked() ? "true" : "false") << "},\n";
+    out << " \"backing_store\": {\"reads\": " << fileProcessor->getReadCount() << "}}" << std::endl;
+}
+
+/** createForGeometry
+ * Picks the TLB shape for an engine compiled for one geometry.
+ * @param entries The number of TLB entries.
+ * @param ways The entries per set, 0 for fully associative.
+ * @param fileProcessor The source of backing store pages.
+ * @param physicalMemory The physical memory.
+ * @param name The geometry as address/page bits, e.g. "16/8".
+ * @return The engine, or nullptr if the TLB shape has no instantiation.
+ */
+template <int AddressBits, int OffsetBits>
+static TranslationEngine *createForGeometry(int entries, int ways, FileProcessor *fileProcessor,
+                                            PhysicalMemory *physicalMemory, const std::string &name) {
+    if (entries == MAX_TLB_SIZE && ways == 0)
+        return new SpecializedEngine<AddressBits, OffsetBits, MAX_TLB_SIZE, 0>(fileProcessor, physicalMemory,
+                                                                               name + ", 16x0");
+    if (entries == 64 && ways == 0)
+        return new SpecializedEngine<AddressBits, OffsetBits, 64, 0>(fileProcessor, physicalMemory, name + ", 64x0");
+    if (entries == 64 && ways == 4)
+        return new SpecializedEngine<AddressBits, OffsetBits, 64, 4>(fileProcessor, physicalMemory, name + ", 64x4");
+    return nullptr;
+}
+
+/** createTranslationEngine
+ * Finds the engine compiled for a run's geometry and TLB. Instantiations exist for 16-bit addresses with
+ * 256-byte pages (the default), 20- and 32-bit addresses with 4 KiB pages and 24-bit addresses with 64 KiB
+ * pages, each with a 16-entry fully associative (the default), 64-entry fully associative or 64-entry 4-way TLB.
+ * @param geometry How addresses split into pages; large pages are never handled.
+ * @param tlb The only TLB level.
+ * @param fileProcessor The source of backing store pages.
+ * @param physicalMemory The physical memory.
+ * @return The engine, or nullptr if there is none for this geometry and TLB.
+ */
+TranslationEngine *createTranslationEngine(const Geometry &geometry, const TLBLevelConfig &tlb,
+                                           FileProcessor *fileProcessor, PhysicalMemory *physicalMemory) {
+    if (geometry.largeBits != 0)
+        return nullptr;
+    // The TLB class treats any ways of at least the size as fully associative.
+    int ways = tlb.ways >= tlb.size ? 0 : tlb.ways;
+    int bits = geometry.addressBits << 8 | geometry.offsetBits;
+    switch (bits) {
+        case 16 << 8 | 8:
+            return createForGeometry<16, 8>(tlb.size, ways, fileProcessor, physicalMemory, "16/8");
+        case 20 << 8 | 12:
+            return createForGeometry<20, 12>(tlb.size, ways, fileProcessor, physicalMemory, "20/12");
+        case 24 << 8 | 16:
+            return createForGeometry<24, 16>(tlb.size, ways, fileProcessor, physicalMemory, "24/16");
+        case 32 << 8 | 12:
+            return createForGeometry<32, 12>(tlb.size, ways, fileProcessor, physicalMemory, "32/12");
+        default:
+            return nullptr;
+    }
+}
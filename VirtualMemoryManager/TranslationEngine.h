@@ -0,0 +1,334 @@
+// TranslationEngine.h
+// The TranslationEngine classes translate whole batches of addresses for the plain case: one address space,
+// base pages only, a single TLB level and no prefetching or write-back. SpecializedEngine is compiled for one
+// page geometry and TLB shape, so its TLB sets, page table size and masks are all constants and the per-address
+// path inlines into one loop. createTranslationEngine picks the instantiation matching the run's options at
+// runtime, and returns nullptr when there is none, in which case the general Translator is used.
+// Each batch of raw trace values is decoded at once, and with a fully associative TLB every BATCH_LANES pages
+// are probed together by the batch kernels, so only the misses take the scalar page table path.
+// Results match the Translator's exactly; only the sampled latencies are not recorded.
+
+#ifndef VIRTUALMEMORYMANAGER_TRANSLATIONENGINE_H
+#define VIRTUALMEMORYMANAGER_TRANSLATIONENGINE_H
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "address.h"
+#include "BatchKernels.h"
+#include "FileProcessor.h"
+#include "OutputWriter.h"
+#include "PhysicalMemory.h"
+#include "TLBHierarchy.h"
+
+// Pages with more bits than this are left to the general Translator and its sparse page tables.
+#define ENGINE_MAX_PAGE_BITS 20
+
+/** StaticTLB
+ * A set-associative TLB with LRU replacement inside each set, shaped at compile time. Ways of 0 mean fully
+ * associative, and the number of sets is rounded down to a power of two, as the TLB class does.
+ * Each slot keeps the time it was last used, so the LRU entry of a set is the one with the oldest time.
+ */
+template <int Entries, int Ways>
+class StaticTLB {
+public:
+    static constexpr int WAYS = Ways < 1 || Ways > Entries ? Entries : Ways;
+    static constexpr int SETS = [] {
+        int sets = 1;
+        while (sets * 2 <= Entries / WAYS)
+            sets *= 2;
+        return sets;
+    }();
+    static constexpr u_int64_t SET_MASK = SETS - 1;
+    // Page numbers are far narrower than 64 bits, so this never matches one.
+    static constexpr u_int64_t EMPTY = ~0ull;
+
+    /** StaticTLB constructor
+     * Initializes every slot as empty.
+     */
+    StaticTLB() {
+        for (int i = 0; i < SETS * WAYS; i++) {
+            pages[i] = EMPTY;
+            frames[i] = 0;
+            used[i] = 0;
+        }
+        clock = 0;
+    }
+
+    /** lookup
+     * Finds a page and makes it the most recently used entry of its set.
+     * @param page The page number.
+     * @return The frame number, or -1 if the page is not in the TLB.
+     */
+    int lookup(u_int64_t page) {
+        int first = (int)(page & SET_MASK) * WAYS;
+        for (int i = first; i < first + WAYS; i++) {
+            if (pages[i] == page) {
+                used[i] = ++clock;
+                return (int)frames[i];
+            }
+        }
+        return -1;
+    }
+
+    /** holds
+     * @param slot A slot index.
+     * @param page The page number.
+     * @return True if the slot holds the page.
+     */
+    bool holds(int slot, u_int64_t page) const {
+        return pages[slot] == page;
+    }
+
+    /** touch
+     * Makes a slot found by a batch probe the most recently used entry of its set, as lookup does.
+     * @param slot The slot index.
+     * @return The frame number in the slot.
+     */
+    int touch(int slot) {
+        used[slot] = ++clock;
+        return (int)frames[slot];
+    }
+
+    /** getPages
+     * @return The page in every slot, set by set, 32-byte aligned for the batch kernels.
+     */
+    const u_int64_t *getPages() const {
+        return pages;
+    }
+
+    /** addEntry
+     * Adds a page that is not in the TLB, into an empty slot of its set if there is one and over the least
+     * recently used entry otherwise.
+     * @param page The page number.
+     * @param frame The frame number.
+     */
+    void addEntry(u_int64_t page, u_int32_t frame) {
+        int first = (int)(page & SET_MASK) * WAYS;
+        int victim = first;
+        for (int i = first; i < first + WAYS; i++) {
+            if (pages[i] == EMPTY) {
+                victim = i;
+                break;
+            }
+            if (used[i] < used[victim])
+                victim = i;
+        }
+        pages[victim] = page;
+        frames[victim] = frame;
+        used[victim] = ++clock;
+    }
+
+    /** removeEntry
+     * Drops the entry for a page, e.g. when its frame is evicted.
+     * @param page The page number.
+     */
+    void removeEntry(u_int64_t page) {
+        int first = (int)(page & SET_MASK) * WAYS;
+        for (int i = first; i < first + WAYS; i++) {
+            if (pages[i] == page) {
+                pages[i] = EMPTY;
+                return;
+            }
+        }
+    }
+
+private:
+    alignas(32) u_int64_t pages[SETS * WAYS];
+    u_int32_t frames[SETS * WAYS];
+    u_int64_t used[SETS * WAYS];
+    u_int64_t clock;
+};
+
+/** StaticPageTable
+ * A flat table with an entry for every one of the 2^PageBits pages, sized at compile time.
+ */
+template <int PageBits>
+class StaticPageTable {
+public:
+    static constexpr u_int64_t PAGES = 1ull << PageBits;
+    static constexpr u_int64_t MASK = PAGES - 1;
+
+    /** StaticPageTable constructor
+     * Initializes every page as unmapped.
+     */
+    StaticPageTable() : entries(PAGES, -1) {
+    }
+
+    /** getFrame
+     * @param page The page number.
+     * @return The frame number, or -1 if the page is not mapped.
+     */
+    int getFrame(u_int64_t page) const {
+        return entries[page & MASK];
+    }
+
+    /** setFrame
+     * @param page The page number.
+     * @param frame The frame number, or -1 to unmap the page.
+     */
+    void setFrame(u_int64_t page, int frame) {
+        entries[page & MASK] = frame;
+    }
+
+    /** getMemoryUsage
+     * @return The bytes held by the table.
+     */
+    size_t getMemoryUsage() const {
+        return entries.size() * sizeof(int);
+    }
+
+private:
+    std::vector<int> entries;
+};
+
+class TranslationEngine {
+public:
+    virtual ~TranslationEngine() {}
+    virtual const char *getName() = 0;
+    virtual void translateBatch(const u_int64_t *values, int count, OutputWriter &writer) = 0;
+    virtual long long getTranslationCount() = 0;
+    virtual long long getTLBHits() = 0;
+    virtual long long getFaultCount() = 0;
+    virtual long long getFaultTime() = 0;
+    virtual int getTLBSize() = 0;
+    virtual int getTLBWays() = 0;
+    virtual size_t getPageTableMemory() = 0;
+    void setVectorized(bool vectorized);
+    const char *getKernelName();
+    void writeMetrics(std::ostream &out);
+
+protected:
+    FileProcessor *fileProcessor;
+    PhysicalMemory *physicalMemory;
+    const BatchKernels *kernels;
+    // The current batch, decoded.
+    std::vector<u_int64_t> pages;
+    std::vector<u_int32_t> offsets;
+    // frameData[frame] points at the bytes of the page in the frame: its arena slot, or the backing store
+    // mapping when frames are aliased.
+    std::vector<const char *> frameData;
+    long long translations;
+    long long tlbHits;
+    long long faults;
+    long long faultTime;
+
+    TranslationEngine(FileProcessor *fileProcessor, PhysicalMemory *physicalMemory);
+    void decodeBatch(const u_int64_t *values, int count, int addressBits, int offsetBits);
+    const char *loadFrame(int frame, u_int64_t page);
+};
+
+/** SpecializedEngine
+ * The translation loop compiled for addresses of AddressBits bits split at OffsetBits, and a TLB of
+ * TLBEntries entries in sets of TLBWays (0 for fully associative).
+ */
+template <int AddressBits, int OffsetBits, int TLBEntries, int TLBWays>
+class SpecializedEngine : public TranslationEngine {
+public:
+    static constexpr int PAGE_NUMBER_BITS = AddressBits - OffsetBits;
+    static_assert(PAGE_NUMBER_BITS > 0 && PAGE_NUMBER_BITS <= ENGINE_MAX_PAGE_BITS, "the page table must fit in memory");
+    typedef StaticTLB<TLBEntries, TLBWays> EngineTLB;
+    // The batch probe needs one set whose entries fill whole 256-bit vectors, and slot numbers that fit a byte.
+    static constexpr bool BATCH_PROBE = EngineTLB::SETS == 1 && EngineTLB::WAYS % 4 == 0 && EngineTLB::WAYS <= 256;
+
+    /** SpecializedEngine constructor
+     * @param fileProcessor The source of backing store pages.
+     * @param physicalMemory The physical memory, with frames of 2^OffsetBits bytes.
+     * @param name What the engine was compiled for as address/page bits, TLB entries x ways, e.g. "16/8, 16x0".
+     */
+    SpecializedEngine(FileProcessor *fileProcessor, PhysicalMemory *physicalMemory, const std::string &name)
+            : TranslationEngine(fileProcessor, physicalMemory) {
+        this->name = name;
+    }
+
+    const char *getName() override { return name.c_str(); }
+    int getTLBSize() override { return EngineTLB::SETS * EngineTLB::WAYS; }
+    int getTLBWays() override { return EngineTLB::WAYS; }
+    size_t getPageTableMemory() override { return pageTable.getMemoryUsage(); }
+    long long getTranslationCount() override { return translations; }
+    long long getTLBHits() override { return tlbHits; }
+    long long getFaultCount() override { return faults; }
+    long long getFaultTime() override { return faultTime; }
+
+    /** translateBatch
+     * Translates a batch of raw trace values in order and reports each one. The whole batch is decoded first,
+     * so an address out of bounds stops the run before any of the batch is translated, as with readBatch.
+     * A probe's hit mask stays valid until a miss changes the TLB; after that a hit is still trusted once its
+     * slot is seen to hold the page, and anything else is looked up again.
+     * @param values The raw values, as FileProcessor::readRawBatch returns them.
+     * @param count The number of values.
+     * @param writer Where each translation is reported.
+     */
+    void translateBatch(const u_int64_t *values, int count, OutputWriter &writer) override {
+        decodeBatch(values, count, AddressBits, OffsetBits);
+        Translation result;
+        result.largePage = false;
+        result.prefetch = nullptr;
+        result.writeBack = -1;
+        u_int8_t slots[BATCH_LANES];
+        for (int first = 0; first < count; first += BATCH_LANES) {
+            int lanes = count - first < BATCH_LANES ? count - first : BATCH_LANES;
+            u_int32_t hits = 0;
+            if (BATCH_PROBE)
+                hits = kernels->probe(tlb.getPages(), EngineTLB::WAYS, pages.data() + first, lanes, slots);
+            bool changed = !BATCH_PROBE;
+            for (int lane = 0; lane < lanes; lane++) {
+                int i = first + lane;
+                u_int64_t page = pages[i];
+                result.page = page;
+                result.offset = offsets[i];
+                result.tlbHit = false;
+                result.pageFault = false;
+                translations++;
+
+                int frame = -1;
+                if ((hits >> lane & 1) && tlb.holds(slots[lane], page))
+                    frame = tlb.touch(slots[lane]);
+                else if (changed)
+                    frame = tlb.lookup(page);
+                if (frame != -1) {
+                    result.tlbHit = true;
+                    tlbHits++;
+                    physicalMemory->touchFrame(frame);
+                } else if ((frame = pageTable.getFrame(page)) != -1) {
+                    tlb.addEntry(page, frame);
+                    physicalMemory->touchFrame(frame);
+                    changed = true;
+                } else {
+                    auto faultStart = std::chrono::steady_clock::now();
+                    result.pageFault = true;
+                    faults++;
+                    int64_t evictedPage;
+                    frame = physicalMemory->claimFrame(page, evictedPage);
+                    if (evictedPage != -1) {
+                        pageTable.setFrame((u_int64_t)evictedPage, -1);
+                        tlb.removeEntry((u_int64_t)evictedPage);
+                    }
+                    pageTable.setFrame(page, frame);
+                    frameData[frame] = loadFrame(frame, page);
+                    faultTime += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - faultStart).count();
+                    changed = true;
+                }
+                result.frame = frame;
+                result.value = frameData[frame][result.offset];
+                writer.writeTranslation(result);
+            }
+        }
+    }
+
+private:
+    std::string name;
+    EngineTLB tlb;
+    StaticPageTable<PAGE_NUMBER_BITS> pageTable;
+};
+
+TranslationEngine *createTranslationEngine(const Geometry &geometry, const TLBLevelConfig &tlb,
+                                           FileProcessor *fileProcessor, PhysicalMemory *physicalMemory);
+
+
+#endif //VIRTUALMEMORYMANAGER_TRANSLATIONENGINE_H
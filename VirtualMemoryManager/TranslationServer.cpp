@@ -0,0 +1,409 @@
+// TranslationServer.cpp
+// The TranslationServer class keeps one Translator resident and answers translation requests over a Unix domain
+// socket, one epoll loop serving every client.
+
+#include "TranslationServer.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "OutputWriter.h"
+#include "TraceFormat.h"
+
+// Events taken from epoll at a time.
+#define SERVICE_EVENT_BATCH 64
+
+/** TranslationServer constructor
+ * @param translator The translator every request runs through.
+ * @param geometry How addresses split into pages.
+ */
+TranslationServer::TranslationServer(Translator *translator, const Geometry &geometry) {
+    this->translator = translator;
+    this->geometry = geometry;
+    this->listenFd = -1;
+    this->epollFd = -1;
+    this->connectionCount = 0;
+    this->requests = 0;
+    this->addresses = 0;
+    this->rejected = 0;
+}
+
+/** TranslationServer destructor
+ * Closes every connection and removes the socket.
+ */
+TranslationServer::~TranslationServer() {
+    for (auto &entry : connections)
+        close(entry.first);
+    if (epollFd != -1)
+        close(epollFd);
+    if (listenFd != -1) {
+        close(listenFd);
+        unlink(path.c_str());
+    }
+}
+
+/** start
+ * Listens on a Unix domain socket. A socket file left behind by a server that has exited is replaced, but a live
+ * server's socket or any other file is not.
+ * @param path The socket's path.
+ * @return True if the server is listening; false after reporting why not.
+ */
+bool TranslationServer::start(const std::string &path) {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Error: the socket path must be 1 to " << sizeof(address.sun_path) - 1 << " characters: " << path
+                  << std::endl;
+        return false;
+    }
+    memcpy(address.sun_path, path.c_str(), path.size());
+    struct stat info;
+    if (stat(path.c_str(), &info) == 0) {
+        if (!S_ISSOCK(info.st_mode)) {
+            std::cerr << "Error: " << path << " exists and is not a socket." << std::endl;
+            return false;
+        }
+        int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        bool live = probe != -1 && connect(probe, (sockaddr *)&address, sizeof(address)) == 0;
+        if (probe != -1)
+            close(probe);
+        if (live) {
+            std::cerr << "Error: another server is listening on " << path << std::endl;
+            return false;
+        }
+        unlink(path.c_str());
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1 || bind(fd, (sockaddr *)&address, sizeof(address)) == -1 || ::listen(fd, SOMAXCONN) == -1) {
+        std::cerr << "Error listening on " << path << ": " << strerror(errno) << std::endl;
+        if (fd != -1)
+            close(fd);
+        return false;
+    }
+    this->listenFd = fd;
+    this->path = path;
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = listenFd;
+    if (epollFd == -1 || epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event) == -1) {
+        std::cerr << "Error setting up epoll: " << strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/** serve
+ * Waits for the next events and handles them: new clients, arriving requests and sockets ready for responses.
+ * @param waitMask The signal mask while waiting, so signals blocked the rest of the time end the wait.
+ * @return True unless waiting failed; a wait ended by a signal returns true with nothing handled.
+ */
+bool TranslationServer::serve(const sigset_t *waitMask) {
+    epoll_event events[SERVICE_EVENT_BATCH];
+    int count = epoll_pwait(epollFd, events, SERVICE_EVENT_BATCH, -1, waitMask);
+    if (count == -1) {
+        if (errno == EINTR)
+            return true;
+        std::cerr << "Error waiting for events: " << strerror(errno) << std::endl;
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        int fd = events[i].data.fd;
+        if (fd == listenFd) {
+            acceptConnections();
+            continue;
+        }
+        auto found = connections.find(fd);
+        if (found == connections.end())
+            continue;
+        Connection &connection = found->second;
+        bool open = (events[i].events & EPOLLERR) == 0;
+        if (open && (events[i].events & EPOLLIN))
+            open = receive(connection);
+        if (open)
+            open = pump(connection);
+        if (open)
+            watch(connection);
+        else
+            disconnect(fd);
+    }
+    return true;
+}
+
+/** acceptConnections
+ * Takes every client waiting to connect.
+ */
+void TranslationServer::acceptConnections() {
+    while (true) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && errno != ECONNABORTED)
+                std::cerr << "Error accepting a connection: " << strerror(errno) << std::endl;
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            return;
+        }
+        Connection &connection = connections[fd];
+        connection.fd = fd;
+        connection.events = EPOLLIN;
+        connection.inputUsed = 0;
+        connection.scanned = 0;
+        connection.outputSent = 0;
+        connection.atEnd = false;
+        connection.closing = false;
+        epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == -1) {
+            std::cerr << "Error watching a connection: " << strerror(errno) << std::endl;
+            connections.erase(fd);
+            close(fd);
+            continue;
+        }
+        connectionCount++;
+    }
+}
+
+/** receive
+ * Reads what a client has sent and notes when each request it completes arrived.
+ * @param connection The client.
+ * @return False if the connection failed.
+ */
+bool TranslationServer::receive(Connection &connection) {
+    if (connection.input.size() - connection.inputUsed < SERVICE_READ_SIZE)
+        connection.input.resize(connection.inputUsed + SERVICE_READ_SIZE);
+    ssize_t n = read(connection.fd, connection.input.data() + connection.inputUsed, SERVICE_READ_SIZE);
+    if (n == 0) {
+        connection.atEnd = true;
+        return true;
+    }
+    if (n < 0)
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    connection.inputUsed += n;
+
+    TimePoint now = std::chrono::steady_clock::now();
+    while (connection.inputUsed - connection.scanned >= sizeof(ServiceRequest)) {
+        ServiceRequest request;
+        memcpy(&request, connection.input.data() + connection.scanned, sizeof(request));
+        // An oversized request is answered as soon as its header arrives, so it counts as whole.
+        size_t length = sizeof(request);
+        if (request.count <= SERVICE_MAX_ADDRESSES)
+            length += (size_t)request.count * sizeof(u_int64_t);
+        if (connection.inputUsed - connection.scanned < length)
+            break;
+        connection.arrivals.push_back(now);
+        connection.scanned += length;
+        if (request.count > SERVICE_MAX_ADDRESSES)
+            break;
+    }
+    return true;
+}
+
+/** pump
+ * Answers a client's whole requests and sends the responses, until its socket is full, its backlog is, or it has
+ * no whole request left.
+ * @param connection The client.
+ * @return False if the connection failed or is finished.
+ */
+bool TranslationServer::pump(Connection &connection) {
+    do {
+        process(connection);
+        if (!flush(connection))
+            return false;
+    } while (connection.outputSent == connection.output.size() && !connection.arrivals.empty() &&
+             !connection.closing);
+    bool sent = connection.outputSent == connection.output.size();
+    if (connection.closing && sent)
+        return false;
+    return !(connection.atEnd && sent && connection.arrivals.empty());
+}
+
+/** process
+ * Answers whole requests in order until there are none left or the backlog of unsent responses is full.
+ * @param connection The client.
+ */
+void TranslationServer::process(Connection &connection) {
+    size_t start = 0;
+    while (!connection.arrivals.empty() && !connection.closing &&
+           connection.output.size() - connection.outputSent < SERVICE_MAX_BACKLOG) {
+        ServiceRequest request;
+        memcpy(&request, connection.input.data() + start, sizeof(request));
+        TimePoint arrived = connection.arrivals.front();
+        connection.arrivals.pop_front();
+        if (request.count > SERVICE_MAX_ADDRESSES) {
+            ServiceResponse response = {0, SERVICE_STATUS_TOO_LARGE};
+            connection.output.insert(connection.output.end(), (const char *)&response,
+                                     (const char *)&response + sizeof(response));
+            connection.pending.emplace_back(connection.output.size(), arrived);
+            connection.closing = true;
+            rejected++;
+            break;
+        }
+        respond(connection, connection.input.data() + start + sizeof(request), request.count, arrived);
+        start += sizeof(request) + (size_t)request.count * sizeof(u_int64_t);
+    }
+    if (start > 0) {
+        memmove(connection.input.data(), connection.input.data() + start, connection.inputUsed - start);
+        connection.inputUsed -= start;
+        connection.scanned -= start;
+    }
+}
+
+/** respond
+ * Translates one request's addresses and appends the response. Every address is checked before any is
+ * translated, so a request with one out of bounds leaves the simulated memory as it was.
+ * @param connection The client.
+ * @param values The request's addresses, with TRACE_WRITE_BIT set for a write.
+ * @param count The number of addresses.
+ * @param arrived When the request arrived.
+ */
+void TranslationServer::respond(Connection &connection, const char *values, u_int32_t count, TimePoint arrived) {
+    ServiceResponse response = {count, SERVICE_STATUS_OK};
+    for (u_int32_t i = 0; i < count; i++) {
+        u_int64_t value;
+        memcpy(&value, values + i * sizeof(value), sizeof(value));
+        if ((value & ~TRACE_WRITE_BIT) >= geometry.getAddressSpace()) {
+            response = {0, SERVICE_STATUS_OUT_OF_BOUNDS};
+            break;
+        }
+    }
+    size_t end = connection.output.size();
+    connection.output.resize(end + sizeof(response) + (size_t)response.count * sizeof(OutputRecord));
+    memcpy(connection.output.data() + end, &response, sizeof(response));
+    end += sizeof(response);
+    Address address;
+    Translation result;
+    for (u_int32_t i = 0; i < response.count; i++) {
+        u_int64_t value;
+        memcpy(&value, values + i * sizeof(value), sizeof(value));
+        geometry.split(value & ~TRACE_WRITE_BIT, address);
+        address.write = value >> 63;
+        translator->translate(address, result);
+        end += OutputWriter::formatTranslation(OUTPUT_BINARY, result, connection.output.data() + end);
+    }
+    connection.pending.emplace_back(end, arrived);
+    if (response.status == SERVICE_STATUS_OK) {
+        requests++;
+        addresses += count;
+    } else {
+        rejected++;
+    }
+}
+
+/** flush
+ * Sends as much of a client's responses as its socket takes, and records the latency of every one fully sent.
+ * @param connection The client.
+ * @return False if the connection failed.
+ */
+bool TranslationServer::flush(Connection &connection) {
+    while (connection.outputSent < connection.output.size()) {
+        ssize_t n = ::send(connection.fd, connection.output.data() + connection.outputSent,
+                           connection.output.size() - connection.outputSent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        if (n <= 0)
+            return false;
+        connection.outputSent += n;
+    }
+    TimePoint now = std::chrono::steady_clock::now();
+    while (!connection.pending.empty() && connection.pending.front().first <= connection.outputSent) {
+        latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                now - connection.pending.front().second).count());
+        connection.pending.pop_front();
+    }
+    // Sent bytes are dropped once they are all sent, or once they outgrow the backlog.
+    size_t sent = connection.outputSent;
+    if (sent == connection.output.size() || sent >= SERVICE_MAX_BACKLOG) {
+        connection.output.erase(connection.output.begin(), connection.output.begin() + sent);
+        connection.outputSent = 0;
+        for (auto &response : connection.pending)
+            response.first -= sent;
+    }
+    return true;
+}
+
+/** watch
+ * Registers a client for reading while it has room for more requests, and for writing while responses wait.
+ * @param connection The client.
+ */
+void TranslationServer::watch(Connection &connection) {
+    u_int32_t events = 0;
+    size_t backlog = connection.output.size() - connection.outputSent;
+    if (!connection.atEnd && !connection.closing && backlog < SERVICE_MAX_BACKLOG)
+        events |= EPOLLIN;
+    if (backlog > 0)
+        events |= EPOLLOUT;
+    if (events == connection.events)
+        return;
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.fd = connection.fd;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, connection.fd, &event);
+    connection.events = events;
+}
+
+/** disconnect
+ * Closes a client's connection and forgets it.
+ * @param fd The client's socket.
+ */
+void TranslationServer::disconnect(int fd) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    connections.erase(fd);
+}
+
+/** getPath
+ * @return The socket's path.
+ */
+const std::string &TranslationServer::getPath() {
+    return path;
+}
+
+/** getConnectionCount
+ * @return The number of clients that connected.
+ */
+long long TranslationServer::getConnectionCount() {
+    return connectionCount;
+}
+
+/** getRequestCount
+ * @return The number of requests answered with translations.
+ */
+long long TranslationServer::getRequestCount() {
+    return requests;
+}
+
+/** getAddressCount
+ * @return The number of addresses translated.
+ */
+long long TranslationServer::getAddressCount() {
+    return addresses;
+}
+
+/** getRejectedCount
+ * @return The number of requests answered with an error.
+ */
+long long TranslationServer::getRejectedCount() {
+    return rejected;
+}
+
+/** getLatency
+ * @return The latency of every request, in nanoseconds from its arrival to its response being sent.
+ */
+const Histogram &TranslationServer::getLatency() {
+    return latency;
+}
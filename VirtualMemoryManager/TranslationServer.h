@@ -0,0 +1,121 @@
+// TranslationServer.h
+// The TranslationServer class keeps one Translator resident and answers translation requests over a Unix domain
+// socket, so a query pays neither process start-up nor opening the backing store.
+// A request is a ServiceRequest followed by its addresses as 64-bit values, with TRACE_WRITE_BIT set for a
+// write; the response is a ServiceResponse followed by one OutputRecord per address, as in OUTPUT_BINARY mode.
+// All fields are in host byte order. A client can send many requests without waiting: they are answered in order,
+// and several clients share the one simulated memory, a whole request at a time.
+// One thread runs an epoll loop over the listening socket and every connection. Each request's latency is
+// measured from when its last byte arrives to when the last byte of its response is sent.
+
+#ifndef VIRTUALMEMORYMANAGER_TRANSLATIONSERVER_H
+#define VIRTUALMEMORYMANAGER_TRANSLATIONSERVER_H
+
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "address.h"
+#include "Metrics.h"
+#include "Translator.h"
+
+// The most addresses one request can carry.
+#define SERVICE_MAX_ADDRESSES 65536
+// A connection's requests are not read while more than this many response bytes wait to be sent to it.
+#define SERVICE_MAX_BACKLOG (4 * 1024 * 1024)
+// Bytes read from a connection at a time.
+#define SERVICE_READ_SIZE (64 * 1024)
+
+// Values of ServiceResponse::status.
+#define SERVICE_STATUS_OK 0
+// An address was outside the address space; none of the request was translated.
+#define SERVICE_STATUS_OUT_OF_BOUNDS 1
+// The request carried more than SERVICE_MAX_ADDRESSES addresses; the connection is closed after this response.
+#define SERVICE_STATUS_TOO_LARGE 2
+
+/** ServiceRequest
+ * The start of a request; count 64-bit addresses follow it.
+ */
+struct ServiceRequest {
+    u_int32_t count;
+    u_int32_t reserved;
+};
+
+/** ServiceResponse
+ * The start of a response; count OutputRecords follow it, one per address of the request, in order.
+ */
+struct ServiceResponse {
+    u_int32_t count;
+    u_int32_t status;
+};
+
+static_assert(sizeof(ServiceRequest) == 8 && sizeof(ServiceResponse) == 8, "service headers must be 8 bytes");
+
+class TranslationServer {
+public:
+    TranslationServer(Translator *translator, const Geometry &geometry);
+    ~TranslationServer();
+    bool start(const std::string &path);
+    bool serve(const sigset_t *waitMask);
+    const std::string &getPath();
+    long long getConnectionCount();
+    long long getRequestCount();
+    long long getAddressCount();
+    long long getRejectedCount();
+    const Histogram &getLatency();
+
+private:
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    /** Connection
+     * One client, the bytes of its next requests and the responses not yet sent to it.
+     */
+    struct Connection {
+        int fd;
+        // The events the connection is registered for.
+        u_int32_t events;
+        std::vector<char> input;
+        size_t inputUsed;
+        // Where the first request in input that has not fully arrived starts.
+        size_t scanned;
+        // When each whole request in input arrived, oldest first.
+        std::deque<TimePoint> arrivals;
+        std::vector<char> output;
+        size_t outputSent;
+        // The end of every response in output that is not fully sent, and when its request arrived.
+        std::deque<std::pair<size_t, TimePoint>> pending;
+        // Set once the client has stopped sending.
+        bool atEnd;
+        // Set once a response ends the connection.
+        bool closing;
+    };
+
+    Translator *translator;
+    Geometry geometry;
+    std::string path;
+    int listenFd;
+    int epollFd;
+    std::unordered_map<int, Connection> connections;
+
+    long long connectionCount;
+    long long requests;
+    long long addresses;
+    long long rejected;
+    Histogram latency;
+
+    void acceptConnections();
+    bool receive(Connection &connection);
+    bool pump(Connection &connection);
+    void process(Connection &connection);
+    void respond(Connection &connection, const char *values, u_int32_t count, TimePoint arrived);
+    bool flush(Connection &connection);
+    void watch(Connection &connection);
+    void disconnect(int fd);
+};
+
+
+#endif //VIRTUALMEMORYMANAGER_TRANSLATIONSERVER_H
@@ -0,0 +1,702 @@
+// Translator.cpp
+// The Translator class runs one virtual address at a time through the TLB, the page table and physical memory.
+
+#include "Translator.h"
+
+#include <chrono>
+
+#include "Checkpoint.h"
+
+/** elapsedSince
+ * @param start A time point taken earlier.
+ * @return The nanoseconds since then.
+ */
+static long long elapsedSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+/** Translator constructor
+ * Builds the large page table when the geometry has large pages, and sets the physical memory up for aliased
+ * frames when the backing store hands them out.
+ * @param fileProcessor The source of backing store pages.
+ * @param tlb The TLB hierarchy, built with the geometry's large page shift.
+ * @param pageTable The page table.
+ * @param physicalMemory The physical memory.
+ * @param geometry How addresses split into base and large pages.
+ */
+Translator::Translator(FileProcessor *fileProcessor, TLBHierarchy *tlb, PageTable *pageTable, PhysicalMemory *physicalMemory,
+                       const Geometry &geometry) {
+    this->fileProcessor = fileProcessor;
+    this->tlb = tlb;
+    this->pageTable = pageTable;
+    this->physicalMemory = physicalMemory;
+    this->faultTime = 0;
+    this->translations = 0;
+    this->sampleClock = 0;
+    this->largeShift = geometry.getLargeShift();
+    this->largeMask = (1ull << this->largeShift) - 1;
+    this->largePageTable = nullptr;
+    if (this->largeShift > 0) {
+        int largePageBits = geometry.getPageBits() - this->largeShift;
+        this->largePageTable = new RadixPageTable(largePageBits, PageTable::levelsFor(largePageBits));
+    }
+    this->walks = 0;
+    this->largeWalks = 0;
+    this->promotions = 0;
+    this->demotions = 0;
+    this->prefetcher = nullptr;
+    this->flusher = nullptr;
+    this->writes = 0;
+    this->pageCount = 1ull << geometry.getPageBits();
+    this->spaces.push_back(pageTable);
+    this->spaceStats.push_back(AddressSpaceStats());
+    this->space = 0;
+    this->sharing = false;
+    this->switches = 0;
+    this->taggedTLB = false;
+    this->asid = 0;
+    this->flushedEntries = 0;
+    this->sharedFaults = 0;
+    this->cowFaults = 0;
+    this->cowTime = 0;
+    if (fileProcessor->getStoreMode() == STORE_ALIAS)
+        physicalMemory->enableAliasing();
+}
+
+/** Translator destructor
+ * Deletes the large page table.
+ */
+Translator::~Translator() {
+    delete largePageTable;
+}
+
+/** setPrefetcher
+ * Turns on prefetching. The prefetcher must read the same backing store as the translator.
+ * @param prefetcher The prefetcher, or nullptr to turn prefetching off.
+ */
+void Translator::setPrefetcher(Prefetcher *prefetcher) {
+    this->prefetcher = prefetcher;
+}
+
+/** setWriteBack
+ * Turns on write-back: dirty pages are handed to the flusher when they are evicted.
+ * @param flusher The flusher, or nullptr to drop dirty pages.
+ */
+void Translator::setWriteBack(WriteBackFlusher *flusher) {
+    this->flusher = flusher;
+    physicalMemory->setWriteBack(flusher);
+}
+
+/** addAddressSpace
+ * Adds an address space; the page table passed to the constructor is address space 0.
+ * Large pages and prefetching only work with a single address space.
+ * @param pageTable The new address space's page table.
+ * @return The address space number, or -1 if there are already MAX_ADDRESS_SPACES.
+ */
+int Translator::addAddressSpace(PageTable *pageTable) {
+    if ((int)spaces.size() >= MAX_ADDRESS_SPACES)
+        return -1;
+    spaces.push_back(pageTable);
+    spaceStats.push_back(AddressSpaceStats());
+    return (int)spaces.size() - 1;
+}
+
+/** switchAddressSpace
+ * Makes an address space the running one. If it changes, an untagged TLB is flushed, while a tagged one
+ * just starts using the new address space's tag.
+ * @param space The address space number.
+ */
+void Translator::switchAddressSpace(int space) {
+    if (space == this->space)
+        return;
+    if (taggedTLB)
+        asid = (u_int64_t)space << ASID_SHIFT;
+    else
+        flushedEntries += tlb->flush();
+    this->space = space;
+    this->pageTable = spaces[space];
+    switches++;
+    spaceStats[space].switchesIn++;
+}
+
+/** setSharing
+ * Turns frame sharing on: a page fault maps the frame another address space already loaded the page into,
+ * and a write to a shared frame first gives the writer a private copy.
+ * @param sharing True to share frames.
+ */
+void Translator::setSharing(bool sharing) {
+    this->sharing = sharing;
+}
+
+/** setTaggedTLB
+ * Tags TLB entries with the address space they belong to, so switching address spaces no longer flushes them.
+ * Must be set before the first translation.
+ * @param tagged True for an ASID-tagged TLB, false to flush on every switch.
+ */
+void Translator::setTaggedTLB(bool tagged) {
+    this->taggedTLB = tagged;
+    this->asid = tagged ? (u_int64_t)space << ASID_SHIFT : 0;
+}
+
+/** translate
+ * Translates one address from start to finish.
+ * @param address The virtual address.
+ * @param result The translation to be filled.
+ */
+void Translator::translate(const Address &address, Translation &result) {
+    resolve(address, result);
+    if (result.pageFault) {
+        long long loadTime = load(result);
+        faultTime += loadTime;
+        metrics.record(STAGE_STORE_READ, loadTime);
+    }
+    read(result);
+}
+
+/** resolve
+ * Looks the page up in the TLB hierarchy and then the page tables. On a page fault a frame is claimed
+ * (evicting a page if memory is full) and the mapping is installed, but the frame is not filled yet.
+ * This is the part of a translation that must run in trace order.
+ * @param address The virtual address.
+ * @param result The translation to be filled, except for its value.
+ */
+void Translator::resolve(const Address &address, Translation &result) {
+    result.page = address.page;
+    result.offset = address.offset;
+    result.tlbHit = false;
+    result.pageFault = false;
+    result.largePage = false;
+    result.prefetch = nullptr;
+    result.writeBack = -1;
+
+    translations++;
+    writes += address.write;
+    bool timed = (++sampleClock & (METRICS_SAMPLE_INTERVAL - 1)) == 0;
+    std::chrono::steady_clock::time_point stageStart;
+    if (timed)
+        stageStart = std::chrono::steady_clock::now();
+
+    AddressSpaceStats &stats = spaceStats[space];
+    stats.translations++;
+    result.frame = tlb->lookup(address.page | asid, result.largePage);
+    if (result.frame != -1) {
+        result.tlbHit = true;
+        stats.tlbHits++;
+        physicalMemory->touchFrame(result.frame);
+        if (timed)
+            metrics.record(STAGE_TLB_HIT, elapsedSince(stageStart));
+        if (address.write)
+            recordWrite(result);
+        return;
+    }
+    if (timed) {
+        metrics.record(STAGE_TLB_MISS, elapsedSince(stageStart));
+        stageStart = std::chrono::steady_clock::now();
+    }
+
+    walks++;
+    u_int64_t largePage = address.page >> largeShift;
+    int base = largePageTable != nullptr ? largePageTable->getFrame(largePage) : -1;
+    if (base != -1) {
+        largeWalks++;
+        tlb->addLargeEntry(largePage, base);
+        result.largePage = true;
+        result.frame = base + (int)(address.page & largeMask);
+        physicalMemory->touchFrame(result.frame);
+    } else if ((result.frame = pageTable->lookup(address.page)) != -1) {
+        tlb->addEntry(address.page | asid, result.frame);
+        physicalMemory->touchFrame(result.frame);
+    } else {
+        if (timed)
+            metrics.record(STAGE_PAGE_WALK, elapsedSince(stageStart));
+        auto faultStart = std::chrono::steady_clock::now();
+        int shared = sharing ? physicalMemory->findSharedFrame(address.page) : -1;
+        if (shared != -1) {
+            // Another address space already loaded the page, so its frame is mapped instead of read again.
+            result.frame = shared;
+            physicalMemory->shareFrame(shared, space);
+            physicalMemory->touchFrame(shared);
+            pageTable->addEntry(address.page, shared);
+            sharedFaults++;
+            stats.sharedFaults++;
+            long long serviceTime = elapsedSince(faultStart);
+            faultTime += serviceTime;
+            metrics.record(STAGE_FAULT_SERVICE, serviceTime);
+            if (address.write)
+                recordWrite(result);
+            return;
+        }
+        int64_t evictedPage;
+        u_int64_t evictedSpaces;
+        bool evictedDirty;
+        result.pageFault = true;
+        // A page that is written straight away is loaded as a private copy.
+        result.frame = physicalMemory->claimFrame(address.page, space, sharing && !address.write, evictedPage,
+                                                  evictedSpaces, evictedDirty);
+        if (evictedDirty)
+            result.writeBack = evictedPage;
+        if (address.write)
+            physicalMemory->markDirty(result.frame);
+        unmapEvicted(evictedPage, evictedSpaces);
+        pageTable->addEntry(address.page, result.frame);
+        if (largePageTable != nullptr)
+            promote(address.page, result.frame);
+        if (prefetcher != nullptr) {
+            result.prefetch = prefetcher->claim(address.page);
+            prefetch(address.page);
+        }
+        long long serviceTime = elapsedSince(faultStart);
+        faultTime += serviceTime;
+        metrics.record(STAGE_FAULT_SERVICE, serviceTime);
+        return;
+    }
+    if (timed)
+        metrics.record(STAGE_PAGE_WALK, elapsedSince(stageStart));
+    if (address.write)
+        recordWrite(result);
+}
+
+/** unmapEvicted
+ * Makes sure an evicted page is no longer reachable through any translation structure of any address space
+ * that mapped its frame. Unless the TLB is tagged, only the running address space can have it in the TLB.
+ * @param evictedPage The evicted page, or -1 if nothing was evicted.
+ * @param evictedSpaces The mask of address spaces that mapped it.
+ */
+void Translator::unmapEvicted(int64_t evictedPage, u_int64_t evictedSpaces) {
+    if (evictedPage == -1)
+        return;
+    if (largePageTable != nullptr)
+        demote((u_int64_t)evictedPage);
+    for (int s = 0; evictedSpaces >> s != 0; s++) {
+        if (evictedSpaces >> s & 1) {
+            spaces[s]->removeEntry(evictedPage);
+            if (taggedTLB)
+                tlb->removeEntry((u_int64_t)evictedPage | (u_int64_t)s << ASID_SHIFT);
+        }
+    }
+    if (!taggedTLB && (evictedSpaces >> space & 1))
+        tlb->removeEntry(evictedPage);
+}
+
+/** recordWrite
+ * Handles a write to a resident page: a shared frame is copied first, and the frame written to is marked dirty.
+ * @param result The resolved translation, whose frame is updated.
+ */
+void Translator::recordWrite(Translation &result) {
+    if (sharing)
+        copyOnWrite(result);
+    physicalMemory->markDirty(result.frame);
+}
+
+/** copyOnWrite
+ * Handles a write to a resident page: if its frame is shared, the running address space gets a private copy
+ * and its stale TLB entry is dropped, so the next access walks to the new frame.
+ * @param result The resolved translation, whose frame is updated.
+ */
+void Translator::copyOnWrite(Translation &result) {
+    if (!physicalMemory->isShared(result.frame))
+        return;
+    auto copyStart = std::chrono::steady_clock::now();
+    int64_t evictedPage;
+    u_int64_t evictedSpaces;
+    int frame = physicalMemory->copyOnWrite(result.frame, space, evictedPage, evictedSpaces);
+    unmapEvicted(evictedPage, evictedSpaces);
+    if (frame != result.frame) {
+        pageTable->addEntry(result.page, frame);
+        tlb->removeEntry(result.page | asid);
+        result.frame = frame;
+    }
+    cowFaults++;
+    spaceStats[space].cowFaults++;
+    cowTime += elapsedSince(copyStart);
+}
+
+/** promote
+ * Maps a page's whole large page at once if every base page in it is now resident in the matching slot of
+ * one aligned block of frames. The base entries stay in the page table underneath, so demoting only has to
+ * drop the large entry; the base TLB entries are flushed since the large TLB now covers them.
+ * @param page The page that was just loaded.
+ * @param frame The frame it was loaded into.
+ */
+void Translator::promote(u_int64_t page, int frame) {
+    if (largeMask >= (u_int64_t)physicalMemory->getFrameCount() || ((u_int64_t)frame & largeMask) != (page & largeMask))
+        return;
+    u_int64_t first = page & ~largeMask;
+    int base = frame - (int)(page & largeMask);
+    for (u_int64_t i = 0; i <= largeMask; i++) {
+        if (pageTable->getFrame(first + i) != base + (int)i)
+            return;
+    }
+    largePageTable->addEntry(page >> largeShift, base);
+    for (u_int64_t i = 0; i <= largeMask; i++)
+        tlb->removeEntry(first + i);
+    promotions++;
+}
+
+/** demote
+ * Splits the large page holding a page back into base pages, e.g. because the page is being evicted.
+ * @param page The base page.
+ */
+void Translator::demote(u_int64_t page) {
+    if (largePageTable->getFrame(page >> largeShift) == -1)
+        return;
+    largePageTable->removeEntry(page >> largeShift);
+    tlb->removeLargeEntry(page >> largeShift);
+    demotions++;
+}
+
+/** prefetch
+ * Stages the pages the prefetcher predicts after a fault, skipping any that are resident or out of range.
+ * @param page The page that faulted.
+ */
+void Translator::prefetch(u_int64_t page) {
+    predictions.clear();
+    prefetcher->predict(page, predictions);
+    for (u_int64_t predicted : predictions) {
+        if (predicted < pageCount && predicted != page && pageTable->getFrame(predicted) == -1)
+            prefetcher->request(predicted);
+    }
+}
+
+/** load
+ * Writes back the dirty page the fault evicted, if any, then fills the frame claimed by the fault from the
+ * staging buffer if the page was prefetched, or else from the backing store. Safe to call from several threads
+ * as long as they load different frames.
+ * @param result The resolved translation.
+ * @return The time spent loading, in nanoseconds.
+ */
+long long Translator::load(const Translation &result) {
+    auto loadStart = std::chrono::steady_clock::now();
+    if (result.writeBack != -1)
+        physicalMemory->writeBack(result.frame, (u_int64_t)result.writeBack);
+    if (result.prefetch != nullptr &&
+        prefetcher->consume(result.prefetch, physicalMemory->getFrameBuffer(result.frame))) {
+        return elapsedSince(loadStart);
+    }
+    loadPage(result.frame, result.page);
+    return elapsedSince(loadStart);
+}
+
+/** loadPage
+ * Fills a frame with a page from the backing store, copying or aliasing it as the store mode says.
+ * @param frame The frame number.
+ * @param page The page number.
+ */
+void Translator::loadPage(int frame, u_int64_t page) {
+    if (fileProcessor->getStoreMode() == STORE_ALIAS) {
+        physicalMemory->mapFrame(frame, fileProcessor->mapPage(page));
+    } else if (fileProcessor->getStoreMode() == STORE_MMAP) {
+        physicalMemory->fillFrame(frame, fileProcessor->mapPage(page));
+    } else {
+        fileProcessor->getDataFromStore(page, physicalMemory->getFrameBuffer(frame));
+    }
+}
+
+/** read
+ * Fetches the addressed byte out of physical memory.
+ * @param result The resolved translation, whose value is filled in.
+ */
+void Translator::read(Translation &result) {
+    result.value = physicalMemory->getByte(result.frame, result.offset);
+}
+
+/** addFaultTime
+ * Adds fault service time measured outside the translator, e.g. by worker threads.
+ * @param nanoseconds The time to add.
+ */
+void Translator::addFaultTime(long long nanoseconds) {
+    faultTime += nanoseconds;
+}
+
+/** getFaultTime
+ * @return The total time spent servicing page faults, in nanoseconds.
+ */
+long long Translator::getFaultTime() {
+    return faultTime;
+}
+
+/** getTLBHits
+ * @return The number of translations found at any level of the TLB hierarchy.
+ */
+long long Translator::getTLBHits() {
+    return tlb->getHitCount();
+}
+
+/** getLargeTLBHits
+ * @return The number of translations found through a large page TLB entry.
+ */
+long long Translator::getLargeTLBHits() {
+    return tlb->getLargeHitCount();
+}
+
+/** getWalkCount
+ * @return The number of translations that missed every TLB and walked the page tables.
+ */
+long long Translator::getWalkCount() {
+    return walks;
+}
+
+/** getLargeWalkCount
+ * @return The number of page table walks that ended at a large page.
+ */
+long long Translator::getLargeWalkCount() {
+    return largeWalks;
+}
+
+/** getPromotionCount
+ * @return The number of times a group of base pages was promoted to a large page.
+ */
+long long Translator::getPromotionCount() {
+    return promotions;
+}
+
+/** getDemotionCount
+ * @return The number of times a large page was split back into base pages.
+ */
+long long Translator::getDemotionCount() {
+    return demotions;
+}
+
+/** getTranslationCount
+ * @return The number of addresses resolved so far.
+ */
+long long Translator::getTranslationCount() {
+    return translations;
+}
+
+/** getWriteCount
+ * @return The number of addresses resolved so far that were writes.
+ */
+long long Translator::getWriteCount() {
+    return writes;
+}
+
+/** getAddressSpaceCount
+ * @return The number of address spaces.
+ */
+int Translator::getAddressSpaceCount() {
+    return (int)spaces.size();
+}
+
+/** getFaultCount
+ * @return The number of page faults in every address space, including those served by a shared frame.
+ */
+long long Translator::getFaultCount() {
+    long long faults = 0;
+    for (PageTable *table : spaces)
+        faults += table->getFaultCount();
+    return faults;
+}
+
+/** getSwitchCount
+ * @return The number of times the running address space changed.
+ */
+long long Translator::getSwitchCount() {
+    return switches;
+}
+
+/** getFlushedEntryCount
+ * @return The number of valid TLB entries dropped by flushes on address space switches.
+ */
+long long Translator::getFlushedEntryCount() {
+    return flushedEntries;
+}
+
+/** isTLBTagged
+ * @return True if TLB entries are tagged with their address space.
+ */
+bool Translator::isTLBTagged() {
+    return taggedTLB;
+}
+
+/** getAddressSpaceStats
+ * @param space The address space number.
+ * @return What the address space did so far.
+ */
+const AddressSpaceStats &Translator::getAddressSpaceStats(int space) {
+    return spaceStats[space];
+}
+
+/** getPageTable
+ * @param space The address space number.
+ * @return The address space's page table.
+ */
+PageTable *Translator::getPageTable(int space) {
+    return spaces[space];
+}
+
+/** getSharedFaultCount
+ * @return The number of page faults served by mapping a frame another address space had already loaded.
+ */
+long long Translator::getSharedFaultCount() {
+    return sharedFaults;
+}
+
+/** getCopyOnWriteCount
+ * @return The number of writes to a shared frame, whether or not its page had to be copied.
+ */
+long long Translator::getCopyOnWriteCount() {
+    return cowFaults;
+}
+
+/** getCopyOnWriteTime
+ * @return The total time spent on copy-on-write faults, in nanoseconds.
+ */
+long long Translator::getCopyOnWriteTime() {
+    return cowTime;
+}
+
+/** getMetrics
+ * @return The latency histograms recorded by this translator; worker threads merge theirs in.
+ */
+Metrics &Translator::getMetrics() {
+    return metrics;
+}
+
+/** writeMetrics
+ * Writes the counters of every component and the latency histograms as one JSON object.
+ * @param out The stream to write to.
+ */
+void Translator::writeMetrics(std::ostream &out) {
+    out << "{\"translations\": " << translations << ",\n";
+
+    long long tlbLookups = tlb->getHits(0) + tlb->getMisses(0);
+    out << " \"tlb\": {\"lookups\": " << tlbLookups << ", \"hits\": " << tlb->getHitCount()
+        << ", \"misses\": " << tlbLookups - tlb->getHitCount()
+        << ", \"hit_rate\": " << (tlbLookups == 0 ? 0 : (double)tlb->getHitCount() / tlbLookups)
+        << ", \"large_hits\": " << tlb->getLargeHitCount() << ", \"levels\": [";
+    for (int l = 0; l < tlb->getLevelCount(); l++) {
+        long long lookups = tlb->getHits(l) + tlb->getMisses(l);
+        out << (l == 0 ? "" : ", ") << "{\"entries\": " << tlb->getLevel(l)->getSize()
+            << ", \"ways\": " << tlb->getLevel(l)->getWays() << ", \"hits\": " << tlb->getHits(l)
+            << ", \"misses\": " << tlb->getMisses(l)
+            << ", \"hit_rate\": " << (lookups == 0 ? 0 : (double)tlb->getHits(l) / lookups)
+            << ", \"cycles\": " << tlb->getCycles(l) << "}";
+    }
+    out << "]},\n";
+
+    // Page table counters are summed over every address space.
+    long long lookups = 0;
+    size_t memoryBytes = 0;
+    for (PageTable *table : spaces) {
+        lookups += table->getLookupCount();
+        memoryBytes += table->getMemoryUsage();
+    }
+    long long faults = getFaultCount();
+    out << " \"page_table\": {\"type\": \"" << pageTable->getName() << "\", \"walks\": " << walks << ", \"large_walks\": " << largeWalks
+        << ", \"lookups\": " << lookups << ", \"faults\": " << faults
+        << ", \"fault_rate\": " << (lookups == 0 ? 0 : (double)faults / lookups)
+        << ", \"memory_bytes\": " << memoryBytes << "},\n";
+    out << " \"large_pages\": {\"promotions\": " << promotions << ", \"demotions\": " << demotions << "},\n";
+    out << " \"physical_memory\": {\"frames\": " << physicalMemory->getFrameCount()
+        << ", \"frames_used\": " << physicalMemory->getFramesUsed()
+        << ", \"evictions\": " << physicalMemory->getEvictionCount()
+        << ", \"arena_bytes\": " << physicalMemory->getArenaSize()
+        << ", \"huge_pages\": " << (physicalMemory->isHugePageBacked() ? "true" : "false") << "},\n";
+    out << " \"backing_store\": {\"reads\": " << fileProcessor->getReadCount() << "},\n";
+    if (spaces.size() > 1 || sharing) {
+        out << " \"address_spaces\": {\"count\": " << spaces.size() << ", \"switches\": " << switches
+            << ", \"sharing\": " << (sharing ? "true" : "false") << ", \"shared_faults\": " << sharedFaults
+            << ", \"cow_faults\": " << cowFaults << ", \"cow_copies\": " << physicalMemory->getCopyCount()
+            << ", \"cow_ns\": " << cowTime << ", \"shared_frames\": " << physicalMemory->getSharedFrameCount()
+            << ", \"mappings\": " << physicalMemory->getMappingCount()
+            << ", \"frames_saved\": " << physicalMemory->getMappingCount() - physicalMemory->getFramesUsed()
+            << ", \"tagged_tlb\": " << (taggedTLB ? "true" : "false") << ", \"flushed_entries\": " << flushedEntries
+            << ",\n  \"processes\": [";
+        for (size_t s = 0; s < spaces.size(); s++) {
+            const AddressSpaceStats &stats = spaceStats[s];
+            out << (s == 0 ? "" : ",\n   ") << "{\"translations\": " << stats.translations
+                << ", \"tlb_hits\": " << stats.tlbHits
+                << ", \"tlb_hit_rate\": " << (stats.translations == 0 ? 0 : (double)stats.tlbHits / stats.translations)
+                << ", \"faults\": " << spaces[s]->getFaultCount() << ", \"fault_rate\": " << spaces[s]->getFaultRate()
+                << ", \"shared_faults\": " << stats.sharedFaults << ", \"cow_faults\": " << stats.cowFaults
+                << ", \"switches_in\": " << stats.switchesIn << "}";
+        }
+        out << "]},\n";
+    }
+    if (prefetcher != nullptr) {
+        out << " \"prefetch\": {\"predictor\": \"" << prefetcher->getName() << "\", \"faults\": "
+            << prefetcher->getFaultCount() << ", \"issued\": " << prefetcher->getIssueCount()
+            << ", \"useful\": " << prefetcher->getUsefulCount() << ", \"late\": " << prefetcher->getLateCount()
+            << ", \"waits\": " << prefetcher->getWaitCount() << ", \"wait_ns\": " << prefetcher->getWaitTime()
+            << ", \"dropped\": " << prefetcher->getWastedCount() << ", \"accuracy\": " << prefetcher->getAccuracy()
+            << ", \"coverage\": " << prefetcher->getCoverage() << "},\n";
+    }
+    if (flusher != nullptr) {
+        out << " \"write_back\": {\"path\": \"" << flusher->getPath() << "\", \"writes\": " << writes
+            << ", \"dirty_evictions\": " << physicalMemory->getDirtyEvictionCount()
+            << ", \"staged\": " << flusher->getStagedCount() << ", \"pages_written\": " << flusher->getWrittenCount()
+            << ", \"bytes_written\": " << flusher->getBytesWritten() << ", \"batches\": " << flusher->getBatchCount()
+            << ", \"batch_pages\": " << flusher->getBatchPages() << ", \"write_calls\": " << flusher->getWriteCount()
+            << ", \"write_ns\": " << flusher->getWriteTime() << ", \"stage_ns\": " << flusher->getStageTime()
+            << ", \"stalls\": " << flusher->getStallCount() << "},\n";
+    }
+    out << " \"sample_interval\": " << METRICS_SAMPLE_INTERVAL << ",\n";
+    out << " \"latency_ns\": ";
+    metrics.writeJSON(out);
+    out << "}" << std::endl;
+}
+
+/** canCheckpoint
+ * @return True if the translator runs one address space of base pages with no prefetcher or write-back, the
+ * setup whose whole state a checkpoint holds.
+ */
+bool Translator::canCheckpoint() {
+    return largePageTable == nullptr && prefetcher == nullptr && flusher == nullptr && spaces.size() == 1 &&
+           !sharing;
+}
+
+/** saveState
+ * Writes the translator's counters and the state of the TLBs, page table and physical memory. The latency
+ * histograms are not written, so a restored run samples them afresh.
+ * @param out The checkpoint being written.
+ * @return False if the translator is set up in a way checkpoints do not cover.
+ */
+bool Translator::saveState(CheckpointWriter &out) {
+    if (!canCheckpoint())
+        return false;
+    out.beginSection("XLAT");
+    out.put(translations);
+    out.put(faultTime);
+    out.put(walks);
+    out.put(writes);
+    out.put(sampleClock);
+    out.put(spaceStats[0].translations);
+    out.put(spaceStats[0].tlbHits);
+    out.put(fileProcessor->getReadCount());
+    tlb->saveState(out);
+    pageTable->saveState(out);
+    physicalMemory->saveState(out);
+    return true;
+}
+
+/** loadState
+ * Restores what saveState wrote into a translator that has not translated anything yet. Every resident page
+ * is mapped in the page table again and read back into its frame from the backing store.
+ * @param in The checkpoint being read.
+ * @return True if the whole state was restored.
+ */
+bool Translator::loadState(CheckpointReader &in) {
+    if (!canCheckpoint() || translations != 0 || !in.expectSection("XLAT"))
+        return false;
+    translations = (long long)in.get();
+    faultTime = (long long)in.get();
+    walks = (long long)in.get();
+    writes = (long long)in.get();
+    sampleClock = (u_int32_t)in.get();
+    spaceStats[0].translations = (long long)in.get();
+    spaceStats[0].tlbHits = (long long)in.get();
+    u_int64_t reads = in.get();
+    if (!tlb->loadState(in) || !pageTable->loadState(in) || !physicalMemory->loadState(in, translations))
+        return false;
+    for (int frame = 0; frame < physicalMemory->getFrameCount(); frame++) {
+        int64_t page = physicalMemory->getFramePage(frame);
+        if (page == -1)
+            continue;
+        pageTable->addEntry((u_int64_t)page, frame);
+        loadPage(frame, (u_int64_t)page);
+    }
+    fileProcessor->setReadCount(reads);
+    return true;
+}
+
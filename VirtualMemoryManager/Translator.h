@@ -0,0 +1,163 @@
+// Translator.h
+// The Translator class runs one virtual address at a time through the TLB, the page table and physical memory.
+// A translation is split into resolve (every decision that depends on trace order), load (filling a faulted
+// frame from the backing store) and read (fetching the byte), so the last two can run on worker threads.
+// With large pages on, an aligned group of base pages that becomes resident in an aligned block of frames is
+// promoted to one large page, with its own L1 TLB and page table, and demoted again when any of its pages is evicted.
+// With a Prefetcher, every fault also stages the pages its predictor expects next, and a fault on a staged page
+// is filled from the staging buffer.
+// Several address spaces can take turns on one translator, each with its own page table. The TLB is either
+// flushed whenever the running one changes or tagged with address space IDs (ASIDs) so entries survive switches.
+// With sharing on they map the same frame for the same backing store page until one of them writes to it.
+// Writes mark their frame dirty. A dirty page evicted by a fault is written back by load, just before its frame
+// is filled, since with worker threads that is the first point where the frame's old bytes are final.
+// A single address space with base pages only, and no prefetching or write-back, can be saved to a checkpoint
+// and restored into a new translator.
+
+#ifndef VIRTUALMEMORYMANAGER_TRANSLATOR_H
+#define VIRTUALMEMORYMANAGER_TRANSLATOR_H
+
+#include <cstdlib>
+#include <ostream>
+#include <vector>
+
+#include "address.h"
+#include "FileProcessor.h"
+#include "Metrics.h"
+#include "PageTable.h"
+#include "PhysicalMemory.h"
+#include "Prefetcher.h"
+#include "TLBHierarchy.h"
+#include "WriteBackFlusher.h"
+
+class CheckpointWriter;
+class CheckpointReader;
+
+// With an ASID-tagged TLB, TLB keys carry the address space number from this bit up. Page numbers stay below
+// 2^47 and large page keys use bit 63, so the tags never collide with either.
+#define ASID_SHIFT 56
+
+/** Translation
+ * The outcome of translating one address.
+ */
+struct Translation {
+    u_int64_t page;
+    u_int32_t offset;
+    int frame;
+    int value;
+    bool tlbHit;
+    bool pageFault;
+    bool largePage;
+    // The staged copy of a faulted page, or nullptr.
+    PrefetchRequest *prefetch;
+    // The dirty page the fault evicted from the frame, which load writes back first, or -1.
+    int64_t writeBack;
+};
+
+/** AddressSpaceStats
+ * What one address space did. Its page faults are counted by its page table.
+ */
+struct AddressSpaceStats {
+    long long translations;
+    long long tlbHits;
+    long long sharedFaults;
+    long long cowFaults;
+    long long switchesIn;
+};
+
+class Translator {
+public:
+    Translator(FileProcessor *fileProcessor, TLBHierarchy *tlb, PageTable *pageTable, PhysicalMemory *physicalMemory,
+               const Geometry &geometry = Geometry());
+    ~Translator();
+    void setPrefetcher(Prefetcher *prefetcher);
+    int addAddressSpace(PageTable *pageTable);
+    void switchAddressSpace(int space);
+    void setSharing(bool sharing);
+    void setTaggedTLB(bool tagged);
+    void setWriteBack(WriteBackFlusher *flusher);
+    void translate(const Address &address, Translation &result);
+    void resolve(const Address &address, Translation &result);
+    long long load(const Translation &result);
+    void read(Translation &result);
+    void addFaultTime(long long nanoseconds);
+    long long getFaultTime();
+    long long getTLBHits();
+    long long getLargeTLBHits();
+    long long getWalkCount();
+    long long getLargeWalkCount();
+    long long getPromotionCount();
+    long long getDemotionCount();
+    long long getTranslationCount();
+    long long getWriteCount();
+    int getAddressSpaceCount();
+    long long getFaultCount();
+    long long getSwitchCount();
+    long long getFlushedEntryCount();
+    bool isTLBTagged();
+    const AddressSpaceStats &getAddressSpaceStats(int space);
+    PageTable *getPageTable(int space);
+    long long getSharedFaultCount();
+    long long getCopyOnWriteCount();
+    long long getCopyOnWriteTime();
+    Metrics &getMetrics();
+    void writeMetrics(std::ostream &out);
+    bool saveState(CheckpointWriter &out);
+    bool loadState(CheckpointReader &in);
+
+private:
+    FileProcessor *fileProcessor;
+    TLBHierarchy *tlb;
+    PageTable *pageTable;
+    PhysicalMemory *physicalMemory;
+    long long faultTime;
+    long long translations;
+    Metrics metrics;
+    // Counts translations so every METRICS_SAMPLE_INTERVAL-th one has its TLB lookup and page walk timed.
+    u_int32_t sampleClock;
+
+    // Large pages are keyed by page >> largeShift and map to the first frame of their block.
+    // nullptr when large pages are off.
+    PageTable *largePageTable;
+    int largeShift;
+    u_int64_t largeMask;
+    long long walks;
+    long long largeWalks;
+    long long promotions;
+    long long demotions;
+
+    // nullptr when prefetching is off.
+    Prefetcher *prefetcher;
+    std::vector<u_int64_t> predictions;
+    u_int64_t pageCount;
+
+    // nullptr when write-back is off.
+    WriteBackFlusher *flusher;
+    long long writes;
+
+    // Page tables by address space; pageTable is the running one's.
+    std::vector<PageTable *> spaces;
+    std::vector<AddressSpaceStats> spaceStats;
+    int space;
+    bool sharing;
+    long long switches;
+    // The running address space's TLB key tag, 0 unless the TLB is tagged.
+    bool taggedTLB;
+    u_int64_t asid;
+    long long flushedEntries;
+    long long sharedFaults;
+    long long cowFaults;
+    long long cowTime;
+
+    void unmapEvicted(int64_t evictedPage, u_int64_t evictedSpaces);
+    void recordWrite(Translation &result);
+    void copyOnWrite(Translation &result);
+    void promote(u_int64_t page, int frame);
+    void demote(u_int64_t page);
+    void prefetch(u_int64_t page);
+    void loadPage(int frame, u_int64_t page);
+    bool canCheckpoint();
+};
+
+
+#endif //VIRTUALMEMORYMANAGER_TRANSLATOR_H
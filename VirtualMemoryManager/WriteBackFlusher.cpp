@@ -0,0 +1,339 @@
+// WriteBackFlusher.cpp
+// The WriteBackFlusher class writes dirty pages back to a writable copy of the backing store on a background
+// I/O thread.
+
+#include "WriteBackFlusher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Pages gathered into one pwritev; IOV_MAX is at least this on every POSIX system.
+#define WRITEBACK_MAX_IOV 16
+
+/** elapsedSince
+ * @param start A time point taken earlier.
+ * @return The nanoseconds since then.
+ */
+static long long elapsedSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+/** WriteBackFlusher constructor
+ * Copies the backing store to the write-back file and starts the I/O thread.
+ * @param storePath The backing store.
+ * @param copyPath The writable copy, which is replaced if it exists.
+ * @param pageSize The number of bytes in a page.
+ * @param batchPages The number of pages per batch.
+ * @param batches The number of batches that can be filling or waiting to be written at once.
+ */
+WriteBackFlusher::WriteBackFlusher(const std::string &storePath, const std::string &copyPath, u_int32_t pageSize,
+                                   int batchPages, int batches) {
+    this->path = copyPath;
+    this->pageSize = pageSize;
+    this->batchPages = batchPages < 1 ? 1 : batchPages;
+    this->storePages = 0;
+    this->filling = nullptr;
+    this->writing = false;
+    this->stopping = false;
+    this->ioIdle = false;
+    this->staged = 0;
+    this->written = 0;
+    this->bytesWritten = 0;
+    this->batchCount = 0;
+    this->writes = 0;
+    this->writeTime = 0;
+    this->stageTime = 0;
+    this->stalls = 0;
+    copyStore(storePath);
+
+    this->batches.resize(batches < 1 ? 1 : batches);
+    for (Batch &batch : this->batches) {
+        batch.data.resize((size_t)this->batchPages * pageSize);
+        batch.pages.resize(this->batchPages);
+        batch.count = 0;
+        spare.push_back(&batch);
+    }
+    pthread_mutex_init(&lock, nullptr);
+    pthread_cond_init(&queued, nullptr);
+    pthread_cond_init(&freed, nullptr);
+    pthread_create(&ioThread, nullptr, runIO, this);
+}
+
+/** WriteBackFlusher destructor
+ * Writes out every staged page, stops the I/O thread and closes the copy.
+ */
+WriteBackFlusher::~WriteBackFlusher() {
+    drain();
+    pthread_mutex_lock(&lock);
+    stopping = true;
+    pthread_cond_signal(&queued);
+    pthread_mutex_unlock(&lock);
+    pthread_join(ioThread, nullptr);
+    pthread_mutex_destroy(&lock);
+    pthread_cond_destroy(&queued);
+    pthread_cond_destroy(&freed);
+    close(fd);
+}
+
+/** copyStore
+ * Creates the write-back file as a copy of the backing store.
+ * @param storePath The backing store.
+ */
+void WriteBackFlusher::copyStore(const std::string &storePath) {
+    int source = open(storePath.c_str(), O_RDONLY);
+    if (source == -1) {
+        std::cerr << "Error opening file: " << storePath << ". Please place it in the same directory as this program." << std::endl;
+        exit(1);
+    }
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        std::cerr << "Error creating file: " << path << std::endl;
+        exit(1);
+    }
+    std::vector<char> buffer(1024 * 1024);
+    u_int64_t size = 0;
+    ssize_t n;
+    while ((n = read(source, buffer.data(), buffer.size())) > 0) {
+        for (ssize_t done = 0; done < n;) {
+            ssize_t w = write(fd, buffer.data() + done, n - done);
+            if (w <= 0) {
+                std::cerr << "Error writing file: " << path << std::endl;
+                exit(1);
+            }
+            done += w;
+        }
+        size += n;
+    }
+    close(source);
+    if (n < 0 || size < pageSize) {
+        std::cerr << "Error: " << storePath << " could not be copied to " << path << std::endl;
+        exit(1);
+    }
+    storePages = size / pageSize;
+}
+
+/** runIO
+ * Entry point of the I/O thread: writes full batches in the order they filled up, then hands them back.
+ * @param param The WriteBackFlusher.
+ * @return nullptr
+ */
+void *WriteBackFlusher::runIO(void *param) {
+    WriteBackFlusher *owner = (WriteBackFlusher *)param;
+    pthread_mutex_lock(&owner->lock);
+    while (true) {
+        while (owner->queue.empty() && !owner->stopping) {
+            owner->ioIdle = true;
+            pthread_cond_wait(&owner->queued, &owner->lock);
+        }
+        owner->ioIdle = false;
+        if (owner->queue.empty())
+            break;
+        Batch *batch = owner->queue.front();
+        owner->queue.pop_front();
+        owner->writing = true;
+        pthread_mutex_unlock(&owner->lock);
+        owner->writeBatch(batch);
+        pthread_mutex_lock(&owner->lock);
+        batch->count = 0;
+        owner->spare.push_back(batch);
+        owner->writing = false;
+        pthread_cond_broadcast(&owner->freed);
+    }
+    pthread_mutex_unlock(&owner->lock);
+    pthread_exit(nullptr);
+}
+
+/** writeRun
+ * Writes a run of adjacent pages, resuming after short writes.
+ * @param iov The pages, in store order; advanced past whatever is written.
+ * @param count The number of pages.
+ * @param offset Where the first page goes in the copy.
+ * @return True if every byte was written.
+ */
+bool WriteBackFlusher::writeRun(struct iovec *iov, int count, off_t offset) {
+    while (count > 0) {
+        ssize_t n = pwritev(fd, iov, count, offset);
+        if (n <= 0)
+            return false;
+        writes++;
+        offset += n;
+        while (count > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return true;
+}
+
+/** writeBatch
+ * Writes one batch. Pages are sorted by where they go in the store, and when a page was staged more than once
+ * only its latest copy is written. The I/O thread's counters are updated without the lock, and only read once
+ * drain has returned.
+ * @param batch The batch.
+ */
+void WriteBackFlusher::writeBatch(Batch *batch) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<int> order(batch->count);
+    for (int i = 0; i < batch->count; i++)
+        order[i] = i;
+    // Pages past the end of the store wrap around, as they do when they are read.
+    std::vector<u_int64_t> slots(batch->count);
+    for (int i = 0; i < batch->count; i++)
+        slots[i] = batch->pages[i] % storePages;
+    std::sort(order.begin(), order.end(), [&slots](int a, int b) {
+        return slots[a] != slots[b] ? slots[a] < slots[b] : a < b;
+    });
+
+    struct iovec iov[WRITEBACK_MAX_IOV];
+    int runLength = 0;
+    u_int64_t runStart = 0;
+    for (int k = 0; k < batch->count; k++) {
+        int i = order[k];
+        if (k + 1 < batch->count && slots[order[k + 1]] == slots[i])
+            continue;
+        if (runLength > 0 && (slots[i] != runStart + runLength || runLength == WRITEBACK_MAX_IOV)) {
+            if (!writeRun(iov, runLength, (off_t)(runStart * pageSize)))
+                std::cerr << "Error writing file: " << path << std::endl;
+            runLength = 0;
+        }
+        if (runLength == 0)
+            runStart = slots[i];
+        iov[runLength].iov_base = batch->data.data() + (size_t)i * pageSize;
+        iov[runLength].iov_len = pageSize;
+        runLength++;
+        written++;
+        bytesWritten += pageSize;
+    }
+    if (runLength > 0 && !writeRun(iov, runLength, (off_t)(runStart * pageSize)))
+        std::cerr << "Error writing file: " << path << std::endl;
+    batchCount++;
+    writeTime += elapsedSince(start);
+}
+
+/** stage
+ * Copies a dirty page into the batch being filled, and queues the batch for the I/O thread once it is full.
+ * Waits if every batch is full and still waiting to be written. Safe to call from several threads.
+ * @param page The page number.
+ * @param data The page's bytes, pageSize long.
+ */
+void WriteBackFlusher::stage(u_int64_t page, const char *data) {
+    auto start = std::chrono::steady_clock::now();
+    pthread_mutex_lock(&lock);
+    if (filling == nullptr && spare.empty()) {
+        stalls++;
+        while (filling == nullptr && spare.empty())
+            pthread_cond_wait(&freed, &lock);
+    }
+    if (filling == nullptr) {
+        filling = spare.back();
+        spare.pop_back();
+    }
+    int slot = filling->count++;
+    filling->pages[slot] = page;
+    memcpy(filling->data.data() + (size_t)slot * pageSize, data, pageSize);
+    if (filling->count == batchPages) {
+        queue.push_back(filling);
+        filling = nullptr;
+        if (ioIdle)
+            pthread_cond_signal(&queued);
+    }
+    staged++;
+    stageTime += elapsedSince(start);
+    pthread_mutex_unlock(&lock);
+}
+
+/** drain
+ * Queues the partly filled batch and waits until the I/O thread has written everything staged so far.
+ */
+void WriteBackFlusher::drain() {
+    pthread_mutex_lock(&lock);
+    if (filling != nullptr) {
+        queue.push_back(filling);
+        filling = nullptr;
+        pthread_cond_signal(&queued);
+    }
+    while (!queue.empty() || writing)
+        pthread_cond_wait(&freed, &lock);
+    pthread_mutex_unlock(&lock);
+}
+
+/** getPath
+ * @return The path of the writable copy of the backing store.
+ */
+const std::string &WriteBackFlusher::getPath() {
+    return path;
+}
+
+/** getBatchPages
+ * @return The number of pages per batch.
+ */
+int WriteBackFlusher::getBatchPages() {
+    return batchPages;
+}
+
+/** getStagedCount
+ * @return The number of dirty pages handed to the flusher.
+ */
+long long WriteBackFlusher::getStagedCount() {
+    return staged;
+}
+
+/** getWrittenCount
+ * @return The number of pages written, which is fewer than were staged when a page was staged twice in a batch.
+ */
+long long WriteBackFlusher::getWrittenCount() {
+    return written;
+}
+
+/** getBytesWritten
+ * @return The number of bytes written to the copy.
+ */
+long long WriteBackFlusher::getBytesWritten() {
+    return bytesWritten;
+}
+
+/** getBatchCount
+ * @return The number of batches written.
+ */
+long long WriteBackFlusher::getBatchCount() {
+    return batchCount;
+}
+
+/** getWriteCount
+ * @return The number of pwritev calls made.
+ */
+long long WriteBackFlusher::getWriteCount() {
+    return writes;
+}
+
+/** getWriteTime
+ * @return The time the I/O thread spent writing batches, in nanoseconds.
+ */
+long long WriteBackFlusher::getWriteTime() {
+    return writeTime;
+}
+
+/** getStageTime
+ * @return The time callers spent in stage, including stalls, in nanoseconds. This is what write-back adds to
+ * page faults.
+ */
+long long WriteBackFlusher::getStageTime() {
+    return stageTime;
+}
+
+/** getStallCount
+ * @return The number of times stage had to wait for the I/O thread to free a batch.
+ */
+long long WriteBackFlusher::getStallCount() {
+    return stalls;
+}
@@ -0,0 +1,88 @@
+// WriteBackFlusher.h
+// The WriteBackFlusher class writes dirty pages back to a writable copy of the backing store on a background
+// I/O thread. Evicted pages are copied into a batch; each full batch is sorted by store offset, repeated pages
+// are collapsed to their latest copy, and runs of adjacent pages go out in a single pwritev.
+// Page faults keep reading the original backing store. The simulator never changes a page's bytes, so the copy
+// always holds the same data; what the flusher models is the volume and latency of write-back.
+
+#ifndef VIRTUALMEMORYMANAGER_WRITEBACKFLUSHER_H
+#define VIRTUALMEMORYMANAGER_WRITEBACKFLUSHER_H
+
+#include <cstdlib>
+#include <deque>
+#include <pthread.h>
+#include <string>
+#include <sys/uio.h>
+#include <vector>
+
+// Pages per write-back batch.
+#define WRITEBACK_BATCH_PAGES 32
+// Batches that can be filling or waiting to be written at once; staging a page stalls when all of them are.
+#define WRITEBACK_BATCHES 4
+
+class WriteBackFlusher {
+public:
+    WriteBackFlusher(const std::string &storePath, const std::string &copyPath, u_int32_t pageSize,
+                     int batchPages = WRITEBACK_BATCH_PAGES, int batches = WRITEBACK_BATCHES);
+    ~WriteBackFlusher();
+    void stage(u_int64_t page, const char *data);
+    void drain();
+    const std::string &getPath();
+    int getBatchPages();
+    long long getStagedCount();
+    long long getWrittenCount();
+    long long getBytesWritten();
+    long long getBatchCount();
+    long long getWriteCount();
+    long long getWriteTime();
+    long long getStageTime();
+    long long getStallCount();
+
+private:
+    /** Batch
+     * Up to batchPages staged pages, back to back, and the page each one is a copy of.
+     */
+    struct Batch {
+        std::vector<char> data;
+        std::vector<u_int64_t> pages;
+        int count;
+    };
+
+    std::string path;
+    int fd;
+    u_int32_t pageSize;
+    u_int64_t storePages;
+    int batchPages;
+
+    // Shared with the I/O thread and with every thread that stages pages.
+    pthread_mutex_t lock;
+    pthread_cond_t queued;
+    pthread_cond_t freed;
+    std::vector<Batch> batches;
+    // The batch being filled, or nullptr until a page arrives and a spare batch is free.
+    Batch *filling;
+    std::deque<Batch *> queue;
+    std::vector<Batch *> spare;
+    bool writing;
+    bool stopping;
+    // True while the I/O thread sleeps on an empty queue, so a full batch only signals it when it needs waking.
+    bool ioIdle;
+    pthread_t ioThread;
+
+    long long staged;
+    long long written;
+    long long bytesWritten;
+    long long batchCount;
+    long long writes;
+    long long writeTime;
+    long long stageTime;
+    long long stalls;
+
+    void copyStore(const std::string &storePath);
+    void writeBatch(Batch *batch);
+    bool writeRun(struct iovec *iov, int count, off_t offset);
+    static void *runIO(void *param);
+};
+
+
+#endif //VIRTUALMEMORYMANAGER_WRITEBACKFLUSHER_H
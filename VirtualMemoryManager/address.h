@@ -1,23 +1,111 @@
 // address.h
 // Created by Brian Cassriel on 5/7/24.
-// The Address class holds the page and offset of a virtual address.
+// The Address class holds the page and offset of a virtual address, and whether it is written.
+// The Geometry class describes how wide addresses are and how they split into pages.
 
 #ifndef VIRTUALMEMORYMANAGER_ADDRESS_H
 #define VIRTUALMEMORYMANAGER_ADDRESS_H
 
 #include <cstdlib>
 
+// By default virtual addresses are split into a PAGE_BITS page number and an OFFSET_BITS offset.
+#define PAGE_BITS 8
+#define OFFSET_BITS 8
+#define VADDR_SIZE (1 << (PAGE_BITS + OFFSET_BITS))
+#define PAGE_SIZE (1 << OFFSET_BITS)
+#define FRAME_SIZE PAGE_SIZE
+
+// Address widths a Geometry accepts.
+#define MIN_ADDRESS_BITS 16
+#define MAX_ADDRESS_BITS 48
+
+// Frames are allocated one page at a time, so base pages are kept to at most 16 MiB.
+#define MAX_OFFSET_BITS 24
+
 class Address {
 public:
-    u_int8_t page;
-    u_int8_t offset;
+    u_int64_t page;
+    u_int32_t offset;
+    // Set for a write, either by the trace or by vmmgr -w marking a share of accesses as writes.
+    bool write;
 
     /** Address constructor
-     * Initializes the page and offset to 0.
+     * Initializes the page and offset to 0, as a read.
      */
     Address() {
         this->page = 0;
         this->offset = 0;
+        this->write = false;
+    }
+};
+
+class Geometry {
+public:
+    // The number of bits in a virtual address.
+    int addressBits;
+    // The base page size as a power of two.
+    int offsetBits;
+    // The large page size as a power of two, or 0 if large pages are off.
+    int largeBits;
+
+    /** Geometry constructor
+     * @param addressBits The number of bits in a virtual address.
+     * @param offsetBits The base page size as a power of two.
+     * @param largeBits The large page size as a power of two, or 0 for base pages only.
+     */
+    Geometry(int addressBits = PAGE_BITS + OFFSET_BITS, int offsetBits = OFFSET_BITS, int largeBits = 0) {
+        this->addressBits = addressBits;
+        this->offsetBits = offsetBits;
+        this->largeBits = largeBits;
+    }
+
+    /** isValid
+     * @return True if the page sizes fit inside the address and the large page size is a multiple of the base one.
+     */
+    bool isValid() const {
+        if (addressBits < MIN_ADDRESS_BITS || addressBits > MAX_ADDRESS_BITS)
+            return false;
+        if (offsetBits < 1 || offsetBits > MAX_OFFSET_BITS || offsetBits >= addressBits)
+            return false;
+        return largeBits == 0 || (largeBits > offsetBits && largeBits < addressBits);
+    }
+
+    /** getPageBits
+     * @return The number of bits in a base page number.
+     */
+    int getPageBits() const {
+        return addressBits - offsetBits;
+    }
+
+    /** getPageSize
+     * @return The base page size in bytes.
+     */
+    u_int32_t getPageSize() const {
+        return 1u << offsetBits;
+    }
+
+    /** getAddressSpace
+     * @return The number of bytes in the virtual address space.
+     */
+    u_int64_t getAddressSpace() const {
+        return 1ull << addressBits;
+    }
+
+    /** getLargeShift
+     * @return How many bits a base page number is shifted by to get its large page number, 0 if large pages are off.
+     */
+    int getLargeShift() const {
+        return largeBits == 0 ? 0 : largeBits - offsetBits;
+    }
+
+    /** split
+     * Splits a virtual address into its base page and offset.
+     * @param value The virtual address.
+     * @param address The address to be filled.
+     */
+    void split(u_int64_t value, Address &address) const {
+        address.page = value >> offsetBits;
+        address.offset = (u_int32_t)(value & ((1ull << offsetBits) - 1));
     }
 };
 
@@ -0,0 +1,174 @@
+// reusedist.cpp
+// REUSEDIST reads an address trace in one pass and reports its reuse distance profile: the miss ratio of a fully
+// associative LRU TLB or memory of every size, and the average working set for windows of every length.
+// The page stream is measured exactly, or on a hashed sample of pages for traces with huge footprints.
+
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <unistd.h>
+#include <vector>
+
+#include "FileProcessor.h"
+#include "PhysicalMemory.h"
+#include "ReuseDistance.h"
+#include "TLB.h"
+
+/** printUsage
+ * Prints the command line usage.
+ */
+void printUsage() {
+    std::cout << "Usage: ./reusedist [-a address bits] [-p page bits] [-L large page bits] [-R sample rate]\n"
+              << "                   [-o text|csv] <address file>" << std::endl;
+}
+
+/** printCurve
+ * Prints a miss ratio curve at every power of two size up to the footprint, marking the simulator's defaults.
+ * @param out - the stream to print to
+ * @param profile - the reuse distances of the page stream
+ * @param markDefaults - whether the sizes are frames as well as TLB entries
+ */
+void printCurve(std::ostream &out, ReuseDistance &profile, bool markDefaults) {
+    out << "      Size  Miss ratio        Misses" << std::endl;
+    u_int64_t size = 1;
+    while (true) {
+        out << std::setw(10) << size << std::setw(12) << std::fixed << std::setprecision(4)
+            << profile.getMissRatio(size) << std::setw(14) << std::setprecision(0) << profile.getMisses(size);
+        if (size == MAX_TLB_SIZE)
+            out << "  <- default TLB";
+        if (markDefaults && size == NUM_FRAMES)
+            out << "  <- default frames";
+        out << std::endl;
+        if (size >= profile.getDistinctPages() || size >= (1ull << 62))
+            break;
+        size <<= 1;
+    }
+}
+
+/** printWorkingSet
+ * Prints the average working set for every power of two window up to the trace length.
+ * @param out - the stream to print to
+ * @param profile - the reuse distances of the page stream
+ */
+void printWorkingSet(std::ostream &out, ReuseDistance &profile) {
+    out << "    Window       Pages" << std::endl;
+    for (u_int64_t window = 1; window <= profile.getAccessCount(); window <<= 1) {
+        out << std::setw(10) << window << std::setw(12) << std::fixed << std::setprecision(1)
+            << profile.getWorkingSetSize(window) << std::endl;
+    }
+}
+
+/** printCSV
+ * Prints every step of the miss ratio curve and the working set for every power of two window, one per row.
+ * @param out - the stream to print to
+ * @param profile - the reuse distances of the page stream
+ * @param pages - what the pages are called in the rows, "base" or "large"
+ */
+void printCSV(std::ostream &out, ReuseDistance &profile, const char *pages) {
+    std::vector<std::pair<u_int64_t, double>> curve;
+    profile.getCurve(curve);
+    out << std::setprecision(6);
+    for (auto &point : curve)
+        out << "miss_ratio," << pages << "," << point.first << "," << point.second << std::endl;
+    for (u_int64_t window = 1; window <= profile.getAccessCount(); window <<= 1)
+        out << "working_set," << pages << "," << window << "," << profile.getWorkingSetSize(window) << std::endl;
+}
+
+/** main
+ * Profiles the reuse distances of a trace and prints its miss ratio curves and working set sizes.
+ * @param argc - number of arguments
+ * @param argv - array of arguments
+ * @return - 0 if successful, -1 if not
+ */
+int main(int argc, char *argv[]) {
+    Geometry geometry;
+    double sampleRate = 1;
+    bool csv = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "a:p:L:R:o:")) != -1) {
+        if (opt == 'a') {
+            geometry.addressBits = atoi(optarg);
+            continue;
+        }
+        if (opt == 'p') {
+            geometry.offsetBits = atoi(optarg);
+            continue;
+        }
+        if (opt == 'L') {
+            geometry.largeBits = atoi(optarg);
+            continue;
+        }
+        if (opt == 'R' && (sampleRate = atof(optarg)) > 0 && sampleRate <= 1)
+            continue;
+        if (opt == 'o') {
+            if (strcmp(optarg, "text") == 0)
+                csv = false;
+            else if (strcmp(optarg, "csv") == 0)
+                csv = true;
+            else
+                break;
+            continue;
+        }
+        printUsage();
+        return -1;
+    }
+    if (opt != -1 || optind != argc - 1) {
+        printUsage();
+        return -1;
+    }
+    if (!geometry.isValid()) {
+        std::cerr << "Error: need " << MIN_ADDRESS_BITS << " <= address bits <= " << MAX_ADDRESS_BITS
+                  << " and 0 < page bits <= " << MAX_OFFSET_BITS << " below the address bits, with large pages"
+                  << " bigger than base pages." << std::endl;
+        return -1;
+    }
+    std::string filename = argv[optind];
+
+    FileProcessor fileProcessor(filename, STORE_NONE, geometry);
+    ReuseDistance profile(sampleRate);
+    ReuseDistance largeProfile(sampleRate);
+    int largeShift = geometry.getLargeShift();
+    u_int64_t writes = 0;
+    std::vector<Address> batch(TRACE_BATCH_SIZE);
+    int count;
+    while ((count = fileProcessor.readBatch(batch.data(), TRACE_BATCH_SIZE)) > 0) {
+        for (int i = 0; i < count; i++) {
+            profile.access(batch[i].page);
+            if (largeShift > 0)
+                largeProfile.access(batch[i].page >> largeShift);
+            writes += batch[i].write;
+        }
+    }
+    if (count < 0) {
+        std::cerr << "Error reading file: " << filename << std::endl;
+        return -1;
+    }
+
+    if (csv) {
+        std::cout << "kind,pages,size,value" << std::endl;
+        printCSV(std::cout, profile, "base");
+        if (largeShift > 0)
+            printCSV(std::cout, largeProfile, "large");
+        return 0;
+    }
+
+    std::cout << "Trace: " << filename << ", " << profile.getAccessCount() << " addresses (" << writes
+              << " writes)" << std::endl;
+    std::cout << std::fixed << std::setprecision(0) << "Pages: " << profile.getDistinctPages() << " distinct "
+              << geometry.getPageSize() << "-byte pages";
+    if (profile.getSampleRate() < 1)
+        std::cout << " (estimated from " << std::setprecision(4) << profile.getSampleRate() * 100 << "% of pages, "
+                  << profile.getSampledCount() << " addresses)";
+    std::cout << std::endl;
+    std::cout << "Miss ratio by TLB entries or frames (fully associative LRU):" << std::endl;
+    printCurve(std::cout, profile, true);
+    if (largeShift > 0) {
+        std::cout << std::setprecision(0) << "Large pages: " << largeProfile.getDistinctPages() << " distinct "
+                  << (1ull << geometry.largeBits) << "-byte pages" << std::endl;
+        std::cout << "Miss ratio by large page TLB entries (fully associative LRU):" << std::endl;
+        printCurve(std::cout, largeProfile, false);
+    }
+    std::cout << "Average working set by window (addresses):" << std::endl;
+    printWorkingSet(std::cout, profile);
+    return 0;
+}
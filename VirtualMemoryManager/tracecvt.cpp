@@ -0,0 +1,169 @@
+// tracecvt.cpp
+// TRACECVT converts address traces between the text format and the compact binary trace format.
+// A trace with any writes in it is written with access types, so the writes survive the conversion.
+
+#include <cstring>
+#include <iostream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "TraceReader.h"
+#include "TraceWriter.h"
+
+#define CONVERT_BATCH_SIZE 65536
+
+/** printUsage
+ * Prints the command line usage.
+ */
+void printUsage() {
+    std::cout << "Usage: ./tracecvt [-e text|raw|delta|auto] [-a address bits] [-p page bits] <input trace> <output trace>" << std::endl;
+}
+
+/** measureTrace
+ * Makes a pass over a trace to count its addresses and writes and find how many bytes its delta/varint stream
+ * would take, both with and without access types.
+ * @param path The path to the input trace.
+ * @param addressCount The number of addresses in the trace.
+ * @param writeCount The number of them that are writes.
+ * @param deltaBytes The size of the delta/varint address stream in bytes, without access types.
+ * @param packedDeltaBytes The size of the delta/varint address stream in bytes, with access types.
+ */
+void measureTrace(const std::string &path, u_int64_t &addressCount, u_int64_t &writeCount, u_int64_t &deltaBytes,
+                  u_int64_t &packedDeltaBytes) {
+    TraceReader reader(path);
+    std::vector<u_int64_t> addresses(CONVERT_BATCH_SIZE);
+    unsigned char scratch[10];
+    u_int64_t previous = 0;
+    u_int64_t packedPrevious = 0;
+    int count;
+    addressCount = 0;
+    writeCount = 0;
+    deltaBytes = 0;
+    packedDeltaBytes = 0;
+    while ((count = reader.readAddresses(addresses.data(), CONVERT_BATCH_SIZE)) > 0) {
+        for (int i = 0; i < count; i++) {
+            u_int64_t address = addresses[i] & ~TRACE_WRITE_BIT;
+            u_int64_t packed = packAccess(addresses[i]);
+            deltaBytes += writeVarint(zigzagEncode((int64_t)(address - previous)), scratch);
+            packedDeltaBytes += writeVarint(zigzagEncode((int64_t)(packed - packedPrevious)), scratch);
+            writeCount += addresses[i] >> 63;
+            previous = address;
+            packedPrevious = packed;
+        }
+        addressCount += count;
+    }
+}
+
+/** main
+ * Reads a text or binary trace and writes it back out in the requested format.
+ * The trace is measured first; with -e auto the smaller of the raw and delta encodings is chosen.
+ * @param argc - number of arguments
+ * @param argv - array of arguments
+ * @return - 0 if successful, -1 if not
+ */
+int main(int argc, char *argv[]) {
+    const char *encoding = "auto";
+    int addressBits = 0;
+    int pageBits = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "e:a:p:")) != -1) {
+        if (opt == 'e')
+            encoding = optarg;
+        else if (opt == 'a')
+            addressBits = atoi(optarg);
+        else if (opt == 'p')
+            pageBits = atoi(optarg);
+        else {
+            printUsage();
+            return -1;
+        }
+    }
+    if (optind != argc - 2) {
+        printUsage();
+        return -1;
+    }
+    std::string inputPath = argv[optind];
+    std::string outputPath = argv[optind + 1];
+
+    TraceReader reader(inputPath);
+    if (!reader.isOpen()) {
+        std::cerr << "Error opening file: " << inputPath << std::endl;
+        return -1;
+    }
+    if (addressBits == 0)
+        addressBits = reader.isBinary() ? reader.getAddressBits() : 16;
+    if (pageBits == 0)
+        pageBits = reader.isBinary() ? reader.getPageBits() : 8;
+    if (addressBits < 1 || addressBits > 64 || pageBits < 1 || pageBits >= addressBits) {
+        std::cerr << "Error: need 0 < page bits < address bits <= 64." << std::endl;
+        return -1;
+    }
+
+    u_int64_t addressCount;
+    u_int64_t writeCount;
+    u_int64_t deltaBytes;
+    u_int64_t packedDeltaBytes;
+    measureTrace(inputPath, addressCount, writeCount, deltaBytes, packedDeltaBytes);
+    bool accessTypes = writeCount > 0;
+    if (accessTypes && addressBits > 63) {
+        std::cerr << "Error: a trace with writes needs at most 63 address bits." << std::endl;
+        return -1;
+    }
+
+    TraceOutputFormat format;
+    if (strcmp(encoding, "text") == 0) {
+        format = TRACE_OUT_TEXT;
+    } else if (strcmp(encoding, "raw") == 0) {
+        format = TRACE_OUT_RAW;
+    } else if (strcmp(encoding, "delta") == 0) {
+        format = TRACE_OUT_DELTA;
+    } else if (strcmp(encoding, "auto") == 0) {
+        u_int64_t streamBytes = accessTypes ? packedDeltaBytes : deltaBytes;
+        format = streamBytes < addressCount * rawAddressWidth(addressBits + accessTypes) ? TRACE_OUT_DELTA
+                                                                                         : TRACE_OUT_RAW;
+    } else {
+        printUsage();
+        return -1;
+    }
+
+    TraceWriter writer(outputPath, format, addressBits, pageBits, accessTypes);
+    if (!writer.isOpen()) {
+        std::cerr << "Error creating file: " << outputPath << std::endl;
+        return -1;
+    }
+
+    u_int64_t limit = addressBits == 64 ? ~0ull : (1ull << addressBits) - 1;
+    std::vector<u_int64_t> addresses(CONVERT_BATCH_SIZE);
+    int count;
+    while ((count = reader.readAddresses(addresses.data(), CONVERT_BATCH_SIZE)) > 0) {
+        for (int i = 0; i < count; i++) {
+            if ((addresses[i] & ~TRACE_WRITE_BIT) > limit) {
+                std::cerr << "Address out of bounds for " << addressBits << "-bit trace: "
+                          << (addresses[i] & ~TRACE_WRITE_BIT) << std::endl;
+                return -1;
+            }
+        }
+        if (!writer.writeAddresses(addresses.data(), count)) {
+            std::cerr << "Error writing file: " << outputPath << std::endl;
+            return -1;
+        }
+    }
+    if (count < 0 || !writer.close()) {
+        std::cerr << "Error converting " << inputPath << std::endl;
+        return -1;
+    }
+
+    struct stat info;
+    u_int64_t inputBytes = stat(inputPath.c_str(), &info) == 0 ? info.st_size : 0;
+    const char *formatNames[] = {"text", "raw", "delta"};
+    std::cout << "Wrote " << writer.getAddressCount() << " addresses";
+    if (accessTypes)
+        std::cout << " (" << writeCount << " writes)";
+    std::cout << " as " << formatNames[format] << ": "
+            << inputBytes << " -> " << writer.getBytesWritten() << " bytes";
+    if (writer.getBytesWritten() > 0)
+        std::cout << " (" << (double)inputBytes / writer.getBytesWritten() << "x)";
+    std::cout << std::endl;
+    return 0;
+}
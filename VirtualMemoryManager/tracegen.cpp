@@ -0,0 +1,228 @@
+// tracegen.cpp
+// TRACEGEN writes synthetic address traces of any length from a locality model, in the text or the binary trace
+// format, generating and encoding on several threads at once.
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <pthread.h>
+#include <unistd.h>
+#include <vector>
+
+#include "TraceGenerator.h"
+#include "TraceWriter.h"
+
+// The trace is generated in chunks of this many addresses. Every chunk starts its own generator at its first
+// index, so the output depends on the seed but not on the number of threads.
+#define GENERATE_CHUNK_SIZE 65536
+
+/** GenerateWorker
+ * One thread's chunk of the current round and the buffers it is generated and encoded into.
+ */
+struct GenerateWorker {
+    struct GenerateJob *job;
+    int index;
+    pthread_t thread;
+    std::vector<u_int64_t> addresses;
+    std::vector<unsigned char> bytes;
+    int count;
+    size_t length;
+};
+
+/** GenerateJob
+ * What every worker shares: the trace to produce and the barriers that start and end each round.
+ */
+struct GenerateJob {
+    TraceGeneratorConfig config;
+    TraceOutputFormat format;
+    u_int64_t total;
+    // Chunk round * threadCount + index goes to worker index.
+    u_int64_t round;
+    int threadCount;
+    bool stopping;
+    pthread_barrier_t startBarrier;
+    pthread_barrier_t endBarrier;
+    std::vector<GenerateWorker> workers;
+};
+
+/** generateChunk
+ * Generates and encodes a worker's chunk of the current round. A delta trace's first address depends on the
+ * previous chunk, so it is left for the writing thread and only the rest of the chunk is encoded here.
+ * @param job The job.
+ * @param worker The worker.
+ */
+void generateChunk(GenerateJob &job, GenerateWorker &worker) {
+    u_int64_t first = (job.round * job.threadCount + worker.index) * GENERATE_CHUNK_SIZE;
+    worker.count = 0;
+    worker.length = 0;
+    if (first >= job.total)
+        return;
+    worker.count = (int)(job.total - first < GENERATE_CHUNK_SIZE ? job.total - first : GENERATE_CHUNK_SIZE);
+    TraceGenerator generator(job.config, first);
+    generator.generate(worker.addresses.data(), worker.count);
+
+    int skip = job.format == TRACE_OUT_DELTA ? 1 : 0;
+    u_int64_t previous = worker.addresses[0];
+    worker.length = TraceWriter::encodeAddresses(job.format, job.config.geometry.addressBits,
+                                                 worker.addresses.data() + skip, worker.count - skip, previous,
+                                                 worker.bytes.data());
+}
+
+/** runWorker
+ * Entry point of a pool thread: generates one chunk per round until the job stops.
+ * @param param The GenerateWorker this thread runs.
+ * @return nullptr
+ */
+void *runWorker(void *param) {
+    GenerateWorker *worker = (GenerateWorker *)param;
+    GenerateJob *job = worker->job;
+    while (true) {
+        pthread_barrier_wait(&job->startBarrier);
+        if (job->stopping)
+            break;
+        generateChunk(*job, *worker);
+        pthread_barrier_wait(&job->endBarrier);
+    }
+    pthread_exit(nullptr);
+}
+
+/** printUsage
+ * Prints the command line usage.
+ */
+void printUsage() {
+    std::cout << "Usage: ./tracegen [-P sequential|strided|uniform|random|zipf|loop|phase|chase] [-n addresses]\n"
+              << "                  [-a address bits] [-p page bits] [-w working set pages] [-S stride bytes]\n"
+              << "                  [-z zipf exponent] [-l phase length] [-s seed] [-t threads] [-e text|raw|delta]\n"
+              << "                  <output trace>" << std::endl;
+}
+
+/** main
+ * Generates a trace and writes it in the requested format.
+ * @param argc - number of arguments
+ * @param argv - array of arguments
+ * @return - 0 if successful, -1 if not
+ */
+int main(int argc, char *argv[]) {
+    GenerateJob job;
+    job.format = TRACE_OUT_DELTA;
+    job.total = 1000000;
+    job.threadCount = 1;
+    job.stopping = false;
+    job.round = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "P:n:a:p:w:S:z:l:s:t:e:")) != -1) {
+        if (opt == 'P' && parseTracePattern(optarg, job.config.pattern))
+            continue;
+        if (opt == 'n' && (job.total = strtoull(optarg, nullptr, 0)) > 0)
+            continue;
+        if (opt == 'a') {
+            job.config.geometry.addressBits = atoi(optarg);
+            continue;
+        }
+        if (opt == 'p') {
+            job.config.geometry.offsetBits = atoi(optarg);
+            continue;
+        }
+        if (opt == 'w') {
+            job.config.workingSet = strtoull(optarg, nullptr, 0);
+            continue;
+        }
+        if (opt == 'S' && (job.config.stride = strtoull(optarg, nullptr, 0)) > 0)
+            continue;
+        if (opt == 'z' && (job.config.zipfExponent = atof(optarg)) > 0)
+            continue;
+        if (opt == 'l' && (job.config.phaseLength = strtoull(optarg, nullptr, 0)) > 0)
+            continue;
+        if (opt == 's') {
+            job.config.seed = strtoull(optarg, nullptr, 0);
+            continue;
+        }
+        if (opt == 't' && (job.threadCount = atoi(optarg)) > 0)
+            continue;
+        if (opt == 'e') {
+            if (strcmp(optarg, "text") == 0)
+                job.format = TRACE_OUT_TEXT;
+            else if (strcmp(optarg, "raw") == 0)
+                job.format = TRACE_OUT_RAW;
+            else if (strcmp(optarg, "delta") == 0)
+                job.format = TRACE_OUT_DELTA;
+            else
+                break;
+            continue;
+        }
+        printUsage();
+        return -1;
+    }
+    if (opt != -1 || optind != argc - 1) {
+        printUsage();
+        return -1;
+    }
+    if (!job.config.geometry.isValid()) {
+        std::cerr << "Error: need " << MIN_ADDRESS_BITS << " <= address bits <= " << MAX_ADDRESS_BITS
+                  << " and 0 < page bits <= " << MAX_OFFSET_BITS << " below the address bits." << std::endl;
+        return -1;
+    }
+    std::string outputPath = argv[optind];
+
+    TraceWriter writer(outputPath, job.format, job.config.geometry.addressBits, job.config.geometry.offsetBits);
+    if (!writer.isOpen()) {
+        std::cerr << "Error creating file: " << outputPath << std::endl;
+        return -1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    pthread_barrier_init(&job.startBarrier, nullptr, job.threadCount);
+    pthread_barrier_init(&job.endBarrier, nullptr, job.threadCount);
+    job.workers.resize(job.threadCount);
+    for (int i = 0; i < job.threadCount; i++) {
+        job.workers[i].job = &job;
+        job.workers[i].index = i;
+        job.workers[i].addresses.resize(GENERATE_CHUNK_SIZE);
+        job.workers[i].bytes.resize((size_t)GENERATE_CHUNK_SIZE * TRACE_MAX_RECORD);
+    }
+    for (int i = 1; i < job.threadCount; i++)
+        pthread_create(&job.workers[i].thread, nullptr, runWorker, &job.workers[i]);
+
+    // The calling thread generates the first chunk of every round, then writes the round's chunks in order.
+    bool ok = true;
+    u_int64_t chunks = (job.total + GENERATE_CHUNK_SIZE - 1) / GENERATE_CHUNK_SIZE;
+    for (; ok && job.round * job.threadCount < chunks; job.round++) {
+        if (job.threadCount > 1)
+            pthread_barrier_wait(&job.startBarrier);
+        generateChunk(job, job.workers[0]);
+        if (job.threadCount > 1)
+            pthread_barrier_wait(&job.endBarrier);
+        for (GenerateWorker &worker : job.workers) {
+            if (worker.count == 0 || !ok)
+                continue;
+            if (job.format == TRACE_OUT_DELTA) {
+                ok = writer.writeAddresses(worker.addresses.data(), 1) &&
+                     writer.writeEncoded(worker.bytes.data(), worker.length, worker.count - 1,
+                                         worker.addresses[worker.count - 1]);
+            } else {
+                ok = writer.writeEncoded(worker.bytes.data(), worker.length, worker.count,
+                                         worker.addresses[worker.count - 1]);
+            }
+        }
+    }
+
+    job.stopping = true;
+    if (job.threadCount > 1)
+        pthread_barrier_wait(&job.startBarrier);
+    for (int i = 1; i < job.threadCount; i++)
+        pthread_join(job.workers[i].thread, nullptr);
+    pthread_barrier_destroy(&job.startBarrier);
+    pthread_barrier_destroy(&job.endBarrier);
+
+    if (!ok || !writer.close()) {
+        std::cerr << "Error writing file: " << outputPath << std::endl;
+        return -1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const char *formatNames[] = {"text", "raw", "delta"};
+    std::cout << "Wrote " << writer.getAddressCount() << " " << getTracePatternName(job.config.pattern)
+              << " addresses as " << formatNames[job.format] << ": " << writer.getBytesWritten() << " bytes in "
+              << seconds << " s (" << (seconds > 0 ? writer.getBytesWritten() / seconds / 1e6 : 0) << " MB/s)"
+              << std::endl;
+    return 0;
+}
@@ -0,0 +1,878 @@
+// vmmbench.cpp
+// Benchmarks for the VirtualMemoryManager components: isolated TLB and page table lookups, TLB, page table and
+// replacement policy insert/evict churn, fault service, and end-to-end translation over synthetic traces with
+// sequential, uniform random, Zipfian and looping working set patterns, through the Translator and through the
+// engine compiled for the default geometry, along with its batch decode and TLB probe kernels, scalar against
+// vectorized. Every trace comes from the seed, so two runs with the same options measure the same work, and the
+// JSON report can be compared against a later run.
+// Also compares the flat TLB against the original std::map-based implementation on the same page trace.
+
+#include <algorithm>
+#include <cstdint>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unistd.h>
+#include <vector>
+
+#include "BatchKernels.h"
+#include "Benchmark.h"
+#include "FileProcessor.h"
+#include "OutputWriter.h"
+#include "PageTable.h"
+#include "ParallelTranslator.h"
+#include "PhysicalMemory.h"
+#include "TLB.h"
+#include "TLBHierarchy.h"
+#include "TraceGenerator.h"
+#include "TraceWriter.h"
+#include "TranslationEngine.h"
+#include "Translator.h"
+
+// Component benchmarks use 32-bit addresses and 4 KiB pages, so TLBs and page tables see a realistic page space.
+#define WIDE_ADDRESS_BITS 32
+#define WIDE_OFFSET_BITS 12
+// Replacement, fault service and end-to-end benchmarks use vmmgr's default geometry and this many frames,
+// half the pages, so every policy has to evict.
+#define BENCH_FRAMES 128
+#define BENCH_ACCESSES (1 << 20)
+// Pool threads for the parallel end-to-end benchmarks.
+#define BENCH_THREADS 4
+
+/** LegacyTLB
+ * The original two-map TLB, kept here only as a baseline to measure against.
+ * The victim is initialized to the first entry so an all-zero age table can no longer erase an unknown key.
+ */
+class LegacyTLB {
+public:
+    LegacyTLB() {
+        tlbHits = 0;
+    }
+
+    void addEntry(u_int8_t page, u_int8_t frame) {
+        if (tlb.find(page) != tlb.end()) {
+            tlb[page] = frame;
+            for (std::pair<const unsigned char, int> &i : lru) {
+                i.second++;
+            }
+        } else {
+            if (tlb.size() == MAX_TLB_SIZE) {
+                removeLRU();
+                tlb[page] = frame;
+                lru[page] = 0;
+            } else {
+                tlb[page] = frame;
+                for (std::pair<const unsigned char, int> &i : lru) {
+                    i.second++;
+                }
+                lru[page] = 0;
+            }
+        }
+    }
+
+    int getFrame(u_int8_t page) {
+        return tlb[page];
+    }
+
+    bool containsPage(u_int8_t page) {
+        if (tlb.find(page) != tlb.end()) {
+            tlbHits++;
+            return true;
+        }
+        return false;
+    }
+
+    int getHitCount() {
+        return tlbHits;
+    }
+
+private:
+    std::map<u_int8_t, u_int8_t> tlb;
+    std::map<u_int8_t, int> lru;
+    int tlbHits;
+
+    void removeLRU() {
+        int longestSinceUse = -1;
+        u_int8_t oldestPage = lru.begin()->first;
+
+        for (std::pair<const unsigned char, int> currPage : lru) {
+            if (currPage.second > longestSinceUse) {
+                longestSinceUse = currPage.second;
+                oldestPage = currPage.first;
+            }
+        }
+        lru.erase(oldestPage);
+        tlb.erase(oldestPage);
+    }
+};
+
+// Results are added to this so the compiler cannot drop the work being timed.
+volatile long long benchSink = 0;
+
+/** loadPages
+ * Reads the page numbers out of an address file.
+ * @param path The path to the address file.
+ * @param pages The list of pages to be filled.
+ * @return True if the file could be read.
+ */
+bool loadPages(const std::string &path, std::vector<u_int8_t> &pages) {
+    std::ifstream file(path);
+    if (!file.is_open())
+        return false;
+    std::string line;
+    while (getline(file, line)) {
+        pages.push_back((std::stoi(line) >> 8) & 0xFF);
+    }
+    return true;
+}
+
+/** makeLocalityTrace
+ * Builds a synthetic page trace that mostly stays inside a small working set so the TLB sees real hits.
+ * @param length The number of pages to generate.
+ * @param seed The random seed.
+ * @return The page trace.
+ */
+std::vector<u_int8_t> makeLocalityTrace(size_t length, u_int64_t seed) {
+    SplitMix64 rng(seed);
+    std::vector<u_int8_t> pages(length);
+    int base = (int)rng.nextBelow(256);
+    for (size_t i = 0; i < length; i++) {
+        if (rng.nextBelow(100) < 2)
+            base = (int)rng.nextBelow(256);
+        pages[i] = (base + rng.nextBelow(24)) & 0xFF;
+    }
+    return pages;
+}
+
+/** makeTrace
+ * Generates a synthetic address trace.
+ * @param pattern The access pattern.
+ * @param geometry The address layout.
+ * @param count The number of addresses.
+ * @param seed The random seed.
+ * @return The addresses.
+ */
+std::vector<u_int64_t> makeTrace(TracePattern pattern, const Geometry &geometry, int count, u_int64_t seed) {
+    TraceGeneratorConfig config;
+    config.pattern = pattern;
+    config.geometry = geometry;
+    config.seed = seed;
+    TraceGenerator generator(config);
+    std::vector<u_int64_t> addresses(count);
+    generator.generate(addresses.data(), count);
+    return addresses;
+}
+
+/** toPages
+ * @param addresses The addresses.
+ * @param offsetBits The number of offset bits.
+ * @return The page of every address.
+ */
+std::vector<u_int64_t> toPages(const std::vector<u_int64_t> &addresses, int offsetBits) {
+    std::vector<u_int64_t> pages(addresses.size());
+    for (size_t i = 0; i < addresses.size(); i++)
+        pages[i] = addresses[i] >> offsetBits;
+    return pages;
+}
+
+/** replay
+ * Drives a TLB the same way the original vmmgr translation loop did: a hit refreshes the entry,
+ * a page seen before is loaded into the TLB, and a first touch only goes to the page table.
+ * Each iteration replays the whole trace into a new TLB.
+ * @param state The benchmark state.
+ * @param pages The page trace.
+ */
+template <typename T>
+void replay(BenchmarkState &state, const std::vector<u_int8_t> &pages) {
+    int hits = 0;
+    long long sink = 0;
+    while (state.keepRunning()) {
+        T tlb;
+        bool seen[256] = {false};
+        for (u_int8_t page : pages) {
+            if (tlb.containsPage(page)) {
+                int frame = tlb.getFrame(page);
+                tlb.addEntry(page, frame);
+                sink += frame;
+            } else if (seen[page]) {
+                tlb.addEntry(page, page);
+            } else {
+                seen[page] = true;
+            }
+        }
+        hits = tlb.getHitCount();
+    }
+    benchSink += sink;
+    state.setItemsProcessed(state.getIterations() * pages.size());
+    state.setCounter("hit_rate", pages.empty() ? 0 : (double)hits / pages.size());
+}
+
+/** tlbLookups
+ * Isolated lookups that all hit, or all miss, a full TLB.
+ * @param state The benchmark state.
+ * @param pages A page trace; only its low bits are used.
+ * @param hit True to look up resident pages.
+ */
+void tlbLookups(BenchmarkState &state, const std::vector<u_int64_t> &pages, bool hit) {
+    TLB tlb;
+    for (int p = 0; p < tlb.getSize(); p++)
+        tlb.addEntry(p, p);
+    std::vector<u_int64_t> probes(pages.size());
+    for (size_t i = 0; i < pages.size(); i++)
+        probes[i] = hit ? pages[i] % tlb.getSize() : pages[i] | (1ull << 40);
+    long long sink = 0;
+    while (state.keepRunning()) {
+        for (u_int64_t page : probes)
+            sink += tlb.lookup(page);
+    }
+    benchSink += sink;
+    state.setItemsProcessed(state.getIterations() * probes.size());
+    state.setCounter("hit_rate", tlb.getHitRate());
+}
+
+/** tlbChurn
+ * Looks every page up and inserts it on a miss, evicting the set's least recently used entry.
+ * @param state The benchmark state.
+ * @param pages The page trace.
+ * @param size The number of TLB entries.
+ * @param ways The number of entries per set, 0 for fully associative.
+ */
+void tlbChurn(BenchmarkState &state, const std::vector<u_int64_t> &pages, int size, int ways) {
+    TLB tlb(size, ways);
+    while (state.keepRunning()) {
+        for (u_int64_t page : pages) {
+            if (tlb.lookup(page) == -1)
+                tlb.addEntry(page, (u_int32_t)page);
+        }
+    }
+    state.setItemsProcessed(state.getIterations() * pages.size());
+    state.setCounter("hit_rate", tlb.getHitRate());
+}
+
+/** hierarchyChurn
+ * tlbChurn through a two-level TLB hierarchy.
+ * @param state The benchmark state.
+ * @param pages The page trace.
+ * @param levels The levels of the hierarchy.
+ */
+void hierarchyChurn(BenchmarkState &state, const std::vector<u_int64_t> &pages,
+                    const std::vector<TLBLevelConfig> &levels) {
+    TLBHierarchy tlb(levels);
+    bool large;
+    while (state.keepRunning()) {
+        for (u_int64_t page : pages) {
+            if (tlb.lookup(page, large) == -1)
+                tlb.addEntry(page, (u_int32_t)page);
+        }
+    }
+    u_int64_t lookups = state.getIterations() * pages.size();
+    state.setItemsProcessed(lookups);
+    state.setCounter("hit_rate", lookups ? (double)tlb.getHitCount() / lookups : 0);
+    for (int l = 0; l < tlb.getLevelCount(); l++)
+        state.setCounter("l" + std::to_string(l + 1) + "_hits", (double)tlb.getHits(l) / state.getIterations());
+}
+
+/** pageTableLookups
+ * Isolated lookups in a page table that maps every page of the trace, each to a frame of its own.
+ * @param state The benchmark state.
+ * @param pages The page trace.
+ * @param pageBits The number of page number bits.
+ * @param name The page table implementation.
+ * @param levels The number of radix levels.
+ */
+void pageTableLookups(BenchmarkState &state, const std::vector<u_int64_t> &pages, int pageBits,
+                      const std::string &name, int levels) {
+    std::unordered_map<u_int64_t, u_int32_t> frames;
+    for (u_int64_t page : pages)
+        frames.emplace(page, (u_int32_t)frames.size());
+    PageTable *pageTable = createPageTable(name, pageBits, (int)frames.size(), levels);
+    for (auto &mapping : frames)
+        pageTable->addEntry(mapping.first, mapping.second);
+    long long sink = 0;
+    while (state.keepRunning()) {
+        for (u_int64_t page : pages)
+            sink += pageTable->getFrame(page);
+    }
+    benchSink += sink;
+    state.setItemsProcessed(state.getIterations() * pages.size());
+    state.setCounter("memory_kib", pageTable->getMemoryUsage() / 1024.0);
+    delete pageTable;
+}
+
+/** pageTableChurn
+ * Keeps a fixed number of pages mapped: a page that is not mapped is added and the oldest mapped page removed.
+ * @param state The benchmark state.
+ * @param pages The page trace.
+ * @param pageBits The number of page number bits.
+ * @param name The page table implementation.
+ * @param levels The number of radix levels.
+ * @param resident The number of pages kept mapped, which is also the frame count.
+ */
+void pageTableChurn(BenchmarkState &state, const std::vector<u_int64_t> &pages, int pageBits,
+                    const std::string &name, int levels, int resident) {
+    PageTable *pageTable = createPageTable(name, pageBits, resident, levels);
+    std::vector<u_int64_t> mapped(resident);
+    int used = 0;
+    int oldest = 0;
+    while (state.keepRunning()) {
+        for (u_int64_t page : pages) {
+            if (pageTable->getFrame(page) != -1)
+                continue;
+            if (used == resident) {
+                pageTable->removeEntry(mapped[oldest]);
+                pageTable->addEntry(page, oldest);
+                mapped[oldest] = page;
+                oldest = (oldest + 1) % resident;
+            } else {
+                pageTable->addEntry(page, used);
+                mapped[used++] = page;
+            }
+        }
+    }
+    state.setItemsProcessed(state.getIterations() * pages.size());
+    state.setCounter("memory_kib", pageTable->getMemoryUsage() / 1024.0);
+    delete pageTable;
+}
+
+/** policyChurn
+ * Runs a page trace through physical memory alone: resident pages are touched, others claim a frame and
+ * evict through the replacement policy.
+ * @param state The benchmark state.
+ * @param pages The page trace, of pages below 2^PAGE_BITS.
+ * @param policyName The replacement policy.
+ */
+void policyChurn(BenchmarkState &state, const std::vector<u_int64_t> &pages, const std::string &policyName) {
+    PhysicalMemory physicalMemory(BENCH_FRAMES, createReplacementPolicy(policyName, BENCH_FRAMES, ""));
+    std::vector<int> frameOf((size_t)1 << PAGE_BITS, -1);
+    long long faults = 0;
+    while (state.keepRunning()) {
+        for (u_int64_t page : pages) {
+            int frame = frameOf[page];
+            if (frame != -1) {
+                physicalMemory.touchFrame(frame);
+                continue;
+            }
+            int64_t evictedPage;
+            frameOf[page] = physicalMemory.claimFrame(page, evictedPage);
+            if (evictedPage != -1)
+                frameOf[evictedPage] = -1;
+            faults++;
+        }
+    }
+    state.setItemsProcessed(state.getIterations() * pages.size());
+    state.setCounter("fault_rate", (double)faults / (state.getIterations() * pages.size()));
+}
+
+/** hasBackingStore
+ * @return True if BACKING_STORE.bin is in the working directory.
+ */
+bool hasBackingStore() {
+    return access("BACKING_STORE.bin", R_OK) == 0;
+}
+
+/** faultService
+ * Services a fault for every page of a trace: claims a frame, evicting if needed, and fills it from the
+ * backing store, without the TLB or the page table.
+ * @param state The benchmark state.
+ * @param tracePath A trace file, only needed to set up the FileProcessor.
+ * @param pages The page trace.
+ * @param storeMode How the backing store is read.
+ */
+void faultService(BenchmarkState &state, const std::string &tracePath, const std::vector<u_int64_t> &pages,
+                  StoreMode storeMode) {
+    if (!hasBackingStore()) {
+        state.skip("BACKING_STORE.bin not found");
+        return;
+    }
+    FileProcessor fileProcessor(tracePath, storeMode);
+    TLBHierarchy tlb({{MAX_TLB_SIZE, 0, TLB_L1_LATENCY}});
+    RadixPageTable pageTable;
+    PhysicalMemory physicalMemory(BENCH_FRAMES, createReplacementPolicy("fifo", BENCH_FRAMES, ""));
+    Translator translator(&fileProcessor, &tlb, &pageTable, &physicalMemory);
+    Translation result;
+    result.offset = 0;
+    long long sink = 0;
+    while (state.keepRunning()) {
+        for (u_int64_t page : pages) {
+            int64_t evictedPage;
+            result.page = page;
+            result.frame = physicalMemory.claimFrame(page, evictedPage);
+            translator.load(result);
+            translator.read(result);
+            sink += result.value;
+        }
+    }
+    benchSink += sink;
+    state.setItemsProcessed(state.getIterations() * pages.size());
+}
+
+/** batchDecode
+ * Splits raw trace values into pages and offsets a batch at a time with one set of batch kernels.
+ * @param state The benchmark state.
+ * @param addresses The address trace.
+ * @param geometry How the addresses split into pages.
+ * @param kernels The batch kernels.
+ */
+void batchDecode(BenchmarkState &state, const std::vector<u_int64_t> &addresses, const Geometry &geometry,
+                 const BatchKernels &kernels) {
+    std::vector<u_int64_t> pages(TRACE_BATCH_SIZE);
+    std::vector<u_int32_t> offsets(TRACE_BATCH_SIZE);
+    long long sink = 0;
+    while (state.keepRunning()) {
+        for (size_t first = 0; first < addresses.size(); first += TRACE_BATCH_SIZE) {
+            int count = (int)std::min(addresses.size() - first, (size_t)TRACE_BATCH_SIZE);
+            sink += kernels.decode(addresses.data() + first, count, geometry.addressBits, geometry.offsetBits,
+                                   pages.data(), offsets.data());
+            sink += pages[count - 1] + offsets[0];
+        }
+    }
+    benchSink += sink;
+    state.setItemsProcessed(state.getIterations() * addresses.size());
+}
+
+/** batchProbe
+ * Probes a full 64-entry fully associative TLB for BATCH_LANES pages at a time with one set of batch kernels.
+ * The TLB holds pages 0 to 63 and the probes are taken modulo 128, so about half of uniform pages hit.
+ * @param state The benchmark state.
+ * @param pages The page trace.
+ * @param kernels The batch kernels.
+ */
+void batchProbe(BenchmarkState &state, const std::vector<u_int64_t> &pages, const BatchKernels &kernels) {
+    alignas(32) u_int64_t entries[64];
+    for (int e = 0; e < 64; e++)
+        entries[e] = e;
+    std::vector<u_int64_t> probes(pages.size());
+    for (size_t i = 0; i < pages.size(); i++)
+        probes[i] = pages[i] % 128;
+    u_int8_t slots[BATCH_LANES];
+    long long sink = 0;
+    long long hits = 0;
+    while (state.keepRunning()) {
+        hits = 0;
+        for (size_t first = 0; first < probes.size(); first += BATCH_LANES) {
+            int count = (int)std::min(probes.size() - first, (size_t)BATCH_LANES);
+            u_int32_t mask = kernels.probe(entries, 64, probes.data() + first, count, slots);
+            hits += __builtin_popcount(mask);
+            sink += slots[0];
+        }
+    }
+    benchSink += sink;
+    state.setItemsProcessed(state.getIterations() * probes.size());
+    state.setCounter("hit_rate", probes.empty() ? 0 : (double)hits / probes.size());
+}
+
+/** endToEnd
+ * Translates a trace file start to finish the way vmmgr does, formatting every result as text.
+ * Each iteration starts from empty TLBs, page table and memory; rebuilding them is not timed.
+ * @param state The benchmark state.
+ * @param tracePath The trace file.
+ * @param storeMode How the backing store is read.
+ * @param policyName The replacement policy.
+ * @param specialized True to translate through the engine compiled for the default geometry and TLB instead
+ * of the Translator. The engine reports through an OutputWriter, so its text also goes out to /dev/null.
+ * @param vectorized False to run the engine on the scalar batch kernels.
+ */
+void endToEnd(BenchmarkState &state, const std::string &tracePath, StoreMode storeMode,
+              const std::string &policyName, bool specialized = false, bool vectorized = true) {
+    if (!hasBackingStore()) {
+        state.skip("BACKING_STORE.bin not found");
+        return;
+    }
+    int nullFd = specialized ? open("/dev/null", O_WRONLY) : -1;
+    if (specialized && nullFd == -1) {
+        state.skip("/dev/null could not be opened");
+        return;
+    }
+    Address batch[TRACE_BATCH_SIZE];
+    u_int64_t values[TRACE_BATCH_SIZE];
+    char text[OUTPUT_MAX_RECORD];
+    Translation result;
+    long long sink = 0;
+    u_int64_t translations = 0;
+    double tlbHitRate = 0;
+    double faultRate = 0;
+    while (state.keepRunning()) {
+        state.pauseTiming();
+        FileProcessor *fileProcessor = new FileProcessor(tracePath, storeMode);
+        TLBHierarchy *tlb = new TLBHierarchy({{MAX_TLB_SIZE, 0, TLB_L1_LATENCY}});
+        PageTable *pageTable = new RadixPageTable();
+        PhysicalMemory *physicalMemory = new PhysicalMemory(BENCH_FRAMES,
+                                                            createReplacementPolicy(policyName, BENCH_FRAMES, tracePath));
+        Translator *translator = new Translator(fileProcessor, tlb, pageTable, physicalMemory);
+        TranslationEngine *engine = nullptr;
+        OutputWriter *writer = nullptr;
+        if (specialized) {
+            engine = createTranslationEngine(Geometry(), {MAX_TLB_SIZE, 0, TLB_L1_LATENCY}, fileProcessor,
+                                             physicalMemory);
+            engine->setVectorized(vectorized);
+            writer = new OutputWriter(OUTPUT_TEXT, nullFd);
+        }
+        state.resumeTiming();
+
+        int batchSize;
+        if (engine != nullptr) {
+            while ((batchSize = fileProcessor->readRawBatch(values, TRACE_BATCH_SIZE)) > 0)
+                engine->translateBatch(values, batchSize, *writer);
+        }
+        while (engine == nullptr && (batchSize = fileProcessor->readBatch(batch, TRACE_BATCH_SIZE)) > 0) {
+            for (int i = 0; i < batchSize; i++) {
+                translator->translate(batch[i], result);
+                sink += OutputWriter::formatTranslation(OUTPUT_TEXT, result, text);
+            }
+        }
+
+        state.pauseTiming();
+        if (engine != nullptr) {
+            writer->flush();
+            long long misses = engine->getTranslationCount() - engine->getTLBHits();
+            translations += engine->getTranslationCount();
+            tlbHitRate = (double)engine->getTLBHits() / engine->getTranslationCount();
+            faultRate = misses == 0 ? 0 : (double)engine->getFaultCount() / misses;
+        } else {
+            translations += translator->getTranslationCount();
+            tlbHitRate = (double)translator->getTLBHits() / translator->getTranslationCount();
+            faultRate = pageTable->getFaultRate();
+        }
+        delete writer;
+        delete engine;
+        delete translator;
+        delete physicalMemory;
+        delete pageTable;
+        delete tlb;
+        delete fileProcessor;
+        state.resumeTiming();
+    }
+    if (nullFd != -1)
+        close(nullFd);
+    benchSink += sink;
+    state.setItemsProcessed(translations);
+    state.setCounter("tlb_hit_rate", tlbHitRate);
+    state.setCounter("fault_rate", faultRate);
+}
+
+/** parallelEndToEnd
+ * Translates a trace file start to finish through a ParallelTranslator, as vmmgr -t does, with the merged text
+ * going out to /dev/null. Each iteration starts from empty TLBs, page table and memory; rebuilding them, and
+ * starting and stopping the pool, is not timed.
+ * @param state The benchmark state.
+ * @param tracePath The trace file.
+ * @param storeMode How the backing store is read.
+ * @param threadCount The number of pool threads.
+ */
+void parallelEndToEnd(BenchmarkState &state, const std::string &tracePath, StoreMode storeMode, int threadCount) {
+    if (!hasBackingStore()) {
+        state.skip("BACKING_STORE.bin not found");
+        return;
+    }
+    int nullFd = open("/dev/null", O_WRONLY);
+    if (nullFd == -1) {
+        state.skip("/dev/null could not be opened");
+        return;
+    }
+    Address batch[TRACE_BATCH_SIZE];
+    u_int64_t translations = 0;
+    double tlbHitRate = 0;
+    double faultRate = 0;
+    while (state.keepRunning()) {
+        state.pauseTiming();
+        FileProcessor *fileProcessor = new FileProcessor(tracePath, storeMode);
+        TLBHierarchy *tlb = new TLBHierarchy({{MAX_TLB_SIZE, 0, TLB_L1_LATENCY}});
+        PageTable *pageTable = new RadixPageTable();
+        PhysicalMemory *physicalMemory = new PhysicalMemory(BENCH_FRAMES,
+                                                            createReplacementPolicy("lru", BENCH_FRAMES, tracePath));
+        Translator *translator = new Translator(fileProcessor, tlb, pageTable, physicalMemory);
+        ParallelTranslator *parallelTranslator = new ParallelTranslator(translator, OUTPUT_TEXT, BENCH_FRAMES,
+                                                                        threadCount);
+        OutputWriter *writer = new OutputWriter(OUTPUT_TEXT, nullFd);
+        state.resumeTiming();
+
+        int batchSize;
+        while ((batchSize = fileProcessor->readBatch(batch, TRACE_BATCH_SIZE)) > 0)
+            parallelTranslator->translateBatch(batch, batchSize, *writer);
+        writer->flush();
+
+        state.pauseTiming();
+        parallelTranslator->collectMetrics();
+        translations += translator->getTranslationCount();
+        tlbHitRate = (double)translator->getTLBHits() / translator->getTranslationCount();
+        faultRate = pageTable->getFaultRate();
+        delete writer;
+        delete parallelTranslator;
+        delete translator;
+        delete physicalMemory;
+        delete pageTable;
+        delete tlb;
+        delete fileProcessor;
+        state.resumeTiming();
+    }
+    close(nullFd);
+    state.setItemsProcessed(translations);
+    state.setCounter("tlb_hit_rate", tlbHitRate);
+    state.setCounter("fault_rate", faultRate);
+}
+
+/** writeTraceFile
+ * Writes a trace to a new temporary file in the compact binary format.
+ * @param addresses The addresses.
+ * @param geometry The address layout.
+ * @return The file's path, or an empty string if it could not be written.
+ */
+std::string writeTraceFile(const std::vector<u_int64_t> &addresses, const Geometry &geometry) {
+    char path[] = "/tmp/vmmbench-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd == -1)
+        return "";
+    close(fd);
+    TraceWriter writer(path, TRACE_OUT_DELTA, geometry.addressBits, geometry.offsetBits);
+    if (!writer.isOpen() || !writer.writeAddresses(addresses.data(), (int)addresses.size()) || !writer.close()) {
+        unlink(path);
+        return "";
+    }
+    return path;
+}
+
+/** printUsage
+ * Prints the command line usage.
+ */
+void printUsage() {
+    std::cout << "Usage: ./vmmbench [-s seed] [-n accesses] [-m min seconds] [-r repetitions] [-f filter regex]\n"
+              << "                  [-o text|json|csv] [-c baseline json file] [-x threshold percent]\n"
+              << "                  [addresses textfile]" << std::endl;
+}
+
+/** main
+ * Registers and runs the benchmarks.
+ * @param argc - number of arguments
+ * @param argv - array of arguments
+ * @return - 0 if successful, 1 if the comparison found a regression, -1 on a usage error
+ */
+int main(int argc, char *argv[]) {
+    BenchmarkOptions options;
+    u_int64_t seed = 42;
+    int accesses = BENCH_ACCESSES;
+    std::string baselinePath;
+    double threshold = 10;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:n:m:r:f:o:c:x:")) != -1) {
+        if (opt == 's') {
+            seed = strtoull(optarg, nullptr, 0);
+            continue;
+        }
+        if (opt == 'n' && (accesses = atoi(optarg)) > 0)
+            continue;
+        if (opt == 'm' && (options.minTime = atof(optarg)) > 0)
+            continue;
+        if (opt == 'r' && (options.repetitions = atoi(optarg)) > 0)
+            continue;
+        if (opt == 'f') {
+            options.filter = optarg;
+            continue;
+        }
+        if (opt == 'o' && parseBenchmarkFormat(optarg, options.format))
+            continue;
+        if (opt == 'c') {
+            baselinePath = optarg;
+            continue;
+        }
+        if (opt == 'x' && (threshold = atof(optarg)) >= 0)
+            continue;
+        printUsage();
+        return -1;
+    }
+    if (optind < argc - 1) {
+        printUsage();
+        return -1;
+    }
+    std::string addrPath = optind < argc ? argv[optind] : "addresses.txt";
+
+    options.context.emplace_back("seed", std::to_string(seed));
+    options.context.emplace_back("accesses", std::to_string(accesses));
+    options.context.emplace_back("addresses", addrPath);
+    options.context.emplace_back("cpus", std::to_string(sysconf(_SC_NPROCESSORS_ONLN)));
+#ifdef __OPTIMIZE__
+    options.context.emplace_back("optimized", "true");
+#else
+    options.context.emplace_back("optimized", "false");
+#endif
+    BenchmarkRunner runner(options);
+
+    Geometry wide(WIDE_ADDRESS_BITS, WIDE_OFFSET_BITS);
+    int widePageBits = wide.getPageBits();
+    Geometry narrow;
+    std::vector<u_int64_t> widePages[PATTERN_LOOP + 1];
+    std::vector<u_int64_t> narrowAddresses[PATTERN_LOOP + 1];
+    std::vector<u_int64_t> narrowPages[PATTERN_LOOP + 1];
+    std::string tracePaths[PATTERN_LOOP + 1];
+    for (int p = PATTERN_SEQUENTIAL; p <= PATTERN_LOOP; p++) {
+        widePages[p] = toPages(makeTrace((TracePattern)p, wide, accesses, seed), WIDE_OFFSET_BITS);
+        narrowAddresses[p] = makeTrace((TracePattern)p, narrow, accesses, seed);
+        narrowPages[p] = toPages(narrowAddresses[p], OFFSET_BITS);
+    }
+
+    std::vector<u_int8_t> filePages;
+    std::vector<u_int8_t> localityPages = makeLocalityTrace(accesses, seed);
+    bool haveFile = loadPages(addrPath, filePages);
+    for (const char *trace : {"file", "locality"}) {
+        const std::vector<u_int8_t> &pages = trace[0] == 'f' ? filePages : localityPages;
+        bool skip = trace[0] == 'f' && !haveFile;
+        runner.add(std::string("tlb_legacy/replay/") + trace, [&pages, skip, addrPath](BenchmarkState &state) {
+            if (skip)
+                state.skip(addrPath + " not found");
+            else
+                replay<LegacyTLB>(state, pages);
+        });
+        runner.add(std::string("tlb/replay/") + trace, [&pages, skip, addrPath](BenchmarkState &state) {
+            if (skip)
+                state.skip(addrPath + " not found");
+            else
+                replay<TLB>(state, pages);
+        });
+    }
+
+    const std::vector<u_int64_t> &uniformPages = widePages[PATTERN_UNIFORM];
+    runner.add("tlb/lookup/hit", [&uniformPages](BenchmarkState &state) {
+        tlbLookups(state, uniformPages, true);
+    });
+    runner.add("tlb/lookup/miss", [&uniformPages](BenchmarkState &state) {
+        tlbLookups(state, uniformPages, false);
+    });
+    for (int p = PATTERN_SEQUENTIAL; p <= PATTERN_LOOP; p++) {
+        const std::vector<u_int64_t> &pages = widePages[p];
+        std::string pattern = getTracePatternName((TracePattern)p);
+        runner.add("tlb/churn/" + pattern + "/16", [&pages](BenchmarkState &state) {
+            tlbChurn(state, pages, MAX_TLB_SIZE, 0);
+        });
+        runner.add("tlb/churn/" + pattern + "/64:4", [&pages](BenchmarkState &state) {
+            tlbChurn(state, pages, 64, 4);
+        });
+        runner.add("tlb_hierarchy/churn/" + pattern, [&pages](BenchmarkState &state) {
+            hierarchyChurn(state, pages, {{64, 4, TLB_L1_LATENCY}, {1536, 12, TLB_L2_LATENCY}});
+        });
+    }
+
+    for (int p : {PATTERN_UNIFORM, PATTERN_ZIPF}) {
+        const std::vector<u_int64_t> &pages = widePages[p];
+        std::string pattern = getTracePatternName((TracePattern)p);
+        for (int levels = 1; levels <= MAX_PAGE_TABLE_LEVELS; levels++) {
+            runner.add("pagetable/lookup/" + pattern + "/levels:" + std::to_string(levels),
+                       [&pages, widePageBits, levels](BenchmarkState &state) {
+                pageTableLookups(state, pages, widePageBits, "radix", levels);
+            });
+        }
+        for (const char *table : {"direct", "hashed", "inverted"}) {
+            std::string name = table;
+            runner.add("pagetable/lookup/" + pattern + "/" + name, [&pages, widePageBits, name](BenchmarkState &state) {
+                pageTableLookups(state, pages, widePageBits, name, 0);
+            });
+        }
+    }
+    for (int levels = 1; levels <= MAX_PAGE_TABLE_LEVELS; levels++) {
+        runner.add("pagetable/churn/uniform/levels:" + std::to_string(levels),
+                   [&uniformPages, widePageBits, levels](BenchmarkState &state) {
+            pageTableChurn(state, uniformPages, widePageBits, "radix", levels, 4096);
+        });
+    }
+    for (const char *table : {"direct", "hashed", "inverted"}) {
+        std::string name = table;
+        runner.add("pagetable/churn/uniform/" + name, [&uniformPages, widePageBits, name](BenchmarkState &state) {
+            pageTableChurn(state, uniformPages, widePageBits, name, 0, 4096);
+        });
+    }
+
+    const std::vector<u_int64_t> &zipfPages = narrowPages[PATTERN_ZIPF];
+    for (const char *policy : {"fifo", "lru", "clock", "second", "lfu", "arc"}) {
+        std::string policyName = policy;
+        runner.add("policy/churn/zipf/" + policyName, [&zipfPages, policyName](BenchmarkState &state) {
+            policyChurn(state, zipfPages, policyName);
+        });
+    }
+
+    // The scalar kernels are the baseline; the vectorized ones are whatever this CPU runs, "scalar" again on
+    // CPUs without AVX2.
+    for (bool vectorized : {false, true}) {
+        const BatchKernels &kernels = getBatchKernels(vectorized);
+        std::string variant = vectorized ? "vectorized" : "scalar";
+        const std::vector<u_int64_t> &addresses = narrowAddresses[PATTERN_UNIFORM];
+        runner.add("simd/decode/uniform/" + variant, [&addresses, narrow, &kernels](BenchmarkState &state) {
+            batchDecode(state, addresses, narrow, kernels);
+        });
+        runner.add("simd/probe/uniform/" + variant, [&uniformPages, &kernels](BenchmarkState &state) {
+            batchProbe(state, uniformPages, kernels);
+        });
+    }
+
+    for (int p = PATTERN_SEQUENTIAL; p <= PATTERN_LOOP; p++)
+        tracePaths[p] = writeTraceFile(narrowAddresses[p], narrow);
+    const std::string &uniformTrace = tracePaths[PATTERN_UNIFORM];
+    const std::vector<u_int64_t> &narrowUniform = narrowPages[PATTERN_UNIFORM];
+    const char *modeNames[] = {"stream", "mmap", "alias"};
+    for (int mode = STORE_STREAM; mode <= STORE_ALIAS; mode++) {
+        runner.add(std::string("fault/service/") + modeNames[mode],
+                   [&uniformTrace, &narrowUniform, mode](BenchmarkState &state) {
+            faultService(state, uniformTrace, narrowUniform, (StoreMode)mode);
+        });
+    }
+    for (int p = PATTERN_SEQUENTIAL; p <= PATTERN_LOOP; p++) {
+        const std::string &path = tracePaths[p];
+        runner.add(std::string("e2e/translate/") + getTracePatternName((TracePattern)p),
+                   [&path](BenchmarkState &state) {
+            if (path.empty())
+                state.skip("could not write the trace file");
+            else
+                endToEnd(state, path, STORE_MMAP, "lru");
+        });
+        runner.add(std::string("e2e/engine/") + getTracePatternName((TracePattern)p),
+                   [&path](BenchmarkState &state) {
+            if (path.empty())
+                state.skip("could not write the trace file");
+            else
+                endToEnd(state, path, STORE_MMAP, "lru", true);
+        });
+        runner.add(std::string("e2e/engine/") + getTracePatternName((TracePattern)p) + "/scalar",
+                   [&path](BenchmarkState &state) {
+            if (path.empty())
+                state.skip("could not write the trace file");
+            else
+                endToEnd(state, path, STORE_MMAP, "lru", true, false);
+        });
+    }
+    // Every store mode under a pool of threads; alias mode has the workers point frames at the mapping concurrently.
+    for (int mode = STORE_STREAM; mode <= STORE_ALIAS; mode++) {
+        runner.add(std::string("e2e/parallel/uniform/") + modeNames[mode],
+                   [&uniformTrace, mode](BenchmarkState &state) {
+            if (uniformTrace.empty())
+                state.skip("could not write the trace file");
+            else
+                parallelEndToEnd(state, uniformTrace, (StoreMode)mode, BENCH_THREADS);
+        });
+    }
+    runner.add("e2e/translate/zipf/opt", [&tracePaths](BenchmarkState &state) {
+        if (tracePaths[PATTERN_ZIPF].empty())
+            state.skip("could not write the trace file");
+        else
+            endToEnd(state, tracePaths[PATTERN_ZIPF], STORE_MMAP, "opt");
+    });
+
+    int ran = runner.run(std::cout);
+    for (const std::string &path : tracePaths) {
+        if (!path.empty())
+            unlink(path.c_str());
+    }
+    if (ran < 0) {
+        printUsage();
+        return -1;
+    }
+    if (!baselinePath.empty()) {
+        // Machine-readable reports stay alone on stdout, so the comparison goes to stderr with them.
+        std::ostream &report = options.format == BENCHMARK_TEXT ? std::cout : std::cerr;
+        int regressions = runner.compare(baselinePath, threshold, report);
+        if (regressions < 0)
+            return -1;
+        if (regressions > 0)
+            return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,198 @@
+// vmmclient.cpp
+// VMMCLIENT sends a trace to a running translation service (vmmgr -S) in batches, keeping several requests in flight,
+// and reports every translation as vmmgr would along with the round-trip latency of the requests.
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+#include "Metrics.h"
+#include "OutputWriter.h"
+#include "TraceReader.h"
+#include "TranslationServer.h"
+
+// Addresses per request, and requests in flight, unless -b and -d say otherwise.
+#define CLIENT_BATCH_SIZE 4096
+#define CLIENT_DEPTH 8
+
+/** printUsage
+ * Prints the command line usage.
+ */
+void printUsage() {
+    std::cout << "Usage: ./vmmclient [-b addresses per request] [-d requests in flight] [-o text|csv|binary|stats]\n"
+              << "                   <service socket> <address input file>" << std::endl;
+}
+
+/** sendAll
+ * Sends bytes to the service, retrying short and interrupted sends.
+ * @param fd - the socket
+ * @param data - the bytes
+ * @param length - the number of bytes
+ * @return - true if every byte was sent
+ */
+bool sendAll(int fd, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t n = send(fd, data, length, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        data += n;
+        length -= n;
+    }
+    return true;
+}
+
+/** receiveAll
+ * Receives an exact number of bytes from the service, retrying short and interrupted reads.
+ * @param fd - the socket
+ * @param data - where to put the bytes
+ * @param length - the number of bytes
+ * @return - true if every byte arrived before the service closed the connection
+ */
+bool receiveAll(int fd, char *data, size_t length) {
+    while (length > 0) {
+        ssize_t n = read(fd, data, length);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        data += n;
+        length -= n;
+    }
+    return true;
+}
+
+/** main
+ * Translates a trace through the service and prints the results.
+ * @param argc - number of arguments
+ * @param argv - array of arguments
+ * @return - 0 if successful, -1 if not
+ */
+int main(int argc, char *argv[]) {
+    int batchSize = CLIENT_BATCH_SIZE;
+    int depth = CLIENT_DEPTH;
+    OutputMode outputMode = OUTPUT_TEXT;
+    int opt;
+    while ((opt = getopt(argc, argv, "b:d:o:")) != -1) {
+        if (opt == 'b' && (batchSize = atoi(optarg)) > 0 && batchSize <= SERVICE_MAX_ADDRESSES)
+            continue;
+        if (opt == 'd' && (depth = atoi(optarg)) > 0)
+            continue;
+        if (opt == 'o' && parseOutputMode(optarg, outputMode))
+            continue;
+        printUsage();
+        return -1;
+    }
+    if (optind != argc - 2) {
+        printUsage();
+        return -1;
+    }
+    // The service stops reading a client whose unsent responses pass its backlog, and this client only reads
+    // once its requests are all sent, so everything in flight has to fit in the backlog.
+    if ((long long)batchSize * depth * sizeof(OutputRecord) > SERVICE_MAX_BACKLOG) {
+        std::cerr << "Error: -b times -d can be at most " << SERVICE_MAX_BACKLOG / sizeof(OutputRecord)
+                  << " addresses in flight." << std::endl;
+        return -1;
+    }
+    std::string socketPath = argv[optind];
+    std::string filename = argv[optind + 1];
+
+    TraceReader trace(filename);
+    if (!trace.isOpen()) {
+        std::cerr << "Error opening file: " << filename << std::endl;
+        return -1;
+    }
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1 || connect(fd, (sockaddr *)&address, sizeof(address)) == -1) {
+        std::cerr << "Error connecting to " << socketPath << ": " << strerror(errno) << std::endl;
+        return -1;
+    }
+
+    OutputWriter writer(outputMode);
+    // Each request is built in place: its header in the first value, then its addresses.
+    std::vector<u_int64_t> message(batchSize + 1);
+    std::vector<OutputRecord> records(batchSize);
+    std::deque<std::chrono::steady_clock::time_point> inFlight;
+    Histogram roundTrips;
+    long long requests = 0;
+    long long addresses = 0;
+    bool more = true;
+    Translation result;
+    result.prefetch = nullptr;
+    result.writeBack = -1;
+    while (more || !inFlight.empty()) {
+        while (more && (int)inFlight.size() < depth) {
+            int count = trace.readAddresses(message.data() + 1, batchSize);
+            if (count < 0) {
+                std::cerr << "Error reading file: " << filename << std::endl;
+                return -1;
+            }
+            if (count == 0) {
+                more = false;
+                break;
+            }
+            ServiceRequest request = {(u_int32_t)count, 0};
+            memcpy(message.data(), &request, sizeof(request));
+            inFlight.push_back(std::chrono::steady_clock::now());
+            if (!sendAll(fd, (const char *)message.data(), (count + 1) * sizeof(u_int64_t))) {
+                std::cerr << "Error sending to " << socketPath << ": " << strerror(errno) << std::endl;
+                return -1;
+            }
+        }
+        if (inFlight.empty())
+            break;
+
+        ServiceResponse response;
+        if (!receiveAll(fd, (char *)&response, sizeof(response)) || response.count > (u_int32_t)batchSize ||
+            !receiveAll(fd, (char *)records.data(), response.count * sizeof(OutputRecord))) {
+            std::cerr << "Error: " << socketPath << " closed the connection." << std::endl;
+            return -1;
+        }
+        roundTrips.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - inFlight.front()).count());
+        inFlight.pop_front();
+        if (response.status != SERVICE_STATUS_OK) {
+            writer.flush();
+            std::cerr << "Error: request " << requests << (response.status == SERVICE_STATUS_OUT_OF_BOUNDS
+                    ? " has an address out of bounds." : " was rejected.") << std::endl;
+            return -1;
+        }
+        for (u_int32_t i = 0; i < response.count; i++) {
+            const OutputRecord &record = records[i];
+            result.page = record.page;
+            result.offset = record.offset;
+            result.frame = (int)record.frame;
+            result.value = record.value;
+            result.tlbHit = record.flags & OUTPUT_FLAG_TLB_HIT;
+            result.pageFault = record.flags & OUTPUT_FLAG_PAGE_FAULT;
+            result.largePage = record.flags & OUTPUT_FLAG_LARGE_PAGE;
+            writer.writeTranslation(result);
+        }
+        requests++;
+        addresses += response.count;
+    }
+    writer.flush();
+    close(fd);
+
+    // CSV and binary results stay alone on stdout, so the statistics go to stderr in those modes.
+    std::ostream &summary = (outputMode == OUTPUT_CSV || outputMode == OUTPUT_BINARY) ? std::cerr : std::cout;
+    summary << "Requests: " << requests << " (" << addresses << " addresses) in batches of up to " << batchSize
+            << ", " << depth << " in flight";
+    if (roundTrips.getCount() > 0) {
+        summary << "; round trip p50 " << roundTrips.getPercentile(50) << " ns, p99 " << roundTrips.getPercentile(99)
+                << " ns, mean " << (long long)roundTrips.getMean() << " ns";
+    }
+    summary << std::endl;
+    return 0;
+}
@@ -1,13 +1,176 @@
 // vmmgr.cpp
 // Created by Brian Cassriel on 5/5/24.
 // VMMGR simulates how addresses are converted from virtual memory to physical memory.
+// Several traces can be given; each runs as a process in its own address space, taking turns of a fixed
+// number of addresses.
+// A single-trace run can be checkpointed every so many addresses or on SIGUSR2, and restored from a checkpoint
+// to continue where it stopped or to fork another policy from the same warmed-up state.
+// With -S it takes no trace and instead serves translation requests over a Unix domain socket until interrupted.
 
+#include <csignal>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <unistd.h>
+#include <vector>
 
+#include "Checkpoint.h"
 #include "FileProcessor.h"
-#include "TLB.h"
+#include "TLBHierarchy.h"
 #include "PageTable.h"
 #include "PhysicalMemory.h"
+#include "OutputWriter.h"
+#include "ParallelTranslator.h"
+#include "Prefetcher.h"
+#include "TraceGenerator.h"
+#include "TranslationEngine.h"
+#include "TranslationServer.h"
+#include "Translator.h"
+#include "WriteBackFlusher.h"
+
+/** printUsage
+ * Prints the command line usage.
+ */
+void printUsage() {
+    std::cout << "Usage: ./vmmgr [-s stream|mmap|alias] [-f frames] [-r fifo|lru|clock|second|lfu|arc|opt]\n"
+              << "               [-t threads] [-o text|csv|binary|stats] [-a address bits] [-p page bits]\n"
+              << "               [-L large page bits] [-T entries[:ways[:latency]][,entries[:ways[:latency]]]]\n"
+              << "               [-P sequential|stride|markov[:degree]] [-j metrics json file] [-C] [-w write percent]\n"
+              << "               [-q quantum] [-A flush|asid] [-g direct|radix[:levels]|hashed|inverted]\n"
+              << "               [-W write-back file] [-c checkpoint file] [-i checkpoint interval]\n"
+              << "               [-R restore checkpoint file]\n"
+              << "               <address input file> [more address input files]\n"
+              << "   or: ./vmmgr -S service socket [the options above but -t, -q, -C, -w, -c, -i, -R and -r opt]"
+              << std::endl;
+}
+
+// Set by SIGUSR1; the translation loop dumps the metrics between batches when it sees it.
+volatile sig_atomic_t metricsRequested = 0;
+
+/** requestMetrics
+ * SIGUSR1 handler that asks for a metrics dump.
+ * @param signal - the signal number
+ */
+void requestMetrics(int signal) {
+    metricsRequested = 1;
+}
+
+// Set by SIGUSR2; the translation loop writes a checkpoint at the next batch boundary when it sees it.
+volatile sig_atomic_t checkpointRequested = 0;
+
+/** requestCheckpoint
+ * SIGUSR2 handler that asks for a checkpoint.
+ * @param signal - the signal number
+ */
+void requestCheckpoint(int signal) {
+    checkpointRequested = 1;
+}
+
+// Set by SIGINT or SIGTERM in service mode; the service loop stops and reports when it sees it.
+volatile sig_atomic_t stopRequested = 0;
+
+/** requestStop
+ * SIGINT and SIGTERM handler that asks the translation service to stop.
+ * @param signal - the signal number
+ */
+void requestStop(int signal) {
+    stopRequested = 1;
+}
+
+/** dumpMetrics
+ * Writes the translator's counters and latency histograms as JSON.
+ * @param translator - the translator
+ * @param path - the file to write, replacing an earlier dump, or empty for stderr
+ */
+void dumpMetrics(Translator &translator, const std::string &path) {
+    if (path.empty()) {
+        translator.writeMetrics(std::cerr);
+        return;
+    }
+    std::ofstream out(path, std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Error opening file: " << path << std::endl;
+        return;
+    }
+    translator.writeMetrics(out);
+}
+
+/** parseStoreMode
+ * Converts a backing store mode name to a StoreMode.
+ * @param name - the mode name
+ * @param mode - the parsed mode
+ * @return - true if the name is a known mode
+ */
+bool parseStoreMode(const char *name, StoreMode &mode) {
+    if (strcmp(name, "stream") == 0)
+        mode = STORE_STREAM;
+    else if (strcmp(name, "mmap") == 0)
+        mode = STORE_MMAP;
+    else if (strcmp(name, "alias") == 0)
+        mode = STORE_ALIAS;
+    else
+        return false;
+    return true;
+}
+
+/** parsePrefetch
+ * Builds the predictor for a prefetch spec of the form name[:degree].
+ * @param spec - the spec
+ * @return - the predictor, or nullptr if the spec is not valid
+ */
+PrefetchPredictor *parsePrefetch(const char *spec) {
+    std::string name = spec;
+    int degree = PREFETCH_DEGREE;
+    size_t colon = name.find(':');
+    if (colon != std::string::npos) {
+        degree = atoi(name.c_str() + colon + 1);
+        name = name.substr(0, colon);
+    }
+    return createPrefetchPredictor(name, degree);
+}
+
+/** parsePageTable
+ * Splits a page table spec of the form name[:levels].
+ * @param spec - the spec
+ * @param name - the page table name
+ * @param levels - the number of radix levels, or 0 if not given
+ */
+void parsePageTable(const char *spec, std::string &name, int &levels) {
+    name = spec;
+    levels = 0;
+    size_t colon = name.find(':');
+    if (colon != std::string::npos) {
+        levels = atoi(name.c_str() + colon + 1);
+        if (levels < 1)
+            levels = -1;
+        name = name.substr(0, colon);
+    }
+}
+
+/** markWrites
+ * Marks a seeded share of a batch's accesses as writes, on top of any the trace marks itself.
+ * @param batch - the addresses
+ * @param count - the number of addresses
+ * @param random - the trace's random number generator
+ * @param percent - the share of accesses to mark, from 0 to 100
+ */
+void markWrites(Address *batch, int count, SplitMix64 &random, int percent) {
+    for (int i = 0; i < count; i++)
+        batch[i].write |= (int)random.nextBelow(100) < percent;
+}
+
+/** Process
+ * One trace running in its own address space, and the batch of its addresses it is working through.
+ */
+struct Process {
+    std::string path;
+    FileProcessor *trace;
+    SplitMix64 writeRandom;
+    std::vector<Address> batch;
+    int size;
+    int position;
+    bool finished;
+};
 
 /** main
  * Main function that reads in a file of addresses and processes them to simulate virtual memory to physical memory.
@@ -16,46 +179,477 @@
  * @return - 0 if successful, -1 if not
  */
 int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        std::cout << "Usage: ./vmmgr <address input file>" << std::endl;
+    StoreMode storeMode = STORE_MMAP;
+    int frameCount = NUM_FRAMES;
+    std::string policyName = "lru";
+    int threadCount = 1;
+    OutputMode outputMode = OUTPUT_TEXT;
+    Geometry geometry;
+    std::vector<TLBLevelConfig> tlbLevels = {{MAX_TLB_SIZE, 0, TLB_L1_LATENCY}};
+    bool tlbStats = false;
+    std::string metricsPath;
+    PrefetchPredictor *predictor = nullptr;
+    bool sharing = false;
+    int writePercent = 0;
+    int quantum = TRACE_BATCH_SIZE;
+    bool taggedTLB = false;
+    std::string pageTableName = "radix";
+    int pageTableLevels = 0;
+    bool pageTableStats = false;
+    std::string writeBackPath;
+    std::string checkpointPath;
+    long long checkpointInterval = 0;
+    std::string restorePath;
+    std::string socketPath;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:f:r:t:o:a:p:L:T:j:P:Cw:q:A:g:W:c:i:R:S:")) != -1) {
+        if (opt == 's' && parseStoreMode(optarg, storeMode))
+            continue;
+        if (opt == 'f' && (frameCount = atoi(optarg)) > 0)
+            continue;
+        if (opt == 'a') {
+            geometry.addressBits = atoi(optarg);
+            continue;
+        }
+        if (opt == 'p') {
+            geometry.offsetBits = atoi(optarg);
+            continue;
+        }
+        if (opt == 'L') {
+            geometry.largeBits = atoi(optarg);
+            continue;
+        }
+        if (opt == 'j') {
+            metricsPath = optarg;
+            continue;
+        }
+        if (opt == 'W') {
+            writeBackPath = optarg;
+            continue;
+        }
+        if (opt == 'c') {
+            checkpointPath = optarg;
+            continue;
+        }
+        if (opt == 'i' && (checkpointInterval = atoll(optarg)) > 0)
+            continue;
+        if (opt == 'R') {
+            restorePath = optarg;
+            continue;
+        }
+        if (opt == 'S') {
+            socketPath = optarg;
+            continue;
+        }
+        if (opt == 'P') {
+            delete predictor;
+            if ((predictor = parsePrefetch(optarg)) != nullptr)
+                continue;
+        }
+        if (opt == 'C') {
+            sharing = true;
+            continue;
+        }
+        if (opt == 'w' && (writePercent = atoi(optarg)) >= 0 && writePercent <= 100)
+            continue;
+        if (opt == 'q' && (quantum = atoi(optarg)) > 0)
+            continue;
+        if (opt == 'g') {
+            parsePageTable(optarg, pageTableName, pageTableLevels);
+            pageTableStats = true;
+            continue;
+        }
+        if (opt == 'A' && (strcmp(optarg, "flush") == 0 || strcmp(optarg, "asid") == 0)) {
+            taggedTLB = strcmp(optarg, "asid") == 0;
+            continue;
+        }
+        if (opt == 'T' && parseTLBLevels(optarg, tlbLevels)) {
+            tlbStats = true;
+            continue;
+        }
+        if (opt == 'o' && parseOutputMode(optarg, outputMode))
+            continue;
+        if (opt == 't' && (threadCount = atoi(optarg)) > 0)
+            continue;
+        if (opt == 'r') {
+            policyName = optarg;
+            continue;
+        }
+        printUsage();
+        return -1;
+    }
+    int traceCount = argc - optind;
+    bool serving = !socketPath.empty();
+    if ((traceCount < 1 && !serving) || traceCount > MAX_ADDRESS_SPACES || !geometry.isValid() ||
+        (checkpointInterval > 0 && checkpointPath.empty())) {
+        printUsage();
+        return -1;
+    }
+    if (traceCount > 1 && (threadCount > 1 || geometry.largeBits > 0 || predictor != nullptr || policyName == "opt")) {
+        std::cerr << "Several traces need -t 1 and cannot be combined with -L, -P or -r opt." << std::endl;
+        return -1;
+    }
+    bool checkpoints = !checkpointPath.empty() || !restorePath.empty();
+    if (checkpoints && (traceCount > 1 || threadCount > 1 || geometry.largeBits > 0 || predictor != nullptr || sharing ||
+                        !writeBackPath.empty())) {
+        std::cerr << "Checkpoints need one trace and -t 1, and cannot be combined with -L, -P, -C or -W." << std::endl;
+        return -1;
+    }
+    if (serving && (traceCount > 0 || threadCount > 1 || sharing || writePercent > 0 || checkpoints ||
+                    policyName == "opt")) {
+        std::cerr << "Service mode takes no traces, needs -t 1, and cannot be combined with -C, -w, -c, -R or -r opt."
+                  << std::endl;
+        return -1;
+    }
+    std::string filename = serving ? "" : argv[optind];
+    // A restore must run under the options the checkpoint was taken with, apart from the replacement policy and
+    // page table, which can differ to fork a new experiment.
+    CheckpointReader restoreReader;
+    CheckpointInfo restored;
+    if (!restorePath.empty()) {
+        if (!restoreReader.readFile(restorePath) || !readCheckpointInfo(restoreReader, restored)) {
+            std::cerr << "Error reading checkpoint: " << restorePath << std::endl;
+            return -1;
+        }
+        bool sameTLB = restored.tlbLevels.size() == tlbLevels.size();
+        std::string tlbSpec;
+        for (size_t l = 0; l < restored.tlbLevels.size(); l++) {
+            const TLBLevelConfig &level = restored.tlbLevels[l];
+            sameTLB = sameTLB && level.size == tlbLevels[l].size && level.ways == tlbLevels[l].ways;
+            tlbSpec += (l > 0 ? "," : "") + std::to_string(level.size) + ":" + std::to_string(level.ways);
+        }
+        if (restored.geometry.addressBits != geometry.addressBits ||
+            restored.geometry.offsetBits != geometry.offsetBits || restored.frameCount != frameCount || !sameTLB) {
+            std::cerr << "Error: " << restorePath << " was taken with -a " << restored.geometry.addressBits << " -p "
+                      << restored.geometry.offsetBits << " -f " << restored.frameCount << " -T " << tlbSpec
+                      << "; restore it with the same options." << std::endl;
+            return -1;
+        }
+        if (restored.traceSize != getFileSize(filename)) {
+            std::cerr << "Error: " << restorePath << " was taken on a different trace than " << filename << std::endl;
+            return -1;
+        }
+    }
+    if (predictor != nullptr && storeMode == STORE_ALIAS) {
+        std::cerr << "Prefetching needs -s stream or -s mmap: aliased frames never read the backing store." << std::endl;
+        return -1;
+    }
+    PageTable *pageTable = createPageTable(pageTableName, geometry.getPageBits(), frameCount, pageTableLevels);
+    if (pageTable == nullptr) {
+        std::cerr << "Unknown page table, or a direct table or radix level for more than " << DIRECT_MAX_PAGE_BITS
+                  << " page bits: " << pageTableName << std::endl;
+        return -1;
+    }
+    ReplacementPolicy *policy = createReplacementPolicy(policyName, frameCount, filename, geometry.offsetBits);
+    if (policy == nullptr) {
+        delete pageTable;
+        printUsage();
         return -1;
     }
-    std::string filename = argv[1];
 
-    std::vector<Address *> addrList;
-    FileProcessor *fileProcessor = new FileProcessor(filename);
-    TLB *tlb = new TLB();
-    PageTable *pageTable = new PageTable();
-    PhysicalMemory *physicalMemory = new PhysicalMemory(NUM_FRAMES);
-    u_int8_t currFrame;
+    Address batch[TRACE_BATCH_SIZE];
+    int batchSize;
+    FileProcessor *fileProcessor = new FileProcessor(filename, storeMode, geometry);
+    TLBHierarchy *tlb = new TLBHierarchy(tlbLevels, geometry.getLargeShift());
+    PhysicalMemory *physicalMemory = new PhysicalMemory(frameCount, policy, geometry.getPageSize(), geometry.getLargeShift());
+    Translator translator(fileProcessor, tlb, pageTable, physicalMemory, geometry);
+    translator.setSharing(sharing);
+    translator.setTaggedTLB(taggedTLB);
+    // Every trace after the first gets its own address space; the first trace's FileProcessor also serves
+    // the backing store for all of them.
+    std::vector<Process> processes;
+    std::vector<PageTable *> pageTables = {pageTable};
+    for (int i = 0; i < traceCount; i++) {
+        FileProcessor *trace = fileProcessor;
+        if (i > 0) {
+            trace = new FileProcessor(argv[optind + i], storeMode, geometry);
+            pageTables.push_back(createPageTable(pageTableName, geometry.getPageBits(), frameCount, pageTableLevels));
+            translator.addAddressSpace(pageTables.back());
+        }
+        processes.push_back({argv[optind + i], trace, SplitMix64(i), std::vector<Address>(TRACE_BATCH_SIZE), 0, 0,
+                             false});
+    }
+    Prefetcher *prefetcher = nullptr;
+    if (predictor != nullptr) {
+        prefetcher = new Prefetcher(fileProcessor, predictor, geometry.getPageSize());
+        translator.setPrefetcher(prefetcher);
+    }
+    WriteBackFlusher *flusher = nullptr;
+    if (!writeBackPath.empty()) {
+        flusher = new WriteBackFlusher("BACKING_STORE.bin", writeBackPath, geometry.getPageSize());
+        translator.setWriteBack(flusher);
+    }
+    OutputWriter writer(outputMode);
+    // A run that needs nothing but one TLB level, a page table and physical memory goes through the engine
+    // compiled for its geometry, if there is one.
+    TranslationEngine *engine = nullptr;
+    if (traceCount == 1 && threadCount == 1 && tlbLevels.size() == 1 && predictor == nullptr && !sharing &&
+        flusher == nullptr && metricsPath.empty() && !pageTableStats && !checkpoints)
+        engine = createTranslationEngine(geometry, tlbLevels[0], fileProcessor, physicalMemory);
 
-    fileProcessor->processFile(addrList);
-    for (Address* &currAddress : addrList) {
-        std::cout << "Translating " << (int)currAddress->page << " " << (int)currAddress->offset << "... | ";
+    TranslationServer *server = nullptr;
+    if (serving) {
+        server = new TranslationServer(&translator, geometry);
+        if (!server->start(socketPath)) {
+            delete server;
+            return -1;
+        }
+    }
 
-        if (tlb->containsPage(currAddress->page)) {
-            currFrame = tlb->getFrame(currAddress->page);
-            tlb->addEntry(currAddress->page, currFrame);
-        } else if (pageTable->containsPage(currAddress->page)) {
-            currFrame = pageTable->getFrame(currAddress->page);
-            tlb->addEntry(currAddress->page, currFrame);
-        } else {
-            char *data = new char[FRAME_SIZE];
-            fileProcessor->getDataFromStore(currAddress->page, data);
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = requestMetrics;
+    sigaction(SIGUSR1, &action, nullptr);
+    if (!checkpointPath.empty()) {
+        action.sa_handler = requestCheckpoint;
+        sigaction(SIGUSR2, &action, nullptr);
+    }
+    if (serving) {
+        action.sa_handler = requestStop;
+        sigaction(SIGINT, &action, nullptr);
+        sigaction(SIGTERM, &action, nullptr);
+    }
 
-            currFrame = physicalMemory->addOrFindFrame(currAddress->page, data);
-            pageTable->addEntry(currAddress->page, currFrame);
+    CheckpointInfo checkpoint = {geometry, frameCount, tlbLevels, policyName, pageTableName, getFileSize(filename), 0};
+    int checkpointsWritten = 0;
+    long long nextCheckpoint = checkpointInterval;
+    if (!restorePath.empty()) {
+        if (fileProcessor->skipAddresses(restored.position) != restored.position ||
+            !restoreCheckpoint(restoreReader, translator)) {
+            std::cerr << "Error restoring checkpoint: " << restorePath << std::endl;
+            return -1;
         }
+        processes[0].writeRandom.skip(restored.position);
+        nextCheckpoint += translator.getTranslationCount();
+        std::cerr << "Restored " << restorePath << " after " << restored.position << " addresses";
+        if (restored.policyName != policyName)
+            std::cerr << ", forked from " << restored.policyName << " to " << policyName;
+        if (restored.pageTableName != pageTableName)
+            std::cerr << ", page table " << restored.pageTableName << " to " << pageTableName;
+        std::cerr << std::endl;
+    }
 
-        std::cout << "Frame number: " << (int)currFrame << " " << (int)currAddress->offset
-                << " | Byte: " << physicalMemory->getByte(currFrame, currAddress->offset) << std::endl;
+    if (server != nullptr) {
+        // The signals stay blocked except while the server waits for events, so none is missed between checks.
+        sigset_t blocked;
+        sigset_t waitMask;
+        sigemptyset(&blocked);
+        sigaddset(&blocked, SIGINT);
+        sigaddset(&blocked, SIGTERM);
+        sigaddset(&blocked, SIGUSR1);
+        sigprocmask(SIG_BLOCK, &blocked, &waitMask);
+        std::cerr << "Serving on " << socketPath << std::endl;
+        while (!stopRequested && server->serve(&waitMask)) {
+            if (metricsRequested) {
+                metricsRequested = 0;
+                dumpMetrics(translator, metricsPath);
+            }
+        }
+        sigprocmask(SIG_SETMASK, &waitMask, nullptr);
+    } else if (engine != nullptr) {
+        // The engine decodes the raw values itself, a whole batch at a time.
+        u_int64_t values[TRACE_BATCH_SIZE];
+        while ((batchSize = fileProcessor->readRawBatch(values, TRACE_BATCH_SIZE)) > 0) {
+            engine->translateBatch(values, batchSize, writer);
+            if (metricsRequested) {
+                metricsRequested = 0;
+                engine->writeMetrics(std::cerr);
+            }
+        }
+    } else if (threadCount == 1) {
+        Translation result;
+        // The processes take turns of up to quantum addresses each until every one of them has run out.
+        int running = traceCount;
+        for (int space = 0; running > 0; space = (space + 1) % traceCount) {
+            Process &process = processes[space];
+            for (int budget = quantum; budget > 0 && !process.finished;) {
+                if (process.position == process.size) {
+                    // Between batches every address read so far has been translated, so the trace position is the
+                    // translation count.
+                    if (!checkpointPath.empty() && (checkpointRequested ||
+                        (checkpointInterval > 0 && translator.getTranslationCount() >= nextCheckpoint))) {
+                        checkpointRequested = 0;
+                        checkpoint.position = translator.getTranslationCount();
+                        if (writeCheckpoint(checkpointPath, checkpoint, translator))
+                            checkpointsWritten++;
+                        else
+                            std::cerr << "Error writing checkpoint: " << checkpointPath << std::endl;
+                        nextCheckpoint = translator.getTranslationCount() + checkpointInterval;
+                    }
+                    process.size = process.trace->readBatch(process.batch.data(), TRACE_BATCH_SIZE);
+                    process.position = 0;
+                    if (process.size <= 0) {
+                        process.finished = true;
+                        running--;
+                        break;
+                    }
+                    if (writePercent > 0)
+                        markWrites(process.batch.data(), process.size, process.writeRandom, writePercent);
+                }
+                translator.switchAddressSpace(space);
+                int end = process.size - process.position < budget ? process.size : process.position + budget;
+                budget -= end - process.position;
+                for (; process.position < end; process.position++) {
+                    translator.translate(process.batch[process.position], result);
+                    writer.writeTranslation(result);
+                }
+            }
+            if (metricsRequested) {
+                metricsRequested = 0;
+                dumpMetrics(translator, metricsPath);
+            }
+        }
+    } else {
+        ParallelTranslator parallelTranslator(&translator, outputMode, frameCount, threadCount);
+        while ((batchSize = fileProcessor->readBatch(batch, TRACE_BATCH_SIZE)) > 0) {
+            if (writePercent > 0)
+                markWrites(batch, batchSize, processes[0].writeRandom, writePercent);
+            parallelTranslator.translateBatch(batch, batchSize, writer);
+            if (metricsRequested) {
+                metricsRequested = 0;
+                parallelTranslator.collectMetrics();
+                dumpMetrics(translator, metricsPath);
+            }
+        }
+        parallelTranslator.collectMetrics();
     }
+    writer.flush();
+    // Dirty pages still resident at the end are written back too, as an orderly shutdown would.
+    int syncedPages = 0;
+    if (flusher != nullptr) {
+        syncedPages = physicalMemory->syncDirtyFrames();
+        flusher->drain();
+    }
+    if (!metricsPath.empty())
+        dumpMetrics(translator, metricsPath);
+
+    // CSV and binary results stay alone on stdout, so the statistics go to stderr in those modes.
+    std::ostream &summary = (outputMode == OUTPUT_CSV || outputMode == OUTPUT_BINARY) ? std::cerr : std::cout;
 
-    std::cout << "Page fault rate: " << pageTable->getFaultRate() << std::endl;
-    std::cout << "TLB hit rate: " << tlb->getHitRate() << std::endl;
+    long long faults = engine != nullptr ? engine->getFaultCount() : translator.getFaultCount();
+    long long tlbHits = engine != nullptr ? engine->getTLBHits() : translator.getTLBHits();
+    summary << "Page fault rate: " << faults << std::endl;
+    summary << "TLB hit rate: " << tlbHits << std::endl;
+    summary << "Page replacements: " << physicalMemory->getEvictionCount() << " (" << policy->getName()
+            << ", " << frameCount << " frames)" << std::endl;
+    if (faults > 0) {
+        const char *modeNames[] = {"stream", "mmap", "alias"};
+        long long faultTime = engine != nullptr ? engine->getFaultTime() : translator.getFaultTime();
+        summary << "Fault service latency: " << faultTime / faults << " ns/fault (" << modeNames[storeMode] << ")"
+                << std::endl;
+    }
+    if (pageTableStats) {
+        size_t memoryBytes = 0;
+        for (PageTable *table : pageTables)
+            memoryBytes += table->getMemoryUsage();
+        const Histogram &walks = translator.getMetrics().getHistogram(STAGE_PAGE_WALK);
+        summary << "Page table: " << pageTable->getName() << ", " << memoryBytes << " bytes";
+        if (traceCount > 1)
+            summary << " over " << traceCount << " address spaces";
+        if (walks.getCount() > 0) {
+            summary << ", " << walks.getMean() << " ns/walk (p99 " << walks.getPercentile(99) << " ns, 1 in "
+                    << METRICS_SAMPLE_INTERVAL << " sampled)";
+        }
+        summary << std::endl;
+    }
+    if (tlbStats && engine != nullptr) {
+        // The engine has a single TLB level and walks the page table on every miss.
+        long long accesses = engine->getTranslationCount();
+        long long tlbCycles = accesses * tlbLevels[0].latency;
+        long long walkCycles = (accesses - tlbHits) * TLB_WALK_LATENCY;
+        summary << "TLB L1: " << tlbHits << " hits, " << accesses - tlbHits << " misses, " << tlbCycles
+                << " cycles (" << engine->getTLBSize() << " entries, " << engine->getTLBWays() << "-way)" << std::endl;
+        summary << "Translation cycles: " << tlbCycles + walkCycles << " (" << walkCycles << " in page table walks, "
+                << (accesses > 0 ? (double)(tlbCycles + walkCycles) / accesses : 0) << " per access)" << std::endl;
+    } else if (tlbStats) {
+        long long tlbCycles = 0;
+        for (int l = 0; l < tlb->getLevelCount(); l++) {
+            summary << "TLB L" << l + 1 << ": " << tlb->getHits(l) << " hits, " << tlb->getMisses(l) << " misses, "
+                    << tlb->getCycles(l) << " cycles (" << tlb->getLevel(l)->getSize() << " entries, "
+                    << tlb->getLevel(l)->getWays() << "-way)" << std::endl;
+            tlbCycles += tlb->getCycles(l);
+        }
+        long long walkCycles = translator.getWalkCount() * TLB_WALK_LATENCY;
+        long long accesses = tlb->getHits(0) + tlb->getMisses(0);
+        summary << "Translation cycles: " << tlbCycles + walkCycles << " (" << walkCycles << " in page table walks, "
+                << (accesses > 0 ? (double)(tlbCycles + walkCycles) / accesses : 0) << " per access)" << std::endl;
+    }
+    if (prefetcher != nullptr) {
+        summary << "Prefetches: " << prefetcher->getIssueCount() << " issued, " << prefetcher->getUsefulCount()
+                << " useful (" << prefetcher->getAccuracy() * 100 << "% accuracy, " << prefetcher->getCoverage() * 100
+                << "% coverage), " << prefetcher->getLateCount() << " late, " << prefetcher->getWastedCount()
+                << " dropped unused (" << prefetcher->getName() << ")" << std::endl;
+    }
+    if (traceCount > 1 || sharing) {
+        summary << "Context switches: " << translator.getSwitchCount() << " every " << quantum << " addresses (";
+        if (translator.isTLBTagged())
+            summary << "ASID-tagged TLB)" << std::endl;
+        else
+            summary << "TLB flushed, " << translator.getFlushedEntryCount() << " entries dropped)" << std::endl;
+        for (int i = 0; i < traceCount && traceCount > 1; i++) {
+            const AddressSpaceStats &stats = translator.getAddressSpaceStats(i);
+            long long faults = translator.getPageTable(i)->getFaultCount();
+            double accesses = stats.translations > 0 ? (double)stats.translations : 1;
+            summary << "Process " << i << " (" << processes[i].path << "): " << stats.translations << " addresses, "
+                    << stats.tlbHits << " TLB hits (" << stats.tlbHits / accesses * 100 << "%), " << faults
+                    << " page faults (" << faults / accesses * 100 << "%), " << stats.sharedFaults << " shared, "
+                    << stats.cowFaults << " copy-on-write" << std::endl;
+        }
+        long long mappings = physicalMemory->getMappingCount();
+        summary << "Memory: " << mappings << " mappings in " << physicalMemory->getFramesUsed() << " frames ("
+                << mappings - physicalMemory->getFramesUsed() << " saved by sharing)" << std::endl;
+        long long cowFaults = translator.getCopyOnWriteCount();
+        summary << "Shared frames: " << translator.getSharedFaultCount() << " faults mapped a loaded frame, "
+                << cowFaults << " copy-on-write faults (" << physicalMemory->getCopyCount() << " copied, "
+                << (cowFaults > 0 ? translator.getCopyOnWriteTime() / cowFaults : 0) << " ns/fault)" << std::endl;
+    }
+    if (flusher != nullptr) {
+        long long staged = flusher->getStagedCount();
+        long long batches = flusher->getBatchCount();
+        summary << "Writes: " << translator.getWriteCount() << " of " << translator.getTranslationCount()
+                << " addresses, " << physicalMemory->getDirtyEvictionCount() << " dirty evictions, " << syncedPages
+                << " dirty pages written back at exit" << std::endl;
+        summary << "Write-back: " << flusher->getWrittenCount() << " pages (" << flusher->getBytesWritten()
+                << " bytes) to " << flusher->getPath() << " in " << batches << " batches and "
+                << flusher->getWriteCount() << " writes, " << (batches > 0 ? flusher->getWriteTime() / batches : 0)
+                << " ns/batch; " << (staged > 0 ? flusher->getStageTime() / staged : 0)
+                << " ns added per dirty page, " << flusher->getStallCount() << " stalls" << std::endl;
+    }
+    if (!checkpointPath.empty()) {
+        summary << "Checkpoints: " << checkpointsWritten << " written to " << checkpointPath;
+        if (checkpointsWritten > 0)
+            summary << ", the last after " << checkpoint.position << " addresses";
+        summary << std::endl;
+    }
+    if (server != nullptr) {
+        const Histogram &latency = server->getLatency();
+        summary << "Service: " << server->getConnectionCount() << " connections, " << server->getRequestCount()
+                << " requests (" << server->getAddressCount() << " addresses), " << server->getRejectedCount()
+                << " rejected";
+        if (latency.getCount() > 0) {
+            summary << "; latency p50 " << latency.getPercentile(50) << " ns, p99 " << latency.getPercentile(99)
+                    << " ns, mean " << (long long)latency.getMean() << " ns";
+        }
+        summary << std::endl;
+    }
+    if (geometry.largeBits > 0) {
+        summary << "Large pages: " << translator.getPromotionCount() << " promotions, " << translator.getDemotionCount()
+                << " demotions, " << translator.getLargeTLBHits() << " large TLB hits" << std::endl;
+        summary << "Page table walks: " << translator.getWalkCount() << " (" << translator.getLargeWalkCount()
+                << " ended at a large page)" << std::endl;
+    }
 
+    delete server;
+    delete engine;
+    delete prefetcher;
+    delete flusher;
     delete tlb;
-    delete pageTable;
+    for (PageTable *table : pageTables)
+        delete table;
+    delete physicalMemory;
+    // The first process reads its trace through fileProcessor; a service has no processes.
     delete fileProcessor;
+    for (size_t i = 1; i < processes.size(); i++)
+        delete processes[i].trace;
     return 0;
 }